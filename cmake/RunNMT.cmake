@@ -1,6 +1,6 @@
 function(run_nmt target)
 	cmake_parse_arguments(PARSE_ARGV 1 ARG
-		"PRIVATE_TARGET_DIR_TO_PATH"
+		"PRIVATE_TARGET_DIR_TO_PATH;MODULES;HEADER_MODULES"
 		"SOURCE_DIR"
 		"")
 	if(NOT ARG_SOURCE_DIR)
@@ -10,15 +10,17 @@ function(run_nmt target)
 	# Default base directory is CMAKE_CURRENT_SOURCE_DIR.
 	cmake_path(ABSOLUTE_PATH ARG_SOURCE_DIR NORMALIZE)
 
-	# Perform GLOB_RECURSE to trigger config if anything changes
-	# in the source directory.
-	file(GLOB_RECURSE sources CONFIGURE_DEPENDS *)
-
 	set(output_dir "${CMAKE_CURRENT_BINARY_DIR}/generated/nmt")
+	set(output_mode headers)
+	if(ARG_MODULES)
+		# A module interface unit per target instead of a header per entity, needs CMake 3.28.
+		set(output_mode modules)
+	endif()
 	execute_process(COMMAND ${NMT_PROGRAM}
 		--source-dir ${ARG_SOURCE_DIR}
 		--target ${target}
 		--output-dir ${output_dir}
+		--output-mode ${output_mode}
 		COMMAND_ECHO STDOUT
 		COMMAND_ERROR_IS_FATAL ANY
 	)
@@ -26,6 +28,15 @@ function(run_nmt target)
 	# Read output file list from running `nmt`.
 	file(STRINGS ${output_dir}/files.txt generated_files)
 
+	# Re-run configure if a source file is added or removed, which changes the set of generated
+	# files. The check runs before the build, the `nmt` target below would update `files.txt` too
+	# late. Content-only edits of the sources don't trigger a reconfigure.
+	file(GLOB_RECURSE sources CONFIGURE_DEPENDS
+		${ARG_SOURCE_DIR}/*.h
+		${ARG_SOURCE_DIR}/*.hpp
+		${ARG_SOURCE_DIR}/*.hxx
+	)
+
 	# Diagnostics; print the contents of `files.txt`
 	set(generated_files_rel "")
 	foreach(f IN LISTS generated_files)
@@ -34,9 +45,21 @@ function(run_nmt target)
  	endforeach()
 	message(STATUS "reading file list ${output_dir}/files.txt -> ${generated_files_rel}")
 
-	# Add the file list and the generated source files to the target.
+	# Add the file list and the generated source files to the target. The module interface units
+	# go to a CXX_MODULES file set so CMake scans them and builds them before their importers.
 	source_group(boilerplate FILES ${output_dir}/files.txt ${generated_files})
+	set(module_files ${generated_files})
+	list(FILTER module_files INCLUDE REGEX "\\.cppm$")
+	list(FILTER generated_files EXCLUDE REGEX "\\.cppm$")
 	target_sources(${target} PRIVATE ${output_dir}/files.txt ${generated_files})
+	if(module_files)
+		target_sources(${target}
+			PUBLIC
+				FILE_SET nmt_modules TYPE CXX_MODULES
+				BASE_DIRS ${output_dir}
+				FILES ${module_files}
+		)
+	endif()
 	target_include_directories(${target}
 		PUBLIC
 			${output_dir}/public
@@ -51,13 +74,27 @@ function(run_nmt target)
 		)
 	endif()
 
-	add_custom_command(TARGET ${target}
-	                   PRE_BUILD
-	                   COMMAND ${NMT_PROGRAM}
-	                   --source-dir ${ARG_SOURCE_DIR}
-	                   --target ${target}
-	                   --output-dir ${output_dir}
-	                   BYPRODUCTS ${output_dir}/files.txt
-	                   COMMENT "Running nmt."
+	if(ARG_HEADER_MODULES AND CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+		# Clang builds the modules of the entity headers on demand and caches them. GCC's header
+		# units have to be built explicitly, see `header-units.map`.
+		target_compile_options(${target}
+			PRIVATE
+				-fmodules
+				-fmodule-map-file=${output_dir}/module.modulemap
+				-fmodules-cache-path=${CMAKE_CURRENT_BINARY_DIR}/nmt-module-cache
+		)
+	endif()
+
+	# A separate target instead of a PRE_BUILD step: PRE_BUILD is PRE_LINK except on Visual Studio
+	# generators, so it would run after the generated sources have been compiled.
+	add_custom_target(${target}_nmt
+	                  COMMAND ${NMT_PROGRAM}
+	                  --source-dir ${ARG_SOURCE_DIR}
+	                  --target ${target}
+	                  --output-dir ${output_dir}
+	                  --output-mode ${output_mode}
+	                  BYPRODUCTS ${output_dir}/files.txt
+	                  COMMENT "Running nmt."
 	)
+	add_dependencies(${target} ${target}_nmt)
 endfunction()
@@ -0,0 +1,16 @@
+// #class
+class EntitySearchIndex {
+   public:
+    struct Result {
+        int64_t sourceId;
+        int score;  // Higher is better.
+    };
+
+#include NMT_MEMBER_DECLARATIONS
+
+   private:
+    // Keyed by source id.
+    TrigramIndex names, sourceRelPaths;
+};
+// #needs: "util/TrigramIndex.h", <cstdint>
+// #visibility: public
@@ -0,0 +1,10 @@
+// #memfn
+void EntitySearchIndex::rebuild(const Project& project) {
+    names.clear();
+    sourceRelPaths.clear();
+    for (auto id : project.entities().itemsWithEntities()) {
+        update(project, id);
+    }
+}
+// #needs: class Project
+// #defneeds: "nmt/Project.h"
@@ -0,0 +1,30 @@
+// Entities whose name or source path matches `query`, best first. A match on the name ranks above
+// an equally good match on the path.
+// #memfn
+std::vector<EntitySearchIndex::Result> EntitySearchIndex::search(std::string_view query,
+                                                                 size_t maxResults) const {
+    constexpr int k_nameMatchBonus = 1000;
+
+    flat_hash_map<int64_t, int> scores;
+    for (auto& m : names.search(query, maxResults)) {
+        scores[m.key] = m.score + k_nameMatchBonus;
+    }
+    for (auto& m : sourceRelPaths.search(query, maxResults)) {
+        auto& score = scores[m.key];
+        score = std::max(score, m.score);
+    }
+    std::vector<Result> results;
+    results.reserve(scores.size());
+    for (auto& [id, score] : scores) {
+        results.push_back(Result{.sourceId = id, .score = score});
+    }
+    std::ranges::sort(results, [](const Result& x, const Result& y) {
+        return x.score != y.score ? x.score > y.score : x.sourceId < y.sourceId;
+    });
+    if (results.size() > maxResults) {
+        results.resize(maxResults);
+    }
+    return results;
+}
+// #needs: <string_view>, <vector>
+// #defneeds: "nmt/base_types.h", <algorithm>
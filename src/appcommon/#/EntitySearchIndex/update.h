@@ -0,0 +1,15 @@
+// Index the entity of the source, or remove the source from the index if it has no entity (any
+// more).
+// #memfn
+void EntitySearchIndex::update(const Project& project, int64_t sourceId) {
+    auto* entity = std::get_if<Entity>(&project.entities().source(sourceId).state);
+    if (!entity) {
+        names.erase(sourceId);
+        sourceRelPaths.erase(sourceId);
+        return;
+    }
+    names.insert(sourceId, entity->name);
+    sourceRelPaths.insert(sourceId, path_to_string(entity->sourceRelPath));
+}
+// #needs: class Project, <cstdint>
+// #defneeds: "nmt/Project.h", "util/stlext.h", <variant>
@@ -3,7 +3,22 @@ class UI {
    public:
     virtual ~UI() = default;
 
-    virtual int exec(const UserState* userState) = 0;
+    // Non-const: the UI registers itself as the tree listener of the project.
+    virtual int exec(UserState* userState) = 0;
+
+    // Thread-safe, `fn` will be called on the UI thread.
+    virtual void postToUiThread(std::function<void()> fn) = 0;
+
+    // The rest must be called on the UI thread.
+
+    // `UserState::project` has been replaced.
+    virtual void projectReset() = 0;
+    virtual void showProgress(std::string_view message) = 0;
+    // Result of the compile check of the generated cpp of `entityId`, `diagnostics` is the
+    // compiler's output.
+    virtual void showCompileCheckResult(int64_t entityId,
+                                        bool ok,
+                                        std::string_view diagnostics) = 0;
 };
 // #visibility: public
-// #needs: UserState*
+// #needs: UserState*, <cstdint>, <functional>, <string_view>
@@ -1,8 +1,10 @@
 // #struct
 struct UserState {
     std::optional<Project> project;
+    // Maintained by `setProject` and `updateSources`.
+    EntitySearchIndex entitySearchIndex;
 
 #include NMT_MEMBER_DECLARATIONS
 };
-// #needs: "nmt/Project.h", <optional>
+// #needs: EntitySearchIndex, "nmt/Project.h", <optional>
 // #visibility: public
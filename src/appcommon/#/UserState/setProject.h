@@ -1,5 +1,6 @@
 // #memfn
 void UserState::setProject(Project projectArg) {
     project = std::move(projectArg);
+    entitySearchIndex.rebuild(*project);
 }
 // #defneeds: <utility>
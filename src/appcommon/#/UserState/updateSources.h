@@ -0,0 +1,14 @@
+// Apply the results of processing sources (on another thread) to `project`.
+// #memfn
+void UserState::updateSources(std::vector<ProcessedSource> processedSources) {
+    CHECK(project);
+    // Already reported by the thread which processed the sources.
+    Diagnostics ignoredDiagnostics(DiagnosticLevel::error);
+    for (auto& ps : processedSources) {
+        UpdateProjectWithProcessSourceResult(
+            *project, ps.id, std::move(ps.result), ps.lastWriteTime, ignoredDiagnostics);
+        entitySearchIndex.update(*project, ps.id);
+    }
+}
+// #needs: struct ProcessedSource, <vector>
+// #defneeds: "nmt/Diagnostics.h", "nmt/ProcessSource.h", <absl/log/check.h>
@@ -0,0 +1,134 @@
+#include "AllocationCounting.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// The counters of a thread, on their own cache line so the threads don't contend. They're never
+// freed: when a thread exits they're released for reuse by a later thread and their counts stay in
+// the totals. Only the owning thread adds to them, atomically because a thread may still allocate
+// after its counters were released (from the destructors of other thread-locals).
+struct alignas(64) ThreadCounters {
+    std::atomic<int64_t> allocations{0};
+    std::atomic<int64_t> bytes{0};
+    std::atomic<bool> inUse{true};
+    ThreadCounters* next = nullptr;
+};
+// All the counters ever created, only pushed to.
+std::atomic<ThreadCounters*> g_threadCounters{nullptr};
+
+ThreadCounters* AcquireThreadCounters() {
+    for (auto* c = g_threadCounters.load(std::memory_order_acquire); c; c = c->next) {
+        bool released = false;
+        if (c->inUse.compare_exchange_strong(released, true, std::memory_order_acquire)) {
+            return c;
+        }
+    }
+    // Not `new`, which would count the allocation on the counters being created.
+    auto* memory = std::aligned_alloc(alignof(ThreadCounters), sizeof(ThreadCounters));
+    if (!memory) {
+        std::abort();
+    }
+    auto* c = ::new (memory) ThreadCounters;
+    c->next = g_threadCounters.load(std::memory_order_relaxed);
+    while (!g_threadCounters.compare_exchange_weak(
+        c->next, c, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return c;
+}
+
+struct ThreadCountersRelease {
+    ThreadCounters* counters = nullptr;
+    ~ThreadCountersRelease() {
+        if (counters) {
+            counters->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadCounters* t_counters = nullptr;
+thread_local ThreadCountersRelease t_countersRelease;
+
+void Count(std::size_t size) {
+    auto* c = t_counters;
+    if (!c) {
+        c = t_counters = AcquireThreadCounters();
+        t_countersRelease.counters = c;
+    }
+    c->allocations.fetch_add(1, std::memory_order_relaxed);
+    c->bytes.fetch_add(int64_t(size), std::memory_order_relaxed);
+}
+
+void* CountedAlloc(std::size_t size) {
+    Count(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* CountedAlignedAlloc(std::size_t size, std::align_val_t al) {
+    Count(size);
+    auto alignment = static_cast<std::size_t>(al);
+    // `aligned_alloc` requires the size to be a multiple of the alignment.
+    auto alignedSize = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, alignedSize == 0 ? alignment : alignedSize);
+}
+}  // namespace
+
+AllocationCounts GetAllocationCounts() {
+    AllocationCounts counts;
+    for (auto* c = g_threadCounters.load(std::memory_order_acquire); c; c = c->next) {
+        counts.allocations += c->allocations.load(std::memory_order_relaxed);
+        counts.bytes += c->bytes.load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+void* operator new(std::size_t size) {
+    if (auto* p = CountedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void* operator new(std::size_t size, std::align_val_t al) {
+    if (auto* p = CountedAlignedAlloc(size, al)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t al) {
+    return operator new(size, al);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
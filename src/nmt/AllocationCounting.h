@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// The global `operator new` is replaced (in AllocationCounting.cpp) to count the allocations of
+// the whole process, on per-thread counters summed by `GetAllocationCounts()`. Deallocations are
+// not tracked.
+struct AllocationCounts {
+    int64_t allocations = 0;
+    int64_t bytes = 0;
+};
+
+AllocationCounts GetAllocationCounts();
@@ -0,0 +1,158 @@
+#include "Stats.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <sys/resource.h>
+#endif
+
+void PhaseStatsRecorder::begin(std::string name) {
+    CHECK(!_countsAtBegin) << "Previous phase hasn't ended.";
+    _phases.push_back(PhaseStats{.name = std::move(name)});
+    _countsAtBegin = GetAllocationCounts();
+}
+
+void PhaseStatsRecorder::end() {
+    CHECK(_countsAtBegin) << "No phase has begun.";
+    auto counts = GetAllocationCounts();
+    auto& phase = _phases.back();
+    phase.allocations =
+        AllocationCounts{.allocations = counts.allocations - _countsAtBegin->allocations,
+                         .bytes = counts.bytes - _countsAtBegin->bytes};
+    phase.peakRssBytes = PeakRssBytes();
+    _countsAtBegin.reset();
+}
+
+std::optional<int64_t> PeakRssBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage ru{};
+    if (getrusage(RUSAGE_SELF, &ru) != 0) {
+        return std::nullopt;
+    }
+#    ifdef __APPLE__
+    return int64_t(ru.ru_maxrss);  // Bytes on macOS.
+#    else
+    return int64_t(ru.ru_maxrss) * 1024;  // Kilobytes on Linux and the BSDs.
+#    endif
+#else
+    return std::nullopt;
+#endif
+}
+
+namespace {
+struct NamedBytes {
+    std::string_view name;
+    int64_t bytes;
+};
+std::vector<NamedBytes> ContainerBytes(const Project::Stats& s) {
+    return {{"Entities::items", s.entities.itemsBytes},
+            {"Entities::sourcePathToId", s.entities.sourcePathToIdBytes},
+            {"entities", s.entities.entitiesBytes},
+            {"Project::_treeItems", s.treeItemsBytes},
+            {"Project::_dirConfigs", s.dirConfigFilesBytes}};
+}
+
+// The last item of `workers` is the waiting threads, see `TaskScheduler::workerStats()`.
+std::string WorkerName(std::span<const TaskScheduler::WorkerStats> workers, size_t i) {
+    return i + 1 == workers.size() ? std::string("waiting threads") : fmt::format("worker {}", i);
+}
+int64_t BusyMilliseconds(const TaskScheduler::WorkerStats& w) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(w.busyTime).count();
+}
+
+std::string FormatStatsText(const Project::Stats& s,
+                            std::span<const PhaseStats> phases,
+                            std::span<const TaskScheduler::WorkerStats> workers) {
+    std::string r = fmt::format("Stats:\n  targets: {}\n  sources: {}\n  entities:\n",
+                                s.targets,
+                                s.entities.sources);
+    for (auto k : enum_traits<EntityKind>::elements) {
+        r += fmt::format("    {}: {}\n",
+                         enum_name(k),
+                         s.entities.entitiesPerKind[size_t(std::to_underlying(k))]);
+    }
+    r += fmt::format("  needs edges: {}\n  tree items: {}\n  dir config files: {}\n",
+                     s.entities.needsEdges,
+                     s.treeItems,
+                     s.dirConfigFiles);
+    r += fmt::format("  spilled entity bytes: {}\n", s.entities.spilledBytes);
+    r += "  estimated heap bytes:\n";
+    for (auto& nb : ContainerBytes(s)) {
+        r += fmt::format("    {}: {}\n", nb.name, nb.bytes);
+    }
+    r += "  phases:\n";
+    for (auto& p : phases) {
+        r += fmt::format("    {}: {} allocations, {} bytes allocated, peak RSS {}\n",
+                         p.name,
+                         p.allocations.allocations,
+                         p.allocations.bytes,
+                         p.peakRssBytes ? fmt::format("{} bytes", *p.peakRssBytes) : "n/a");
+    }
+    r += "  task scheduler:\n";
+    for (size_t i = 0; i < workers.size(); ++i) {
+        r += fmt::format("    {}: {} tasks, {} stolen, busy {} ms\n",
+                         WorkerName(workers, i),
+                         workers[i].tasksRun,
+                         workers[i].tasksStolen,
+                         BusyMilliseconds(workers[i]));
+    }
+    return r;
+}
+
+std::string FormatStatsJson(const Project::Stats& s,
+                            std::span<const PhaseStats> phases,
+                            std::span<const TaskScheduler::WorkerStats> workers) {
+    // The names are identifiers, no escaping needed.
+    std::vector<std::string> kinds, containers, phaseObjects, workerObjects;
+    for (auto k : enum_traits<EntityKind>::elements) {
+        kinds.push_back(fmt::format("\"{}\":{}",
+                                    enum_name(k),
+                                    s.entities.entitiesPerKind[size_t(std::to_underlying(k))]));
+    }
+    for (auto& nb : ContainerBytes(s)) {
+        containers.push_back(fmt::format("\"{}\":{}", nb.name, nb.bytes));
+    }
+    for (auto& p : phases) {
+        phaseObjects.push_back(
+            fmt::format("{{\"name\":\"{}\",\"allocations\":{},\"allocatedBytes\":{},"
+                        "\"peakRssBytes\":{}}}",
+                        p.name,
+                        p.allocations.allocations,
+                        p.allocations.bytes,
+                        p.peakRssBytes ? fmt::format("{}", *p.peakRssBytes) : "null"));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workerObjects.push_back(
+            fmt::format("{{\"name\":\"{}\",\"tasks\":{},\"stolenTasks\":{},\"busyMs\":{}}}",
+                        WorkerName(workers, i),
+                        workers[i].tasksRun,
+                        workers[i].tasksStolen,
+                        BusyMilliseconds(workers[i])));
+    }
+    return fmt::format(
+        "{{\"targets\":{},\"sources\":{},\"entities\":{{{}}},\"needsEdges\":{},\"treeItems\":{},"
+        "\"dirConfigFiles\":{},\"spilledEntityBytes\":{},\"estimatedHeapBytes\":{{{}}},"
+        "\"phases\":[{}],\"workers\":[{}]}}\n",
+        s.targets,
+        s.entities.sources,
+        fmt::join(kinds, ","),
+        s.entities.needsEdges,
+        s.treeItems,
+        s.dirConfigFiles,
+        s.entities.spilledBytes,
+        fmt::join(containers, ","),
+        fmt::join(phaseObjects, ","),
+        fmt::join(workerObjects, ","));
+}
+}  // namespace
+
+std::string FormatStats(StatsFormat format,
+                        const Project::Stats& projectStats,
+                        std::span<const PhaseStats> phases,
+                        std::span<const TaskScheduler::WorkerStats> workers) {
+    switch (format) {
+        case StatsFormat::text:
+            return FormatStatsText(projectStats, phases, workers);
+        case StatsFormat::json:
+            return FormatStatsJson(projectStats, phases, workers);
+    }
+    LOG(FATAL) << "Invalid StatsFormat";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AllocationCounting.h"
+
+#include "nmt/ProgramOptions.h"
+#include "nmt/Project.h"
+#include "util/TaskScheduler.h"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+struct PhaseStats {
+    std::string name;
+    AllocationCounts allocations;        // Made during the phase.
+    std::optional<int64_t> peakRssBytes;  // At the end of the phase.
+};
+
+// Collect the `PhaseStats` of consecutive phases.
+class PhaseStatsRecorder {
+   public:
+    void begin(std::string name);
+    void end();
+    const std::vector<PhaseStats>& phases() const {
+        return _phases;
+    }
+
+   private:
+    std::vector<PhaseStats> _phases;
+    std::optional<AllocationCounts> _countsAtBegin;
+};
+
+// Peak resident set size of the process, nullopt if it's not available on the platform.
+std::optional<int64_t> PeakRssBytes();
+
+// `workers`: see `TaskScheduler::workerStats()`.
+std::string FormatStats(StatsFormat format,
+                        const Project::Stats& projectStats,
+                        std::span<const PhaseStats> phases,
+                        std::span<const TaskScheduler::WorkerStats> workers);
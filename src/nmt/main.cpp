@@ -1,7 +1,15 @@
+#include "Stats.h"
+
+#include "nmt/Diagnostics.h"
+#include "nmt/ForwardDeclarableNeeds.h"
 #include "nmt/GenerateBoilerplate.h"
+#include "nmt/Impact.h"
+#include "nmt/InferNeeds.h"
 #include "nmt/ProcessSource.h"
 #include "nmt/ProgramOptions.h"
 #include "nmt/Project.h"
+#include "nmt/SourcePipeline.h"
+#include "util/TaskScheduler.h"
 
 namespace fs = std::filesystem;
 
@@ -102,52 +110,148 @@ int main(int argc, char* argv[]) {
         return argsOr.error();
     }
     auto& args = *argsOr;
+    TaskScheduler::setSharedThreadCount(args.jobs);
 
     fmt::print("### NMT ###\n");
 
+    PhaseStatsRecorder phaseStats;
     Project project;
-    auto addTargetResultOr = project.addTarget(args.target, args.sourceDir, args.outputDir);
-    if (!addTargetResultOr) {
-        fmt::print(stderr,
-                   "Error: can't add target {}, reason: {}\n",
-                   args.target,
-                   addTargetResultOr.error());
-        return EXIT_FAILURE;
+    Diagnostics diagnostics(args.verbose ? DiagnosticLevel::verbose : DiagnosticLevel::info);
+    const bool streaming = args.maxEntityMemoryMiB.has_value();
+    if (streaming) {
+        if (auto r = project.entities_enableSpilling(*args.maxEntityMemoryMiB * 1024 * 1024); !r) {
+            fmt::print(stderr, "Error: {}\n", r.error());
+            return EXIT_FAILURE;
+        }
     }
-    auto& addTargetResult = *addTargetResultOr;
-    if (!addTargetResult.nonFatalErrors.empty()) {
-        for (auto& m : addTargetResult.nonFatalErrors) {
-            fmt::print(stderr, "Error: during adding target {}: {}\n", args.target, m);
+    // The sources are processed on the pipeline's threads while the source directories are still
+    // being traversed. All sources of the fresh project are dirty. Not in streaming mode, where all
+    // the parsed sources would be kept until the traversal finishes.
+    SourcePipeline pipeline;
+    Project::SourceAddedFn pushToPipeline;
+    if (!streaming) {
+        pushToPipeline = [&](Entities::Id id) {
+            pipeline.push(project, id);
+        };
+    }
+    auto addTarget = [&](const std::string& name,
+                         const fs::path& sourceDir,
+                         const fs::path& outputDir) -> bool {
+        auto targetIdOr =
+            project.addTarget(name, sourceDir, outputDir, diagnostics, pushToPipeline);
+        if (!targetIdOr) {
+            fmt::print(stderr, "Error: can't add target {}, reason: {}\n", name, targetIdOr.error());
+            return false;
         }
+        return true;
+    };
+    phaseStats.begin(streaming ? "add targets" : "add targets, process sources");
+    if (!addTarget(args.target, args.sourceDir, args.outputDir)) {
         return EXIT_FAILURE;
     }
-    if (args.verbose) {
-        for (auto& m : addTargetResult.verboseMessages) {
-            fmt::print(stderr, "During adding target {}: {}\n", args.target, m);
+    for (auto& d : args.dependencies) {
+        if (!addTarget(d.name, d.sourceDir, d.outputDir)) {
+            return EXIT_FAILURE;
         }
     }
-    std::vector<std::string> verboseMessages, errors;
-    for (auto id : project.entities().dirtySources()) {
-        auto [newErrors, newVerboseMessages] =
-            ProcessSourceAndUpdateProject(project, id, args.verbose);
-        append_range(errors, std::move(newErrors));
-        if (args.verbose) {
-            append_range(verboseMessages, std::move(newVerboseMessages));
+    auto processedSources = pipeline.finish();
+    phaseStats.end();
+    if (streaming) {
+        // In batches, the entities of a batch are spilled before the next one is parsed.
+        constexpr size_t k_sourcesPerBatch = 4096;
+        phaseStats.begin("process sources");
+        auto dirtySources = project.entities().dirtySources();
+        for (size_t i = 0; i < dirtySources.size(); i += k_sourcesPerBatch) {
+            auto batch = std::span(dirtySources)
+                             .subspan(i, std::min(k_sourcesPerBatch, dirtySources.size() - i));
+            ProcessSourcesAndUpdateProject(project, batch, diagnostics);
+        }
+        phaseStats.end();
+    } else {
+        phaseStats.begin("update project");
+        // In the order of the source paths, like `dirtySources()`, for deterministic diagnostics.
+        std::ranges::sort(processedSources, [&project](const auto& a, const auto& b) {
+            return project.entities().sourcePath(a.id) < project.entities().sourcePath(b.id);
+        });
+        for (auto& ps : processedSources) {
+            UpdateProjectWithProcessSourceResult(
+                project, ps.id, std::move(ps.result), ps.lastWriteTime, diagnostics);
         }
+        phaseStats.end();
     }
-    if (args.verbose) {
-        for (auto& m : verboseMessages) {
-            fmt::print("Note: {}\n", m);
+    FlushDiagnostics(project.entities(), diagnostics);
+    if (diagnostics.errorCount() > 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (args.needsInference != NeedsInference::off) {
+        phaseStats.begin("infer needs");
+        auto inferred = InferNeeds(project);
+        const bool apply = args.needsInference == NeedsInference::apply;
+        size_t missing = 0, unused = 0;
+        for (auto& x : inferred) {
+            auto report = [&](SpecialCommentKeyword keyword, const InferredNeeds::List& list) {
+                missing += list.missing.size();
+                unused += list.unused.size();
+                if (!apply && list.changed) {
+                    diagnostics.report<Diagnostic::NeedsMismatch>(
+                        x.id, keyword, list.needs, list.missing, list.unused);
+                }
+            };
+            report(SpecialCommentKeyword::needs, x.declaration);
+            if (x.definition) {
+                report(SpecialCommentKeyword::defneeds, *x.definition);
+            }
+        }
+        if (apply) {
+            ApplyInferredNeeds(project, inferred);
+        }
+        phaseStats.end();
+        if (!inferred.empty()) {
+            diagnostics.report<Diagnostic::NeedsInferred>(inferred.size(), missing, unused, apply);
         }
     }
-    for (auto& m : errors) {
-        fmt::print("ERROR: {}\n", m);
+
+    if (args.command == Command::impact) {
+        auto reportOr =
+            ComputeImpact(project, args.impactSources, args.autoForwardDeclarations);
+        if (!reportOr) {
+            fmt::print(stderr, "Error: {}\n", reportOr.error());
+            return EXIT_FAILURE;
+        }
+        for (auto& f : reportOr->files) {
+            fmt::print("{} {}\n",
+                       f.regenerated ? "regenerated" : "dependency",
+                       path_to_string(f.path));
+        }
+        for (auto& t : reportOr->targets) {
+            fmt::print("target {}\n", t);
+        }
+        fmt::print("{} files affected, {} cpp files recompiled\n",
+                   reportOr->files.size(),
+                   reportOr->recompiledCpps);
+        return EXIT_SUCCESS;
     }
-    if (!errors.empty()) {
-        return EXIT_FAILURE;
+
+    if (args.autoForwardDeclarations != AutoForwardDeclarations::off) {
+        auto report = FindForwardDeclarableNeeds(project);
+        const bool apply = args.autoForwardDeclarations == AutoForwardDeclarations::apply;
+        if (!apply) {
+            for (auto& n : report.needs) {
+                diagnostics.report<Diagnostic::ForwardDeclarableNeed>(n.id, std::move(n.need));
+            }
+        }
+        if (!report.needs.empty()) {
+            diagnostics.report<Diagnostic::ForwardDeclarations>(
+                report.needs.size(), report.sparedCpps, apply);
+        }
     }
 
-    auto gbpr = GenerateBoilerplate(project);
+    phaseStats.begin("generate boilerplate");
+    auto gbpr = GenerateBoilerplate(
+        project, diagnostics, args.outputMode, args.autoForwardDeclarations);
+    phaseStats.end();
+    FlushDiagnostics(project.entities(), diagnostics);
     if (!gbpr) {
         for (auto& e : gbpr.error()) {
             fmt::print(stderr, "Error: {}\n", e);
@@ -155,5 +259,13 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (args.stats) {
+        fmt::print("{}",
+                   FormatStats(*args.stats,
+                               project.stats(),
+                               phaseStats.phases(),
+                               TaskScheduler::shared().workerStats()));
+    }
+
     return EXIT_SUCCESS;
 }
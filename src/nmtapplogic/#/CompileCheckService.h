@@ -0,0 +1,48 @@
+// #class
+// Checks (`-fsyntax-only`) the generated cpp files of entities on a pool of threads. A new request
+// for an entity supersedes its pending or running check, which is cancelled. The results are cached
+// by the hash of the preprocessed cpp and the compiler command, so an entity whose inputs haven't
+// changed is not checked again.
+class CompileCheckService {
+   public:
+    struct Result {
+        int64_t entityId;
+        bool ok;
+        bool cached;
+        std::string diagnostics;  // Compiler output or the reason the check couldn't run.
+    };
+    // Called on the service's threads.
+    using ResultCallback = std::function<void(Result)>;
+
+   private:
+    struct Job {
+        int64_t entityId;
+        uint64_t generation;
+        std::shared_ptr<const Project> project;
+    };
+    struct CachedResult {
+        bool ok;
+        std::string diagnostics;
+    };
+
+   public:
+#include NMT_MEMBER_DECLARATIONS
+
+   private:
+    const std::string compiler;
+    const std::vector<std::string> flags;
+    const ResultCallback onResult;
+
+    std::mutex mutex;
+    std::condition_variable_any jobAdded;
+    std::deque<Job> queue;
+    // The generation of the latest check of each entity, older jobs are stale.
+    flat_hash_map<int64_t, uint64_t> generations;
+    uint64_t nextGeneration = 1;
+    flat_hash_map<uint64_t, CachedResult> cache;  // Key: hash of the inputs.
+
+    // Last: stopped and joined first on destruction.
+    std::vector<std::jthread> workers;
+};
+// #needs: "nmt/Project.h", "nmt/base_types.h", <condition_variable>, <cstdint>, <deque>,
+// <functional>, <memory>, <mutex>, <string>, <thread>, <vector>
@@ -0,0 +1,16 @@
+// #memfn
+EXPLICIT CompileCheckService::CompileCheckService(std::string compilerArg,
+                                                  std::vector<std::string> flagsArg,
+                                                  ResultCallback onResultArg)
+    : compiler(std::move(compilerArg))
+    , flags(std::move(flagsArg))
+    , onResult(std::move(onResultArg)) {
+    auto threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this](std::stop_token stopToken) {
+            workerLoop(stopToken);
+        });
+    }
+}
+// #needs: <string>, <vector>
+// #defneeds: <algorithm>, <stop_token>, <thread>, <utility>
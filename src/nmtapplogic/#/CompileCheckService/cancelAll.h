@@ -0,0 +1,8 @@
+// #memfn
+void CompileCheckService::cancelAll() {
+    std::lock_guard lock(mutex);
+    queue.clear();
+    // The running checks become stale.
+    generations.clear();
+}
+// #defneeds: <mutex>
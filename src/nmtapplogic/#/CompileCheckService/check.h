@@ -0,0 +1,17 @@
+// Check the entities of `project` (a snapshot whose boilerplate has been generated), superseding
+// their previous checks.
+// #memfn
+void CompileCheckService::check(std::shared_ptr<const Project> project,
+                                std::span<const int64_t> entityIds) {
+    {
+        std::lock_guard lock(mutex);
+        for (auto id : entityIds) {
+            auto generation = nextGeneration++;
+            generations[id] = generation;
+            queue.push_back(Job{.entityId = id, .generation = generation, .project = project});
+        }
+    }
+    jobAdded.notify_all();
+}
+// #needs: class Project, <cstdint>, <memory>, <span>
+// #defneeds: <mutex>
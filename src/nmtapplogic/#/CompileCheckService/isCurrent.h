@@ -0,0 +1,8 @@
+// #memfn
+bool CompileCheckService::isCurrent(int64_t entityId, uint64_t generation) {
+    std::lock_guard lock(mutex);
+    auto it = generations.find(entityId);
+    return it != generations.end() && it->second == generation;
+}
+// #needs: <cstdint>
+// #defneeds: <mutex>
@@ -0,0 +1,65 @@
+// #memfn
+void CompileCheckService::runJob(const Job& job, std::stop_token stopToken) {
+    auto shouldCancel = [&] {
+        return stopToken.stop_requested() || !isCurrent(job.entityId, job.generation);
+    };
+    auto deliver = [&](bool ok, bool cached, std::string diagnostics) {
+        if (!shouldCancel()) {
+            onResult(Result{.entityId = job.entityId,
+                            .ok = ok,
+                            .cached = cached,
+                            .diagnostics = std::move(diagnostics)});
+        }
+    };
+    auto run = [&](std::string_view mode) {
+        std::vector<std::string> args;
+        args.push_back(compiler);
+        args.insert(args.end(), flags.begin(), flags.end());
+        args.emplace_back(mode);
+        args.push_back(path_to_string(job.project->cppPath(false, job.entityId)));
+        return RunProcess(args, shouldCancel);
+    };
+
+    // Preprocessing is a fraction of the cost of the check, its output identifies the inputs.
+    auto preprocessed = run("-E");
+    if (!preprocessed) {
+        deliver(false, false, std::move(preprocessed.error()));
+        return;
+    }
+    if (preprocessed->cancelled) {
+        return;
+    }
+    if (preprocessed->exitCode != 0) {
+        deliver(false, false, std::move(preprocessed->output));
+        return;
+    }
+    const auto inputHash =
+        StableHasher().add(compiler).add(flags).add(preprocessed->output).digest();
+    {
+        std::unique_lock lock(mutex);
+        if (auto it = cache.find(inputHash); it != cache.end()) {
+            auto cachedResult = it->second;
+            lock.unlock();
+            deliver(cachedResult.ok, true, std::move(cachedResult.diagnostics));
+            return;
+        }
+    }
+
+    auto checked = run("-fsyntax-only");
+    if (!checked) {
+        deliver(false, false, std::move(checked.error()));
+        return;
+    }
+    if (checked->cancelled) {
+        return;
+    }
+    bool ok = checked->exitCode == 0;
+    {
+        std::lock_guard lock(mutex);
+        cache[inputHash] = CachedResult{.ok = ok, .diagnostics = checked->output};
+    }
+    deliver(ok, false, std::move(checked->output));
+}
+// #needs: <stop_token>
+// #defneeds: "nmt/Project.h", "util/RunProcess.h", "util/StableHash.h", "util/stlext.h", <mutex>,
+// <string>, <string_view>, <utility>, <vector>
@@ -0,0 +1,21 @@
+// #memfn
+void CompileCheckService::workerLoop(std::stop_token stopToken) {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            if (!jobAdded.wait(lock, stopToken, [this] {
+                    return !queue.empty();
+                })) {
+                return;  // Stop requested.
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        if (isCurrent(job.entityId, job.generation)) {
+            runJob(job, stopToken);
+        }
+    }
+}
+// #needs: <stop_token>
+// #defneeds: <mutex>, <utility>
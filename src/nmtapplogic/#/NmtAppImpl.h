@@ -1,7 +1,14 @@
 // #struct
 struct NmtAppImpl : NmtApp {
     NmtAppImpl() = delete;
+    const ProgramOptions programOptions;
+    // Accessed only on the UI thread.
     std::unique_ptr<UserState> userState;
+    // The project as committed by the worker after each batch, can be read on any thread.
+    AtomicSnapshot<Project> projectSnapshot;
+    // Exists during `run()`, reports to its UI.
+    std::unique_ptr<CompileCheckService> compileCheckService;
 #include NMT_MEMBER_DECLARATIONS
 };
-// #needs: NmtApp, <memory>, struct UserState
+// #needs: NmtApp, <memory>, struct UserState, class CompileCheckService, "nmt/ProgramOptions.h", "nmt/Project.h",
+// "util/AtomicSnapshot.h"
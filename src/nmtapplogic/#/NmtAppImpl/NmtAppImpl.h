@@ -1,7 +1,6 @@
 // #memfn
-EXPLICIT NmtAppImpl::NmtAppImpl(Project project)
-    : userState(std::make_unique<UserState>()) {
-    userState->project = std::move(project);
-}
-// #needs: "nmt/Project.h"
-// #defneeds: <utility>, <memory>, "appcommon/UserState.h"
+EXPLICIT NmtAppImpl::NmtAppImpl(ProgramOptions programOptionsArg)
+    : programOptions(std::move(programOptionsArg))
+    , userState(std::make_unique<UserState>()) {}
+// #needs: "nmt/ProgramOptions.h"
+// #defneeds: <utility>, <memory>, "appcommon/UserState.h", CompileCheckService
@@ -0,0 +1,97 @@
+// #memfn
+void NmtAppImpl::loadProjectInBackground(std::stop_token stopToken, UI* ui) {
+    // Number of sources processed between two updates of the UI.
+    constexpr size_t k_batchSize = 256;
+
+    auto showProgress = [ui](std::string message) {
+        ui->postToUiThread([ui, message = std::move(message)] {
+            ui->showProgress(message);
+        });
+    };
+    auto printErrors = [](const std::vector<std::string>& errors) {
+        for (auto& m : errors) {
+            fmt::print(stderr, "Error: {}\n", m);
+        }
+    };
+
+    // The worker keeps its own copy of the project for generating boilerplate, the UI thread's
+    // copy is updated with the same results (its tree model needs the change notifications). The
+    // copies share the unchanged parts.
+    showProgress(fmt::format("Scanning {}", programOptions.sourceDir));
+    Project project;
+    // Only the errors are printed.
+    Diagnostics diagnostics(DiagnosticLevel::error);
+    auto targetIdOr = project.addTarget(
+        programOptions.target, programOptions.sourceDir, programOptions.outputDir, diagnostics);
+    if (!targetIdOr) {
+        showProgress(fmt::format(
+            "Can't add target {}, reason: {}", programOptions.target, targetIdOr.error()));
+        return;
+    }
+    for (auto& d : programOptions.dependencies) {
+        auto dependencyIdOr = project.addTarget(d.name, d.sourceDir, d.outputDir, diagnostics);
+        if (!dependencyIdOr) {
+            showProgress(
+                fmt::format("Can't add target {}, reason: {}", d.name, dependencyIdOr.error()));
+            return;
+        }
+    }
+    FlushDiagnostics(project.entities(), diagnostics);
+    projectSnapshot.publish(std::make_shared<const Project>(project));
+    ui->postToUiThread([this, ui, snapshot = Project(project)]() mutable {
+        userState->setProject(std::move(snapshot));
+        ui->projectReset();
+    });
+
+    auto dirtySources = project.entities().dirtySources();
+    auto errorCountBefore = diagnostics.errorCount();
+    for (size_t batchBegin = 0; batchBegin < dirtySources.size(); batchBegin += k_batchSize) {
+        if (stopToken.stop_requested()) {
+            return;
+        }
+        auto ids = std::span(dirtySources)
+                       .subspan(batchBegin, std::min(k_batchSize, dirtySources.size() - batchBegin));
+        auto batch = ProcessSources(project, ids);
+        for (auto& ps : batch) {
+            UpdateProjectWithProcessSourceResult(
+                project, ps.id, ps.result, ps.lastWriteTime, diagnostics);
+        }
+        projectSnapshot.publish(std::make_shared<const Project>(project));
+        FlushDiagnostics(project.entities(), diagnostics);
+        auto errorCount = diagnostics.errorCount() - errorCountBefore;
+        auto processedCount = batchBegin + ids.size();
+        ui->postToUiThread([this,
+                            ui,
+                            batch = std::move(batch),
+                            progress = fmt::format("Processed {} of {} sources, {} errors",
+                                                   processedCount,
+                                                   dirtySources.size(),
+                                                   errorCount)]() mutable {
+            userState->updateSources(std::move(batch));
+            ui->showProgress(progress);
+        });
+    }
+    if (stopToken.stop_requested() || diagnostics.errorCount() > errorCountBefore) {
+        return;
+    }
+
+    showProgress("Generating boilerplate");
+    if (auto r = GenerateBoilerplate(project, diagnostics); r) {
+        showProgress("Ready");
+        // The generated cpp files of the processed entities are new or changed.
+        std::vector<int64_t> entityIds;
+        for (auto id : dirtySources) {
+            if (std::holds_alternative<Entity>(project.entities().source(id).state)) {
+                entityIds.push_back(id);
+            }
+        }
+        compileCheckService->check(projectSnapshot.load(), entityIds);
+    } else {
+        printErrors(r.error());
+        showProgress(fmt::format("Generating boilerplate failed, {} errors", r.error().size()));
+    }
+}
+// #needs: <stop_token>, class UI
+// #defneeds: "appcommon/UI.h", "appcommon/UserState.h", "nmt/Diagnostics.h",
+// "nmt/GenerateBoilerplate.h", "nmt/ProcessSource.h", "nmt/Project.h", CompileCheckService,
+// <fmt/core.h>, <fmt/std.h>, <memory>, <span>, <string>, <variant>, <vector>
@@ -1,6 +1,24 @@
 // #memfn
 int NmtAppImpl::run(std::unique_ptr<UI> ui) OVERRIDE {
-    return ui->exec(userState.get());
+    compileCheckService = std::make_unique<CompileCheckService>(
+        programOptions.checkCompiler,
+        programOptions.checkFlags,
+        [uiPtr = ui.get()](CompileCheckService::Result r) {
+            uiPtr->postToUiThread([uiPtr, r = std::move(r)] {
+                uiPtr->showCompileCheckResult(r.entityId, r.ok, r.diagnostics);
+            });
+        });
+    // The window opens immediately, the worker fills in the project as the results arrive.
+    std::jthread worker([this, uiPtr = ui.get()](std::stop_token stopToken) {
+        loadProjectInBackground(stopToken, uiPtr);
+    });
+    auto result = ui->exec(userState.get());
+    // The closures the worker posts after this point are never executed.
+    worker.request_stop();
+    worker.join();
+    // Cancels the running checks.
+    compileCheckService.reset();
+    return result;
 }
 // #needs: <memory>, class UI
-// #defneeds: "appcommon/UI.h"
+// #defneeds: "appcommon/UI.h", CompileCheckService, <stop_token>, <thread>, <utility>
@@ -1,3 +1,3 @@
 // #memfn
 NmtAppImpl::~NmtAppImpl() {}
-// #defneeds: "appcommon/UserState.h"
\ No newline at end of file
+// #defneeds: "appcommon/UserState.h", CompileCheckService
\ No newline at end of file
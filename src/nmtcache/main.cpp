@@ -0,0 +1,24 @@
+#include "nmt/CompilerLauncher.h"
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fmt::print(stderr,
+                   "Usage: nmt-cache <compiler> <arguments>...\n"
+                   "Compiler launcher with an object cache for the cpp files generated by nmt, "
+                   "e.g. -DCMAKE_CXX_COMPILER_LAUNCHER=nmt-cache\n"
+                   "The cache directory is $NMT_CACHE_DIR (default: ~/.cache/nmt/objects).\n");
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> command(argv + 1, argv + argc);
+    auto cacheDir = DefaultObjectCacheDir();
+    if (!cacheDir) {
+        fmt::print(stderr, "nmt-cache: no cache directory (set NMT_CACHE_DIR), not caching\n");
+    }
+    return RunCompilerLauncher(command, cacheDir);
+}
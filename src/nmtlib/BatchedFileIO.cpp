@@ -0,0 +1,343 @@
+#include "BatchedFileIO.h"
+
+#include "ReadFile.h"
+#include "WriteFile.h"
+
+#include "util/TaskScheduler.h"
+
+#ifdef NMT_HAVE_LIBURING
+#    include <fcntl.h>
+#    include <cerrno>
+#    include <cstring>
+#    include <liburing.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Same normalization as `ReadFile`, which reads line by line and terminates each line with '\n'.
+void TerminateLastLine(std::string& s) {
+    if (!s.empty() && s.back() != '\n') {
+        s += '\n';
+    }
+}
+
+std::vector<std::optional<std::string>> ReadFilesSync(std::span<const fs::path> paths) {
+    std::vector<std::optional<std::string>> result;
+    result.reserve(paths.size());
+    for (auto& p : paths) {
+        result.push_back(ReadFile(p));
+    }
+    return result;
+}
+
+std::vector<std::optional<fs::file_time_type>> LastWriteTimesSync(
+    std::span<const fs::path* const> paths) {
+    // Below this number of files per task scheduling the task costs more than it saves.
+    constexpr size_t k_minFilesPerTask = 512;
+    std::vector<std::optional<fs::file_time_type>> result(paths.size());
+    ParallelForRanges(paths.size(), k_minFilesPerTask, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            std::error_code ec;
+            auto lastWriteTime = fs::last_write_time(*paths[i], ec);
+            if (!ec) {
+                result[i] = lastWriteTime;
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<fs::path> WriteFilesSync(std::span<const FileToWrite*> files) {
+    std::vector<fs::path> failed;
+    for (auto* f : files) {
+        if (!WriteFile(f->path, f->content)) {
+            failed.push_back(f->path);
+        }
+    }
+    return failed;
+}
+
+#ifdef NMT_HAVE_LIBURING
+
+constexpr unsigned k_ringEntries = 256;
+
+class IoUring {
+   public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    ~IoUring() {
+        if (initialized) {
+            io_uring_queue_exit(&ring);
+        }
+    }
+
+    // Fails if the kernel doesn't support io_uring or it's disabled (e.g. seccomp, sysctl).
+    bool init() {
+        initialized = io_uring_queue_init(k_ringEntries, &ring, 0) == 0;
+        return initialized;
+    }
+
+    // Submit `count` operations in chunks of at most `k_ringEntries`, `prep(sqe, i)` prepares the
+    // i-th operation. Return `cqe->res` for each operation, or -ECANCELED if it wasn't run. Every
+    // submitted operation is completed before returning, the kernel doesn't write into the
+    // callers' buffers afterwards. If a submission fails the ring is not used any more: the
+    // remaining operations, also of the later calls, are not run.
+    template<class Prep>
+    std::vector<int> run(size_t count, Prep&& prep) {
+        std::vector<int> results(count, -ECANCELED);
+        for (size_t chunkBegin = 0; chunkBegin < count && !broken; chunkBegin += k_ringEntries) {
+            const size_t chunkEnd = std::min<size_t>(count, chunkBegin + k_ringEntries);
+            unsigned prepared = 0;
+            for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+                auto* sqe = io_uring_get_sqe(&ring);
+                if (!sqe) {
+                    break;
+                }
+                prep(sqe, i);
+                io_uring_sqe_set_data64(sqe, i);
+                ++prepared;
+            }
+            int submitted = io_uring_submit(&ring);
+            if (submitted < 0 || unsigned(submitted) != prepared) {
+                // The unsubmitted entries stay in the submission queue, a later submit would run
+                // them with the buffers of this call.
+                broken = true;
+            }
+            for (int j = 0; j < submitted; ++j) {
+                io_uring_cqe* cqe = nullptr;
+                int r;
+                do {
+                    r = io_uring_wait_cqe(&ring, &cqe);
+                } while (r == -EINTR || r == -EAGAIN);
+                LOG_IF(FATAL, r < 0) << fmt::format(
+                    "Can't complete the submitted io_uring operations: {}", strerror(-r));
+                results[io_uring_cqe_get_data64(cqe)] = cqe->res;
+                io_uring_cqe_seen(&ring, cqe);
+            }
+        }
+        return results;
+    }
+
+    // Close the valid (non-negative) file descriptors, synchronously the ones the ring didn't.
+    void closeAll(std::span<const int> fds) {
+        std::vector<int> validFds;
+        for (auto fd : fds) {
+            if (fd >= 0) {
+                validFds.push_back(fd);
+            }
+        }
+        auto results = run(validFds.size(), [&validFds](io_uring_sqe* sqe, size_t i) {
+            io_uring_prep_close(sqe, validFds[i]);
+        });
+        for (size_t i = 0; i < validFds.size(); ++i) {
+            if (results[i] == -ECANCELED) {
+                close(validFds[i]);
+            }
+        }
+    }
+
+   private:
+    io_uring ring{};
+    bool initialized = false;
+    bool broken = false;
+};
+
+// The files of a window are open at the same time, fewer than the default soft `RLIMIT_NOFILE`
+// (1024) leaves for the rest of the process.
+constexpr size_t k_filesPerWindow = k_ringEntries;
+
+// Read the files of a window: open and stat, read, then close them, each step in a single batch.
+void ReadWindowIoUring(IoUring& ring,
+                       std::span<const fs::path> paths,
+                       std::span<std::optional<std::string>> result) {
+    std::vector<std::string> nativePaths;
+    nativePaths.reserve(paths.size());
+    for (auto& p : paths) {
+        nativePaths.push_back(p.native());
+    }
+
+    // 2 operations per file.
+    std::vector<struct statx> stats(paths.size());
+    auto openStatResults = ring.run(2 * paths.size(), [&](io_uring_sqe* sqe, size_t i) {
+        auto fileIdx = i / 2;
+        if (i % 2 == 0) {
+            io_uring_prep_openat(sqe, AT_FDCWD, nativePaths[fileIdx].c_str(), O_RDONLY, 0);
+        } else {
+            io_uring_prep_statx(
+                sqe, AT_FDCWD, nativePaths[fileIdx].c_str(), 0, STATX_SIZE, &stats[fileIdx]);
+        }
+    });
+    std::vector<int> fds(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        fds[i] = openStatResults[2 * i];
+        if (fds[i] >= 0 && openStatResults[2 * i + 1] >= 0) {
+            result[i].emplace(size_t(stats[i].stx_size), '\0');
+        }
+    }
+
+    auto readResults = ring.run(paths.size(), [&](io_uring_sqe* sqe, size_t i) {
+        if (result[i]) {
+            io_uring_prep_read(sqe, fds[i], result[i]->data(), unsigned(result[i]->size()), 0);
+        } else {
+            io_uring_prep_nop(sqe);
+        }
+    });
+    ring.closeAll(fds);
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (result[i] && readResults[i] >= 0 && size_t(readResults[i]) == result[i]->size()) {
+            TerminateLastLine(*result[i]);
+            continue;
+        }
+        // Open or stat failed (e.g. EMFILE) or short read (the file changed between statx and
+        // read): fall back for this file, it's nullopt only if `ReadFile` can't read it either.
+        result[i] = ReadFile(paths[i]);
+    }
+}
+
+std::optional<std::vector<std::optional<std::string>>> ReadFilesIoUring(
+    std::span<const fs::path> paths) {
+    IoUring ring;
+    if (!ring.init()) {
+        return std::nullopt;
+    }
+    std::vector<std::optional<std::string>> result(paths.size());
+    for (size_t begin = 0; begin < paths.size(); begin += k_filesPerWindow) {
+        auto count = std::min(k_filesPerWindow, paths.size() - begin);
+        ReadWindowIoUring(
+            ring, paths.subspan(begin, count), std::span(result).subspan(begin, count));
+    }
+    return result;
+}
+
+// Write the files of a window: open, write, then close them, each step in a single batch. Append
+// the paths which couldn't be written to `failed`.
+void WriteWindowIoUring(IoUring& ring,
+                        std::span<const FileToWrite* const> files,
+                        std::vector<fs::path>& failed) {
+    std::vector<std::string> nativePaths;
+    nativePaths.reserve(files.size());
+    for (auto* f : files) {
+        nativePaths.push_back(f->path.native());
+    }
+    auto fds = ring.run(files.size(), [&](io_uring_sqe* sqe, size_t i) {
+        io_uring_prep_openat(
+            sqe, AT_FDCWD, nativePaths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    });
+    auto writeResults = ring.run(files.size(), [&](io_uring_sqe* sqe, size_t i) {
+        if (fds[i] >= 0) {
+            auto& content = files[i]->content;
+            io_uring_prep_write(sqe, fds[i], content.data(), unsigned(content.size()), 0);
+        } else {
+            io_uring_prep_nop(sqe);
+        }
+    });
+    ring.closeAll(fds);
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (fds[i] >= 0 && writeResults[i] >= 0
+            && size_t(writeResults[i]) == files[i]->content.size()) {
+            continue;
+        }
+        // Open failed or short write: retry with the synchronous path.
+        if (!WriteFile(files[i]->path, files[i]->content)) {
+            failed.push_back(files[i]->path);
+        }
+    }
+}
+
+std::optional<std::vector<fs::path>> WriteFilesIoUring(std::span<const FileToWrite*> files) {
+    IoUring ring;
+    if (!ring.init()) {
+        return std::nullopt;
+    }
+    std::vector<fs::path> failed;
+    for (size_t begin = 0; begin < files.size(); begin += k_filesPerWindow) {
+        WriteWindowIoUring(
+            ring, files.subspan(begin, std::min(k_filesPerWindow, files.size() - begin)), failed);
+    }
+    return failed;
+}
+
+std::optional<std::vector<std::optional<fs::file_time_type>>> LastWriteTimesIoUring(
+    std::span<const fs::path* const> paths) {
+    IoUring ring;
+    if (!ring.init()) {
+        return std::nullopt;
+    }
+    std::vector<struct statx> stats(paths.size());
+    auto statResults = ring.run(paths.size(), [&](io_uring_sqe* sqe, size_t i) {
+        io_uring_prep_statx(sqe, AT_FDCWD, paths[i]->c_str(), 0, STATX_MTIME, &stats[i]);
+    });
+    if (std::ranges::contains(statResults, -EINVAL)) {
+        return std::nullopt;  // The kernels before 5.6 don't support `IORING_OP_STATX`.
+    }
+    std::vector<std::optional<fs::file_time_type>> result(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (statResults[i] < 0) {
+            // Not only a missing file, the operation may not have been run (-ECANCELED): fall back
+            // for this file, it's nullopt only if it can't be stat-ed either.
+            std::error_code ec;
+            auto lastWriteTime = fs::last_write_time(*paths[i], ec);
+            if (!ec) {
+                result[i] = lastWriteTime;
+            }
+            continue;
+        }
+        // Same value as `fs::last_write_time` returns.
+        auto& t = stats[i].stx_mtime;
+        result[i] = std::chrono::file_clock::from_sys(
+            std::chrono::sys_time<std::chrono::nanoseconds>(std::chrono::seconds(t.tv_sec)
+                                                            + std::chrono::nanoseconds(t.tv_nsec)));
+    }
+    return result;
+}
+
+#endif
+
+}  // namespace
+
+std::vector<std::optional<std::string>> ReadFiles(std::span<const fs::path> paths) {
+#ifdef NMT_HAVE_LIBURING
+    if (auto r = ReadFilesIoUring(paths)) {
+        return std::move(*r);
+    }
+#endif
+    return ReadFilesSync(paths);
+}
+
+std::vector<fs::path> WriteFilesIfChanged(std::span<const FileToWrite> files) {
+    std::vector<fs::path> paths;
+    paths.reserve(files.size());
+    for (auto& f : files) {
+        paths.push_back(f.path);
+    }
+    auto existingContents = ReadFiles(paths);
+    std::vector<const FileToWrite*> changedFiles;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (existingContents[i] != files[i].content) {
+            changedFiles.push_back(&files[i]);
+        }
+    }  // Else no change, no need to write.
+#ifdef NMT_HAVE_LIBURING
+    if (auto r = WriteFilesIoUring(changedFiles)) {
+        return std::move(*r);
+    }
+#endif
+    return WriteFilesSync(changedFiles);
+}
+
+std::vector<std::optional<fs::file_time_type>> LastWriteTimes(
+    std::span<const fs::path* const> paths) {
+#ifdef NMT_HAVE_LIBURING
+    if (auto r = LastWriteTimesIoUring(paths)) {
+        return std::move(*r);
+    }
+#endif
+    return LastWriteTimesSync(paths);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Batched versions of `ReadFile`, `WriteFile` and `fs::last_write_time`. With the io_uring backend
+// (Linux, liburing found at configure time) the operations of a batch are submitted together,
+// otherwise, or if the ring can't be created at runtime, they fall back to one call per path.
+
+struct FileToWrite {
+    std::filesystem::path path;
+    std::string content;
+};
+
+/// Result[i] is the content of `paths[i]`, or nullopt if it couldn't be read. The content is the
+/// same as what `ReadFile` would return.
+std::vector<std::optional<std::string>> ReadFiles(std::span<const std::filesystem::path> paths);
+
+/// Write the files which don't exist or have a different content. Return the paths which couldn't
+/// be written.
+[[nodiscard]] std::vector<std::filesystem::path> WriteFilesIfChanged(
+    std::span<const FileToWrite> files);
+
+/// Result[i] is the last write time of `*paths[i]`, or nullopt if it couldn't be queried. Without
+/// io_uring the files are stat-ed on the shared `TaskScheduler` if there are many of them.
+std::vector<std::optional<std::filesystem::file_time_type>> LastWriteTimes(
+    std::span<const std::filesystem::path* const> paths);
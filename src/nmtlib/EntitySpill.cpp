@@ -0,0 +1,191 @@
+#include "EntitySpill.h"
+
+#include <cstring>
+#include <random>
+
+namespace fs = std::filesystem;
+namespace DP = EntityDependentProperties;
+
+namespace {
+// The fields of the dependent properties in the order they're written to the records.
+template<class T>
+auto Fields(T& dp) {
+    using U = std::remove_const_t<T>;
+    if constexpr (std::is_same_v<U, DP::Enum>) {
+        return std::tie(
+            dp.opaqueEnumDeclaration, dp.opaqueEnumDeclarationNeeds, dp.declarationNeeds);
+    } else if constexpr (std::is_same_v<U, DP::Fn> || std::is_same_v<U, DP::MemFn>) {
+        return std::tie(
+            dp.declaration, dp.declarationNeeds, dp.definitionNeeds, dp.forwardDeclarableNeeds);
+    } else if constexpr (std::is_same_v<U, DP::StructOrClass>) {
+        return std::tie(dp.forwardDeclaration,
+                        dp.forwardDeclarationNeeds,
+                        dp.declarationNeeds,
+                        dp.forwardDeclarableNeeds,
+                        dp.memberFunctions);
+    } else {
+        static_assert(std::is_same_v<U, DP::Header>);
+        return std::tie(dp.declarationNeeds, dp.forwardDeclarableNeeds);
+    }
+}
+
+// Record: the variant index, then the fields. Strings and containers are prefixed with their size.
+struct RecordWriter {
+    std::string record;
+
+    void writeSize(size_t size) {
+        auto s = uint32_t(size);
+        record.append(reinterpret_cast<const char*>(&s), sizeof(s));
+    }
+    void write(const std::string& s) {
+        writeSize(s.size());
+        record += s;
+    }
+    void write(const std::vector<std::string>& v) {
+        writeSize(v.size());
+        for (auto& s : v) {
+            write(s);
+        }
+    }
+    void write(const flat_hash_map<std::string, MemberFunction>& m) {
+        writeSize(m.size());
+        for (auto& [name, _] : m) {
+            write(name);
+        }
+    }
+};
+
+struct RecordReader {
+    std::string_view record;
+
+    size_t readSize() {
+        uint32_t s;
+        CHECK(record.size() >= sizeof(s)) << "Truncated entity spill record.";
+        std::memcpy(&s, record.data(), sizeof(s));
+        record.remove_prefix(sizeof(s));
+        return s;
+    }
+    void read(std::string& s) {
+        auto size = readSize();
+        CHECK(record.size() >= size) << "Truncated entity spill record.";
+        s.assign(record.substr(0, size));
+        record.remove_prefix(size);
+    }
+    void read(std::vector<std::string>& v) {
+        v.resize(readSize());
+        for (auto& s : v) {
+            read(s);
+        }
+    }
+    void read(flat_hash_map<std::string, MemberFunction>& m) {
+        auto size = readSize();
+        m.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            std::string name;
+            read(name);
+            m.emplace(std::move(name), MemberFunction{});
+        }
+    }
+};
+
+// `dp.emplace<index>()`, the alternatives are not unique types (struct, class).
+template<size_t... Is>
+void EmplaceAlternative(DP::V& dp, size_t index, std::index_sequence<Is...>) {
+    ((index == Is ? (void)dp.emplace<Is>() : void()), ...);
+}
+}  // namespace
+
+std::expected<std::shared_ptr<EntitySpill>, std::string> EntitySpill::Create(
+    int64_t cacheCapBytes) {
+    std::error_code ec;
+    auto dir = fs::temp_directory_path(ec);
+    if (ec) {
+        return std::unexpected(
+            fmt::format("Can't get the temporary directory, reason: {}", ec.message()));
+    }
+    auto path = dir / fmt::format("nmt-entities-{:016x}.bin", std::random_device()());
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return std::unexpected(fmt::format("Can't create the entity spill file `{}`", path));
+    }
+    return std::shared_ptr<EntitySpill>(
+        new EntitySpill(std::move(path), std::move(file), cacheCapBytes));
+}
+
+EntitySpill::EntitySpill(fs::path path, std::fstream file, int64_t cacheCapBytes)
+    : _path(std::move(path))
+    , _cacheCapBytes(cacheCapBytes)
+    , _file(std::move(file)) {
+}
+
+EntitySpill::~EntitySpill() {
+    _file.close();
+    std::error_code ec;
+    fs::remove(_path, ec);
+}
+
+Entities::SpilledProps EntitySpill::append(DP::V& dependentProps) {
+    RecordWriter w;
+    w.record += char(dependentProps.index());
+    std::visit(
+        [&w](const auto& dp) {
+            std::apply(
+                [&w](const auto&... fields) {
+                    (w.write(fields), ...);
+                },
+                Fields(dp));
+        },
+        dependentProps);
+    EmplaceAlternative(dependentProps,
+                       dependentProps.index(),
+                       std::make_index_sequence<std::variant_size_v<DP::V>>());
+    std::lock_guard lock(_mutex);
+    Entities::SpilledProps sp{.offset = _fileBytes, .size = uint32_t(w.record.size())};
+    _file.seekp(std::streamoff(_fileBytes));
+    _file.write(w.record.data(), std::streamsize(w.record.size()));
+    LOG_IF(FATAL, !_file.good()) << fmt::format("Couldn't write {}.", _path);
+    _fileBytes += w.record.size();
+    return sp;
+}
+
+const Entity& EntitySpill::load(const Entity& summary, Entities::SpilledProps sp) {
+    std::lock_guard lock(_mutex);
+    if (auto it = _cache.find(sp.offset); it != _cache.end()) {
+        return it->second;
+    }
+    std::string record(sp.size, '\0');
+    _file.seekg(std::streamoff(sp.offset));
+    _file.read(record.data(), std::streamsize(record.size()));
+    LOG_IF(FATAL, !_file.good()) << fmt::format("Couldn't read {}.", _path);
+    CHECK(!record.empty() && size_t(uint8_t(record[0])) < std::variant_size_v<DP::V>);
+    Entity e = summary;
+    EmplaceAlternative(e.dependentProps,
+                       size_t(uint8_t(record[0])),
+                       std::make_index_sequence<std::variant_size_v<DP::V>>());
+    RecordReader r{std::string_view(record).substr(1)};
+    std::visit(
+        [&r](auto& dp) {
+            std::apply(
+                [&r](auto&... fields) {
+                    (r.read(fields), ...);
+                },
+                Fields(dp));
+        },
+        e.dependentProps);
+    // The records are about as large as the heap memory of the fields.
+    _cacheBytes += int64_t(sizeof(Entity) + record.size());
+    return _cache.emplace(sp.offset, std::move(e)).first->second;
+}
+
+void EntitySpill::trimCache() {
+    std::lock_guard lock(_mutex);
+    if (_cacheBytes > _cacheCapBytes) {
+        _cache.clear();
+        _cacheBytes = 0;
+    }
+}
+
+int64_t EntitySpill::fileBytes() const {
+    std::lock_guard lock(_mutex);
+    return int64_t(_fileBytes);
+}
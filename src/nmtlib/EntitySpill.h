@@ -0,0 +1,45 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/base_types.h"
+
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// The dependent properties of the entities spilled by `Entities` in streaming mode, in an
+// append-only temporary file, and a cache of the entities loaded back from it. Thread safe.
+class EntitySpill {
+   public:
+    /// Create the temporary file. `cacheCapBytes` is an estimate, see `trimCache()`.
+    static std::expected<std::shared_ptr<EntitySpill>, std::string> Create(int64_t cacheCapBytes);
+    EntitySpill(const EntitySpill&) = delete;
+    EntitySpill& operator=(const EntitySpill&) = delete;
+    /// Remove the temporary file.
+    ~EntitySpill();
+
+    /// Write `dependentProps` and reset them to the default value of the same alternative, which
+    /// still tells the kind of the entity.
+    Entities::SpilledProps append(EntityDependentProperties::V& dependentProps);
+    /// `summary` with the dependent properties loaded from `sp`. The reference is valid until the
+    /// next `trimCache()`.
+    const Entity& load(const Entity& summary, Entities::SpilledProps sp);
+    /// Drop the loaded entities if they're over the cap. No reference returned by `load()` can be
+    /// held while calling it.
+    void trimCache();
+    int64_t fileBytes() const;
+
+   private:
+    EntitySpill(std::filesystem::path path, std::fstream file, int64_t cacheCapBytes);
+
+    const std::filesystem::path _path;
+    const int64_t _cacheCapBytes;
+    mutable std::mutex _mutex;
+    std::fstream _file;
+    uint64_t _fileBytes = 0;
+    node_hash_map<uint64_t, Entity> _cache;  // By `SpilledProps::offset`.
+    int64_t _cacheBytes = 0;
+};
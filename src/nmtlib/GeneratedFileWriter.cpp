@@ -1,10 +1,31 @@
 #include "GeneratedFileWriter.h"
 
 #include "ReadFile.h"
-#include "WriteFile.h"
+
+#include "nmt/constants.h"
+#include "util/StableHash.h"
 
 namespace fs = std::filesystem;
 
+flat_hash_map<fs::path, uint64_t, path_hash> ReadFingerprints(const fs::path& outputDir) {
+    flat_hash_map<fs::path, uint64_t, path_hash> fingerprints;
+    // Lines: `<hash> <absolute path>`. Malformed lines are ignored, they only cause the file to be
+    // produced again.
+    if (auto content = ReadFile(outputDir / k_fingerprintsFilename)) {
+        for (auto line : std::views::split(*content, '\n')) {
+            std::string_view sv(line.begin(), line.end());
+            auto spaceIdx = sv.find(' ');
+            if (spaceIdx == std::string_view::npos) {
+                continue;
+            }
+            if (auto fp = ParseStableHashString(sv.substr(0, spaceIdx))) {
+                fingerprints[path_from_string(sv.substr(spaceIdx + 1))] = *fp;
+            }
+        }
+    }
+    return fingerprints;
+}
+
 GeneratedFileWriter::GeneratedFileWriter(fs::path outputDir_)
     : outputDir(std::move(outputDir_)) {
     std::error_code ec;
@@ -24,12 +45,16 @@ GeneratedFileWriter::GeneratedFileWriter(fs::path outputDir_)
             remainingExistingFiles.insert(de.path());
         }
     }
+
+    previousFingerprints = ReadFingerprints(outputDir);
 }
 GeneratedFileWriter::~GeneratedFileWriter() {
-    assert(remainingExistingFiles.empty() && remainingExistingDirs.empty());
+    assert(remainingExistingFiles.empty() && remainingExistingDirs.empty()
+           && pendingWrites.empty());
+    Flush();
     RemoveRemainingExistingFilesAndDirs();
 }
-void GeneratedFileWriter::Write(const fs::path& relPath, std::string_view content) {
+fs::path GeneratedFileWriter::AddFile(const fs::path& relPath) {
     // Create all parent directories.
     auto relDir = relPath;
     bool firstParent = true;
@@ -46,11 +71,85 @@ void GeneratedFileWriter::Write(const fs::path& relPath, std::string_view conten
 
     auto path = outputDir / relPath;
     remainingExistingFiles.erase(path);
+    return path;
+}
+fs::path GeneratedFileWriter::AddCurrentFile(const fs::path& relPath) {
+    auto path = AddFile(relPath);
     currentFiles.push_back(path);
-    auto existingContent = ReadFile(path);
-    if (existingContent != content) {
-        LOG_IF(FATAL, !WriteFile(path, content)) << fmt::format("Couldn't write {}.", path);
-    }  // Else no change, no need to write.
+    return path;
+}
+void GeneratedFileWriter::Write(const fs::path& relPath,
+                                std::string_view content,
+                                std::optional<uint64_t> fingerprint) {
+    auto path = AddCurrentFile(relPath);
+    if (fingerprint) {
+        currentFingerprints[path] = *fingerprint;
+        fingerprintsDirty = true;
+    }
+    QueueWrite(std::move(path), content);
+}
+void GeneratedFileWriter::WriteNonSource(const fs::path& relPath, std::string_view content) {
+    QueueWrite(AddFile(relPath), content);
+}
+void GeneratedFileWriter::QueueWrite(fs::path path, std::string_view content) {
+    pendingWrites.push_back(FileToWrite{.path = std::move(path), .content = std::string(content)});
+    // Large enough for the io_uring batches to pay off.
+    constexpr size_t k_backgroundWriteBatchSize = 256;
+    if (pendingWrites.size() >= k_backgroundWriteBatchSize) {
+        StartPendingWrites();
+    }
+}
+void GeneratedFileWriter::StartPendingWrites() {
+    WaitForInFlightWrites();
+    inFlightWrites = std::async(std::launch::async, [files = std::move(pendingWrites)] {
+        return WriteFilesIfChanged(files);
+    });
+    pendingWrites.clear();
+}
+void GeneratedFileWriter::WaitForInFlightWrites() {
+    if (!inFlightWrites.valid()) {
+        return;
+    }
+    auto failedPaths = inFlightWrites.get();
+    LOG_IF(FATAL, !failedPaths.empty())
+        << fmt::format("Couldn't write {}.", fmt::join(failedPaths, ", "));
+}
+bool GeneratedFileWriter::IsUnchanged(const fs::path& relPath, uint64_t fingerprint) const {
+    auto path = outputDir / relPath;
+    auto it = previousFingerprints.find(path);
+    return it != previousFingerprints.end() && it->second == fingerprint
+           && remainingExistingFiles.contains(path);
+}
+void GeneratedFileWriter::Keep(const fs::path& relPath, uint64_t fingerprint) {
+    DCHECK(IsUnchanged(relPath, fingerprint));
+    currentFingerprints[AddCurrentFile(relPath)] = fingerprint;
+    fingerprintsDirty = true;
+}
+void GeneratedFileWriter::DropFingerprint(const fs::path& relPath) {
+    if (currentFingerprints.erase(outputDir / relPath) > 0) {
+        fingerprintsDirty = true;
+    }
+}
+void GeneratedFileWriter::Flush() {
+    if (fingerprintsDirty) {
+        // Not a generated source, it's not added to `currentFiles`.
+        std::vector<std::string> lines;
+        lines.reserve(currentFingerprints.size());
+        for (auto& [path, fp] : currentFingerprints) {
+            lines.push_back(fmt::format("{} {}\n", StableHashToString(fp), path_to_string(path)));
+        }
+        std::ranges::sort(lines);
+        auto path = outputDir / k_fingerprintsFilename;
+        remainingExistingFiles.erase(path);
+        pendingWrites.push_back(
+            FileToWrite{.path = std::move(path), .content = fmt::format("{}", fmt::join(lines, ""))});
+        fingerprintsDirty = false;
+    }
+    WaitForInFlightWrites();
+    auto failedPaths = WriteFilesIfChanged(pendingWrites);
+    LOG_IF(FATAL, !failedPaths.empty())
+        << fmt::format("Couldn't write {}.", fmt::join(failedPaths, ", "));
+    pendingWrites.clear();
 }
 void GeneratedFileWriter::RemoveRemainingExistingFilesAndDirs() {
     std::error_code ec;
@@ -1,7 +1,16 @@
 #pragma once
 
+#include "BatchedFileIO.h"
+
 #include "nmt/base_types.h"
 
+#include <future>
+
+// Load the fingerprints written to `k_fingerprintsFilename` in `outputDir` by the previous run,
+// keyed by absolute path. Empty if there's no such file.
+flat_hash_map<std::filesystem::path, uint64_t, path_hash> ReadFingerprints(
+    const std::filesystem::path& outputDir);
+
 struct GeneratedFileWriter {
     explicit GeneratedFileWriter(std::filesystem::path outputDir_);
     GeneratedFileWriter(const GeneratedFileWriter&) = delete;
@@ -9,12 +18,38 @@ struct GeneratedFileWriter {
         : outputDir(std::move(y.outputDir))
         , remainingExistingFiles(std::move(y.remainingExistingFiles))
         , currentFiles(std::move(y.currentFiles))
-        , remainingExistingDirs(std::move(y.remainingExistingDirs)) {
+        , remainingExistingDirs(std::move(y.remainingExistingDirs))
+        , pendingWrites(std::move(y.pendingWrites))
+        , inFlightWrites(std::move(y.inFlightWrites))
+        , previousFingerprints(std::move(y.previousFingerprints))
+        , currentFingerprints(std::move(y.currentFingerprints))
+        , fingerprintsDirty(y.fingerprintsDirty) {
         y.remainingExistingFiles.clear();
         y.remainingExistingDirs.clear();
+        y.pendingWrites.clear();
+        y.fingerprintsDirty = false;
     }
     ~GeneratedFileWriter();
-    void Write(const std::filesystem::path& relPath, std::string_view content);
+    // The file is written later, if its content has changed: in the background once enough writes
+    // are pending, so writing overlaps producing the next files, or in `Flush()`. The optional
+    // `fingerprint` identifies the inputs the content was produced from, see `IsUnchanged()`.
+    void Write(const std::filesystem::path& relPath,
+               std::string_view content,
+               std::optional<uint64_t> fingerprint = std::nullopt);
+    // Like `Write()` but the file is not added to `currentFiles`, so it's not listed in
+    // `k_fileListFilename` as a source of the target. Still kept by
+    // `RemoveRemainingExistingFilesAndDirs()`.
+    void WriteNonSource(const std::filesystem::path& relPath, std::string_view content);
+    // True if the file exists and was written with the same fingerprint by the previous run, so
+    // it doesn't need to be produced again, only `Keep()`-ed.
+    bool IsUnchanged(const std::filesystem::path& relPath, uint64_t fingerprint) const;
+    // Keep an unchanged file as if it were written again.
+    void Keep(const std::filesystem::path& relPath, uint64_t fingerprint);
+    // Forget the fingerprint of a file whose entity failed to be produced, so the next run
+    // produces it again instead of keeping it.
+    void DropFingerprint(const std::filesystem::path& relPath);
+    // Read, compare and write the pending files (and the fingerprints) in a single batch.
+    void Flush();
     void RemoveRemainingExistingFilesAndDirs();
 
     // All paths should be absolute.
@@ -22,4 +57,21 @@ struct GeneratedFileWriter {
     flat_hash_set<std::filesystem::path, path_hash> remainingExistingFiles;
     std::vector<std::filesystem::path> currentFiles;
     flat_hash_set<std::filesystem::path, path_hash> remainingExistingDirs;
+    std::vector<FileToWrite> pendingWrites;
+    // The batch of `pendingWrites` being written in the background, result: the failed paths.
+    std::future<std::vector<std::filesystem::path>> inFlightWrites;
+    // Keyed by absolute path. The previous ones are loaded from `k_fingerprintsFilename`.
+    flat_hash_map<std::filesystem::path, uint64_t, path_hash> previousFingerprints,
+        currentFingerprints;
+    bool fingerprintsDirty = false;
+
+   private:
+    // Keep the file and its parent directories, creating the directories.
+    std::filesystem::path AddFile(const std::filesystem::path& relPath);
+    // Like `AddFile()`, also registers the file as current.
+    std::filesystem::path AddCurrentFile(const std::filesystem::path& relPath);
+    // Queue the write, start the pending writes in the background if there are enough of them.
+    void QueueWrite(std::filesystem::path path, std::string_view content);
+    void StartPendingWrites();
+    void WaitForInFlightWrites();
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+// Estimates of the heap memory held by containers, for diagnostics (`--stats`). They don't account
+// for allocator overhead and use the capacity, not the size, of the containers.
+
+#include "nmt/base_types.h"
+
+inline int64_t HeapBytes(const std::string& s) {
+    // Short strings live in the object itself. The SSO capacity is implementation defined, the
+    // capacity of a default constructed string is a good approximation.
+    static const size_t k_ssoCapacity = std::string().capacity();
+    return s.capacity() > k_ssoCapacity ? int64_t(s.capacity() + 1) : 0;
+}
+
+inline int64_t HeapBytes(const std::filesystem::path& p) {
+    static const size_t k_ssoCapacity = std::filesystem::path::string_type().capacity();
+    auto c = p.native().capacity();
+    return c > k_ssoCapacity ? int64_t((c + 1) * sizeof(std::filesystem::path::value_type)) : 0;
+}
+
+template<class T>
+int64_t HeapBytes(const std::vector<T>& v) {
+    int64_t bytes = int64_t(v.capacity() * sizeof(T));
+    if constexpr (!std::is_trivially_copyable_v<T>) {
+        for (auto& x : v) {
+            bytes += HeapBytes(x);
+        }
+    }
+    return bytes;
+}
+
+template<class T>
+int64_t HeapBytes(const std::optional<T>& x) {
+    return x ? HeapBytes(*x) : 0;
+}
+
+// The object allocated by `std::make_shared`, without the heap memory held by the object.
+template<class T>
+int64_t SharedPtrBytes(const std::shared_ptr<T>&) {
+    return int64_t(sizeof(T) + 2 * sizeof(long) + sizeof(void*));  // + reference counts, vtable.
+}
+
+// The buckets and nodes of a hash map, without the heap memory held by the keys and values.
+template<class Map>
+int64_t NodeHashMapBytes(const Map& m) {
+    using V = typename Map::value_type;
+    return int64_t(m.bucket_count() * sizeof(void*) + m.size() * (sizeof(V) + sizeof(void*)));
+}
+
+// The slots of a hash map, without the heap memory held by the keys and values.
+template<class Map>
+int64_t FlatHashMapBytes(const Map& m) {
+#ifdef NDEBUG
+    using V = typename Map::value_type;
+    return int64_t(m.bucket_count() * (sizeof(V) + 1));  // +1: control byte.
+#else
+    return NodeHashMapBytes(m);  // flat_hash_map is std::unordered_map, see base_types.h.
+#endif
+}
@@ -38,10 +38,12 @@ std::string JoinTokensWithoutComments(
 }
 // Expected: ... <name> `(` ... `)` ... `{` ... `}` for free functions, or
 //           ... <classname> `::` <name> `(` ... `)` ... `{` ... `}` for member functions.
+// `declarationTokens`, if not null, is set to the tokens of the declaration.
 std::expected<std::string, std::string> ExtractFunctionDeclaration(
     std::optional<std::string_view> className,
     std::string_view name,
-    std::span<const libtokenizer::Token> tokens0) {
+    std::span<const libtokenizer::Token> tokens0,
+    std::span<const libtokenizer::Token>* declarationTokens = nullptr) {
     using libtokenizer::Token;
     using libtokenizer::TokenType;
     size_t openingParenIdx = SIZE_T_MAX;
@@ -120,9 +122,182 @@ std::expected<std::string, std::string> ExtractFunctionDeclaration(
     } else {
         endIdx = openingBraceIdx;
     }
-    return JoinTokensWithoutComments(std::span<const Token>(tokens0.data(), tokens.data() + endIdx),
-                                     exceptTokens)
-         + ';';
+    auto declaration = std::span<const Token>(tokens0.data(), tokens.data() + endIdx);
+    if (declarationTokens) {
+        *declarationTokens = declaration;
+    }
+    return JoinTokensWithoutComments(declaration, exceptTokens) + ';';
+}
+
+// The plain-name needs (`Foo`, `ns::Foo`) of `needs` whose every use in `tokens` is one where an
+// incomplete type will do, sorted. A use is the last component of the name as an identifier token.
+// In a function declaration that's any use except in a nested name (`Foo::`), a template argument
+// list (`Foo<`) or an expression (`Foo(`, `Foo{`, default arguments, `decltype`, `sizeof`,
+// `alignof`, `noexcept`). Elsewhere it's a pointer or a reference (`Foo*`, `Foo const&`), unless
+// the tokens contain a function body, which may use the pointee without naming its type. The needs
+// without a use are left out, they may be used through macros.
+std::vector<std::string> ForwardDeclarableNeeds(const std::vector<std::string>& needs,
+                                                std::span<const libtokenizer::Token> tokens,
+                                                bool functionDeclaration) {
+    using libtokenizer::Token;
+    using libtokenizer::TokenType;
+    std::vector<const Token*> ts;  // Without the comments.
+    for (auto& t : tokens) {
+        if (!t.IsComment()) {
+            ts.push_back(&t);
+        }
+    }
+    auto isTok = [&ts](size_t i, std::string_view text) {
+        return i < ts.size() && ts[i]->type == TokenType::tok && ts[i]->sourceValue == text;
+    };
+    auto isKw = [&ts](size_t i, std::string_view text) {
+        return i < ts.size() && ts[i]->type == TokenType::kw && ts[i]->sourceValue == text;
+    };
+
+    // Mark the tokens in expressions. For each open paren: whether it starts an expression.
+    std::vector<bool> inExpression(ts.size()), parens;
+    std::optional<size_t> defaultArgumentDepth;  // The paren depth of the `=`.
+    bool hasFunctionBody = false;
+    for (size_t i = 0; i < ts.size(); ++i) {
+        inExpression[i] = defaultArgumentDepth || std::ranges::contains(parens, true);
+        if (isTok(i, "(")) {
+            parens.push_back(inExpression[i]
+                             || (i > 0
+                                 && (isKw(i - 1, "decltype") || isKw(i - 1, "sizeof")
+                                     || isKw(i - 1, "alignof") || isKw(i - 1, "noexcept"))));
+        } else if (isTok(i, ")")) {
+            if (!parens.empty()) {
+                parens.pop_back();
+            }
+            if (defaultArgumentDepth && parens.size() < *defaultArgumentDepth) {
+                defaultArgumentDepth.reset();
+            }
+        } else if (isTok(i, "=") && !parens.empty() && !defaultArgumentDepth) {
+            defaultArgumentDepth = parens.size();
+        } else if (isTok(i, ",") && defaultArgumentDepth == parens.size()) {
+            defaultArgumentDepth.reset();
+        } else if (isTok(i, "{")) {
+            // `) const noexcept override {`, the body of a function or a lambda.
+            auto j = i;
+            while (j > 0
+                   && (isKw(j - 1, "const") || isKw(j - 1, "noexcept") || isTok(j - 1, "&")
+                       || isTok(j - 1, "&&")
+                       || (ts[j - 1]->type == TokenType::id
+                           && (ts[j - 1]->sourceValue == "override"
+                               || ts[j - 1]->sourceValue == "final")))) {
+                --j;
+            }
+            hasFunctionBody = hasFunctionBody || (j > 0 && isTok(j - 1, ")"));
+        }
+    }
+    if (!functionDeclaration && hasFunctionBody) {
+        return {};
+    }
+
+    auto usedOnlyIncomplete = [&](std::string_view identifier) {
+        bool used = false;
+        for (size_t i = 0; i < ts.size(); ++i) {
+            if (ts[i]->type != TokenType::id || ts[i]->sourceValue != identifier) {
+                continue;
+            }
+            used = true;
+            if (functionDeclaration) {
+                if (inExpression[i] || isTok(i + 1, "::") || isTok(i + 1, "<")
+                    || isTok(i + 1, "(") || isTok(i + 1, "{")) {
+                    return false;
+                }
+            } else {
+                auto j = i + 1;
+                while (isKw(j, "const") || isKw(j, "volatile")) {
+                    ++j;
+                }
+                if (!isTok(j, "*") && !isTok(j, "&") && !isTok(j, "&&")) {
+                    return false;
+                }
+            }
+        }
+        return used;
+    };
+    std::vector<std::string> result;
+    for (auto& need : needs) {
+        if (need.empty() || need[0] == '<' || need[0] == '"' || need.back() == '*'
+            || need.starts_with("struct ") || need.starts_with("class ")
+            || need.starts_with("enum ")) {
+            continue;
+        }
+        std::string_view identifier = need;
+        if (auto i = identifier.rfind("::"); i != std::string_view::npos) {
+            identifier.remove_prefix(i + 2);
+        }
+        if (isCIdentifier(identifier) && usedOnlyIncomplete(identifier)) {
+            result.push_back(need);
+        }
+    }
+    sort_unique_inplace(result);
+    return result;
+}
+
+// The tokens from the first special comment to the end.
+std::span<const libtokenizer::Token> TokensFromFirstSpecialComment(const PreprocessedSource& pps) {
+    CHECK(!pps.specialComments.empty());
+    auto firstSpecialCommentKeyword = pps.specialComments.front().keyword;
+
+    auto it = std::ranges::lower_bound(
+        pps.tokens.tokens, firstSpecialCommentKeyword.data(), {}, [](const libtokenizer::Token& t) {
+            return t.sourceValue.data();
+        });
+    CHECK(it != pps.tokens.tokens.end()
+          && data_plus_size(firstSpecialCommentKeyword) <= data_plus_size(it->sourceValue));
+    return std::span<const libtokenizer::Token>(it, pps.tokens.tokens.end());
+}
+
+// The qualified names (`Foo`, `ns::Foo`, `::ns::Foo`) in `tokens`, sorted: the identifiers and the
+// identifiers joined by `::`. The members accessed with `.` or `->` and the names nested in a
+// template specialization (`Foo<int>::Bar`) are left out.
+std::vector<std::string> QualifiedNames(std::span<const libtokenizer::Token> tokens) {
+    using libtokenizer::Token;
+    using libtokenizer::TokenType;
+    std::vector<const Token*> ts;  // Without the comments.
+    for (auto& t : tokens) {
+        if (!t.IsComment()) {
+            ts.push_back(&t);
+        }
+    }
+    auto isTok = [&ts](size_t i, std::string_view text) {
+        return i < ts.size() && ts[i]->type == TokenType::tok && ts[i]->sourceValue == text;
+    };
+    auto isId = [&ts](size_t i) {
+        return i < ts.size() && ts[i]->type == TokenType::id;
+    };
+    std::vector<std::string> result;
+    for (size_t i = 0; i < ts.size(); ++i) {
+        std::string name;
+        auto j = i;
+        if (isTok(i, "::")) {
+            if (i > 0 && (isId(i - 1) || isTok(i - 1, ">"))) {
+                continue;
+            }
+            name = "::";
+            ++j;
+        } else if (i > 0 && (isTok(i - 1, "::") || isTok(i - 1, ".") || isTok(i - 1, "->"))) {
+            continue;
+        }
+        if (!isId(j)) {
+            continue;
+        }
+        for (;;) {
+            name += ts[j]->sourceValue;
+            if (!isTok(j + 1, "::") || !isId(j + 2)) {
+                break;
+            }
+            name += "::";
+            j += 2;
+        }
+        result.push_back(std::move(name));
+        i = j;
+    }
+    sort_unique_inplace(result);
+    return result;
 }
 
 struct Collector {
@@ -189,7 +364,18 @@ std::expected<Collector, std::vector<std::string>> collectSpecialComments(
                                                      fmt::join(sc.list, ", ")));
                         break;
                     }
-                    c.namespace_ = path_from_string(sc.list.front());
+                    {
+                        std::string_view ns = sc.list.front();
+                        if (ns.starts_with("::")) {
+                            ns.remove_prefix(2);  // Namespaces are always absolute.
+                        }
+                        if (!isQualifiedCIdentifier(ns)) {
+                            errors.push_back(
+                                fmt::format("Invalid `#namespace` value: {}", sc.list.front()));
+                            break;
+                        }
+                        c.namespace_ = std::string(ns);
+                    }
                     break;
             }
         } else if (auto entityKind = enum_from_name<EntityKind>(sc.keyword)) {
@@ -231,23 +417,10 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
     sort_unique_inplace(c.fdneeds);
     sort_unique_inplace(c.needs);
     sort_unique_inplace(c.defneeds);
-    CHECK(!pps.specialComments.empty());
-    // Find the token corresponding to the first specialComment.
-    auto firstSpecialCommentKeyword = pps.specialComments.front().keyword;
-
-    auto it = std::ranges::lower_bound(
-        pps.tokens.tokens, firstSpecialCommentKeyword.data(), {}, [](const libtokenizer::Token& t) {
-            return t.sourceValue.data();
-        });
-    CHECK(it != pps.tokens.tokens.end()
-          && data_plus_size(firstSpecialCommentKeyword) <= data_plus_size(it->sourceValue));
-
-    auto firstSpecialCommentTokenIdx = it - pps.tokens.tokens.begin();
 
     using libtokenizer::Token;
     using libtokenizer::TokenType;
-    auto tokensFromFirstSpecialComment = std::span<const Token>(
-        pps.tokens.tokens.begin() + firstSpecialCommentTokenIdx, pps.tokens.tokens.end());
+    auto tokensFromFirstSpecialComment = TokensFromFirstSpecialComment(pps);
 
     struct {
         bool fdneeds{}, needs{}, defneeds{};
@@ -311,15 +484,20 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
                 return std::unexpected(make_vector(std::move(cnr.error())));
             }
             // Expected: ... name ( ... ) ... { ... }
+            std::span<const Token> declarationTokens;
             TRY_ASSIGN_OR_RETURN_VALUE(
                 declaration,
-                ExtractFunctionDeclaration(std::nullopt, name, tokensFromFirstSpecialComment),
+                ExtractFunctionDeclaration(
+                    std::nullopt, name, tokensFromFirstSpecialComment, &declarationTokens),
                 std::unexpected(make_vector(std::move(UNEXPECTED_ERROR))));
+            auto forwardDeclarableNeeds = ForwardDeclarableNeeds(c.needs, declarationTokens, true);
             dependentProps.emplace(
                 std::in_place_index<std::to_underlying(EntityKind::fn)>,
-                EntityDependentProperties::Fn{.declaration = std::move(declaration),
-                                              .declarationNeeds = std::move(c.needs),
-                                              .definitionNeeds = std::move(c.defneeds)});
+                EntityDependentProperties::Fn{
+                    .declaration = std::move(declaration),
+                    .declarationNeeds = std::move(c.needs),
+                    .definitionNeeds = std::move(c.defneeds),
+                    .forwardDeclarableNeeds = std::move(forwardDeclarableNeeds)});
         } break;
         case EntityKind::struct_: {
             allowed.fdneeds = true;
@@ -332,11 +510,15 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
             // TRY_ASSIGN(declaration, ExtractClassOrStructDeclaration(StructOrClass::struct_, name,
             // tokensFromFirstSpecialComment));
             auto declaration = fmt::format("struct {};", name);
-            dependentProps.emplace(std::in_place_index<std::to_underlying(EntityKind::struct_)>,
-                                   EntityDependentProperties::StructOrClass{
-                                       .forwardDeclaration = std::move(declaration),
-                                       .forwardDeclarationNeeds = std::move(c.fdneeds),
-                                       .declarationNeeds = std::move(c.needs)});
+            auto forwardDeclarableNeeds =
+                ForwardDeclarableNeeds(c.needs, tokensFromFirstSpecialComment, false);
+            dependentProps.emplace(
+                std::in_place_index<std::to_underlying(EntityKind::struct_)>,
+                EntityDependentProperties::StructOrClass{
+                    .forwardDeclaration = std::move(declaration),
+                    .forwardDeclarationNeeds = std::move(c.fdneeds),
+                    .declarationNeeds = std::move(c.needs),
+                    .forwardDeclarableNeeds = std::move(forwardDeclarableNeeds)});
 
         } break;
         case EntityKind::class_: {
@@ -349,20 +531,28 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
             // TRY_ASSIGN(declaration, ExtractClassOrStructDeclaration(StructOrClass::class_, name,
             // tokensFromFirstSpecialComment));
             auto declaration = fmt::format("class {};", name);
-            dependentProps.emplace(std::in_place_index<std::to_underlying(EntityKind::class_)>,
-                                   EntityDependentProperties::StructOrClass{
-                                       .forwardDeclaration = std::move(declaration),
-                                       .forwardDeclarationNeeds = std::move(c.fdneeds),
-                                       .declarationNeeds = std::move(c.needs)});
+            auto forwardDeclarableNeeds =
+                ForwardDeclarableNeeds(c.needs, tokensFromFirstSpecialComment, false);
+            dependentProps.emplace(
+                std::in_place_index<std::to_underlying(EntityKind::class_)>,
+                EntityDependentProperties::StructOrClass{
+                    .forwardDeclaration = std::move(declaration),
+                    .forwardDeclarationNeeds = std::move(c.fdneeds),
+                    .declarationNeeds = std::move(c.needs),
+                    .forwardDeclarableNeeds = std::move(forwardDeclarableNeeds)});
         } break;
         case EntityKind::header: {
             allowed.needs = true;
             if (auto cnr = checkNeeds(); !cnr) {
                 return std::unexpected(make_vector(std::move(cnr.error())));
             }
+            auto forwardDeclarableNeeds =
+                ForwardDeclarableNeeds(c.needs, tokensFromFirstSpecialComment, false);
             dependentProps.emplace(
                 std::in_place_index<std::to_underlying(EntityKind::header)>,
-                EntityDependentProperties::Header{.declarationNeeds = std::move(c.needs)});
+                EntityDependentProperties::Header{
+                    .declarationNeeds = std::move(c.needs),
+                    .forwardDeclarableNeeds = std::move(forwardDeclarableNeeds)});
         } break;
         case EntityKind::memfn: {
             allowed.needs = true;
@@ -371,16 +561,22 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
                 return std::unexpected(make_vector(std::move(cnr.error())));
             }
             // Expected: ... classname :: name ( ... ) ... { ... }
+            std::span<const Token> declarationTokens;
             TRY_ASSIGN_OR_RETURN_VALUE(
                 declaration,
-                ExtractFunctionDeclaration(
-                    containingStructOrClassName, name, tokensFromFirstSpecialComment),
+                ExtractFunctionDeclaration(containingStructOrClassName,
+                                           name,
+                                           tokensFromFirstSpecialComment,
+                                           &declarationTokens),
                 std::unexpected(make_vector(std::move(UNEXPECTED_ERROR))));
+            auto forwardDeclarableNeeds = ForwardDeclarableNeeds(c.needs, declarationTokens, true);
             dependentProps.emplace(
                 std::in_place_index<std::to_underlying(EntityKind::memfn)>,
-                EntityDependentProperties::MemFn{.declaration = std::move(declaration),
-                                                 .declarationNeeds = std::move(c.needs),
-                                                 .definitionNeeds = std::move(c.defneeds)});
+                EntityDependentProperties::MemFn{
+                    .declaration = std::move(declaration),
+                    .declarationNeeds = std::move(c.needs),
+                    .definitionNeeds = std::move(c.defneeds),
+                    .forwardDeclarableNeeds = std::move(forwardDeclarableNeeds)});
         } break;
     }
     CHECK(dependentProps);
@@ -407,3 +603,37 @@ std::expected<DirConfigFile, std::vector<std::string>> ParseDirConfigFile(
     }
     return std::unexpected(std::move(errors));
 }
+
+std::expected<ReferencedNames, std::string> FindReferencedNames(const PreprocessedSource& pps,
+                                                               const fs::path& sourcePath,
+                                                               EntityKind kind) {
+    using libtokenizer::Token;
+    auto tokens = TokensFromFirstSpecialComment(pps);
+    ReferencedNames r;
+    if (kind == EntityKind::fn || kind == EntityKind::memfn) {
+        // The same declaration `ParsePreprocessedSource` extracts.
+        std::optional<std::string> containingStructOrClassName;
+        if (kind == EntityKind::memfn) {
+            containingStructOrClassName =
+                extractContainingStructOrClassNameFromMemberDir(sourcePath);
+        }
+        std::span<const Token> declarationTokens;
+        if (auto d = ExtractFunctionDeclaration(containingStructOrClassName,
+                                                path_to_string(sourcePath.stem()),
+                                                tokens,
+                                                &declarationTokens);
+            !d) {
+            return std::unexpected(std::move(d.error()));
+        }
+        r.declaration = QualifiedNames(declarationTokens);
+        r.declarationForwardDeclarable =
+            ForwardDeclarableNeeds(r.declaration, declarationTokens, true);
+        r.definition = QualifiedNames(tokens.subspan(declarationTokens.size()));
+    } else {
+        r.declaration = QualifiedNames(tokens);
+        if (kind != EntityKind::enum_) {
+            r.declarationForwardDeclarable = ForwardDeclarableNeeds(r.declaration, tokens, false);
+        }
+    }
+    return r;
+}
@@ -14,3 +14,15 @@ std::expected<ParsePreprocessedSourceResult, std::vector<std::string>> ParsePrep
     const PreprocessedSource& pps, const std::filesystem::path& sourcePath);
 std::expected<DirConfigFile, std::vector<std::string>> ParseDirConfigFile(
     const std::vector<SpecialComment>& specialComments, const std::filesystem::path& sourcePath);
+
+// The names referenced by an entity, see `FindReferencedNames`.
+struct ReferencedNames {
+    std::vector<std::string> declaration, definition;  // Sorted.
+    // The names of `declaration` used only where an incomplete type will do, sorted.
+    std::vector<std::string> declarationForwardDeclarable;
+};
+/// The qualified names (`Foo`, `ns::Foo`, `::ns::Foo`) referenced in the declaration and in the
+/// definition of the entity of `sourcePath`, an entity of `kind` which `ParsePreprocessedSource`
+/// accepted. Only the functions have a definition apart from the declaration.
+std::expected<ReferencedNames, std::string> FindReferencedNames(
+    const PreprocessedSource& pps, const std::filesystem::path& sourcePath, EntityKind kind);
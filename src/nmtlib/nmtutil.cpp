@@ -46,3 +46,16 @@ bool isCIdentifier(std::string_view sv) {
     }
     return true;
 }
+
+bool isQualifiedCIdentifier(std::string_view sv) {
+    for (;;) {
+        auto i = sv.find("::");
+        if (!isCIdentifier(sv.substr(0, i))) {
+            return false;
+        }
+        if (i == std::string_view::npos) {
+            return true;
+        }
+        sv.remove_prefix(i + 2);
+    }
+}
@@ -4,4 +4,5 @@ std::filesystem::path structOrClassSourcePathToMemberDir(std::filesystem::path p
 bool isPathLikeMemberDir(const std::filesystem::path& path);
 std::optional<std::string> extractContainingStructOrClassNameFromMemberDir(
     const std::filesystem::path& path);
-bool isCIdentifier(std::string_view sv);
\ No newline at end of file
+bool isCIdentifier(std::string_view sv);
+bool isQualifiedCIdentifier(std::string_view sv);
@@ -0,0 +1,384 @@
+#include "nmt/CompilerLauncher.h"
+
+#include "ReadFile.h"
+#include "WriteFile.h"
+
+#include "nmt/base_types.h"
+#include "nmt/constants.h"
+#include "util/MakeDepfile.h"
+#include "util/RunProcess.h"
+#include "util/StableHash.h"
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Change it when the key or the layout of the entries changes.
+constexpr uint64_t k_cacheVersion = 2;
+
+// Files of a cache entry, in a directory named after the key.
+constexpr std::string_view k_objectFilename = "object.o";
+constexpr std::string_view k_depfileFilename = "object.d";
+// The files the compiler read, one per line: `<content hash> <path>`.
+constexpr std::string_view k_inputsFilename = "inputs.txt";
+// What the compiler printed (warnings), replayed on a hit.
+constexpr std::string_view k_outputFilename = "output.txt";
+// The `--version` outputs of the compilers, in files named after `CompilerBinaryHash`.
+constexpr std::string_view k_compilersDirname = "compilers";
+
+struct CompileCommand {
+    fs::path cpp;  // A generated cpp file.
+    fs::path object;
+    // Given with `-MF`, written by `-MD` or `-MMD`.
+    std::optional<fs::path> depfile;
+};
+
+// The value of `-o`-like options given as `-o x` or `-ox`.
+std::optional<std::string> OptionValue(std::span<const std::string> command,
+                                       size_t& i,
+                                       std::string_view option) {
+    auto& arg = command[i];
+    if (arg == option) {
+        if (i + 1 < command.size()) {
+            return command[++i];
+        }
+        return std::nullopt;
+    }
+    if (arg.starts_with(option)) {
+        return arg.substr(option.size());
+    }
+    return std::nullopt;
+}
+
+bool IsGeneratedFileContent(std::string_view content) {
+    return content.starts_with(k_autogeneratedWarningLine);
+}
+
+// Return nullopt if the command doesn't compile a generated cpp file to an object file.
+std::optional<CompileCommand> ParseCompileCommand(std::span<const std::string> command) {
+    bool compileOnly = false, writesDepfile = false;
+    std::optional<fs::path> object, depfile;
+    std::vector<fs::path> cpps;
+    for (size_t i = 1; i < command.size(); ++i) {
+        auto& arg = command[i];
+        if (arg == "-c") {
+            compileOnly = true;
+        } else if (arg == "-E" || arg == "-S" || arg == "-M" || arg == "-MM" || arg == "-") {
+            return std::nullopt;
+        } else if (arg == "-MD" || arg == "-MMD") {
+            writesDepfile = true;
+        } else if (arg.starts_with("-o")) {
+            object = OptionValue(command, i, "-o");
+        } else if (arg.starts_with("-MF")) {
+            depfile = OptionValue(command, i, "-MF");
+        } else if (arg == "-MT" || arg == "-MQ" || arg == "-include" || arg == "-x"
+                   || arg == "-isystem" || arg == "-I" || arg == "-D") {
+            ++i;  // Skip the value.
+        } else if (!arg.starts_with("-") && fs::path(arg).extension() == ".cpp") {
+            cpps.emplace_back(arg);
+        }
+    }
+    if (!compileOnly || !object || cpps.size() != 1 || (writesDepfile && !depfile)) {
+        return std::nullopt;
+    }
+    auto content = ReadFile(cpps.front());
+    if (!content || !IsGeneratedFileContent(*content)) {
+        return std::nullopt;
+    }
+    return CompileCommand{.cpp = std::move(cpps.front()),
+                          .object = std::move(*object),
+                          .depfile = writesDepfile ? depfile : std::nullopt};
+}
+
+// The absolute path in `#include "<path>"` or `#define NMT_MEMBER_DECLARATIONS "<path>"`.
+std::optional<fs::path> IncludedAbsolutePath(std::string_view line) {
+    line = trim(line);
+    for (auto prefix : {std::string_view("#include"), std::string_view("#define")}) {
+        if (line.starts_with(prefix)) {
+            auto begin = line.find('"');
+            auto end = line.rfind('"');
+            if (begin == std::string_view::npos || end <= begin) {
+                return std::nullopt;
+            }
+            fs::path p = path_from_string(line.substr(begin + 1, end - begin - 1));
+            return p.is_absolute() ? std::optional(std::move(p)) : std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+// Hash the generated cpp and the generated files and sources it includes, transitively. Return
+// nullopt if a file can't be read.
+std::optional<uint64_t> HashGeneratedInputs(const fs::path& cpp) {
+    StableHasher h;
+    std::vector<fs::path> stack{cpp};
+    flat_hash_set<fs::path, path_hash> visited{cpp};
+    while (!stack.empty()) {
+        auto path = std::move(stack.back());
+        stack.pop_back();
+        auto content = ReadFile(path);
+        if (!content) {
+            return std::nullopt;
+        }
+        h.add(path).add(*content);
+        if (!IsGeneratedFileContent(*content)) {
+            continue;  // A source, its includes are found by the compiler (dependency file).
+        }
+        for (auto line : std::views::split(std::string_view(*content), '\n')) {
+            if (auto p = IncludedAbsolutePath(std::string_view(line.begin(), line.end()));
+                p && visited.insert(*p).second) {
+                stack.push_back(std::move(*p));
+            }
+        }
+    }
+    return h.digest();
+}
+
+std::optional<uint64_t> HashFileContent(const fs::path& p) {
+    auto content = ReadFile(p);
+    if (!content) {
+        return std::nullopt;
+    }
+    return StableHasher().add(*content).digest();
+}
+
+// True if the files recorded in the entry's `k_inputsFilename` are unchanged.
+bool InputsUnchanged(const fs::path& entryDir) {
+    auto inputs = ReadFile(entryDir / k_inputsFilename);
+    if (!inputs) {
+        return false;
+    }
+    for (auto lineRange : std::views::split(std::string_view(*inputs), '\n')) {
+        std::string_view line(lineRange.begin(), lineRange.end());
+        if (line.empty()) {
+            continue;
+        }
+        auto space = line.find(' ');
+        if (space == std::string_view::npos) {
+            return false;
+        }
+        auto recorded = ParseStableHashString(line.substr(0, space));
+        if (!recorded || HashFileContent(path_from_string(line.substr(space + 1))) != *recorded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// `program` if it has a directory part, else the first executable `program` in `$PATH`.
+std::optional<fs::path> FindProgram(const std::string& program) {
+    if (program.find('/') != std::string::npos) {
+        return fs::path(program);
+    }
+    auto* path = getenv("PATH");
+    if (!path) {
+        return std::nullopt;
+    }
+    for (auto dirRange : std::views::split(std::string_view(path), ':')) {
+        std::string_view dir(dirRange.begin(), dirRange.end());
+        auto candidate = (dir.empty() ? fs::path(".") : path_from_string(dir)) / program;
+        if (access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+    }
+    return std::nullopt;
+}
+
+// The hash of the binary the compiler command runs: its resolved path (symlinks followed), size
+// and last write time, which change when the compiler is upgraded or the symlink is switched.
+std::optional<uint64_t> CompilerBinaryHash(const std::string& compiler) {
+    auto program = FindProgram(compiler);
+    if (!program) {
+        return std::nullopt;
+    }
+    std::error_code ec;
+    auto binary = fs::canonical(*program, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto size = fs::file_size(binary, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto lastWriteTime = fs::last_write_time(binary, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    return StableHasher()
+        .add(binary)
+        .add(uint64_t(size))
+        .add(uint64_t(lastWriteTime.time_since_epoch().count()))
+        .digest();
+}
+
+// The hash of the compiler binary and of its `--version` output, which tells apart the compilers a
+// wrapper (e.g. a ccache-style symlink) runs. The output is kept in the cache per binary, so
+// `--version` is run only once per compiler. Return nullopt if the compiler can't be identified.
+std::optional<uint64_t> CompilerHash(const fs::path& cacheDir, const std::string& compiler) {
+    auto binaryHash = CompilerBinaryHash(compiler);
+    if (!binaryHash) {
+        return std::nullopt;
+    }
+    auto versionFile = cacheDir / k_compilersDirname / StableHashToString(*binaryHash);
+    auto version = ReadFile(versionFile);
+    if (!version) {
+        const std::string args[] = {compiler, "--version"};
+        auto result = RunProcess(args);
+        if (!result || result->exitCode != 0) {
+            return std::nullopt;
+        }
+        version = std::move(result->output);
+        // Written in a temporary file and renamed, like the entries. Errors are ignored,
+        // `--version` is run again next time.
+        std::error_code ec;
+        fs::create_directories(versionFile.parent_path(), ec);
+        auto tmpFile = fs::path(versionFile).concat(fmt::format(".tmp{}", getpid()));
+        if (WriteFile(tmpFile, *version)) {
+            fs::rename(tmpFile, versionFile, ec);
+        }
+        fs::remove(tmpFile, ec);
+        // Hash what the next runs read back.
+        if (auto stored = ReadFile(versionFile)) {
+            version = std::move(stored);
+        }
+    }
+    return StableHasher().add(*binaryHash).add(*version).digest();
+}
+
+// Run the compiler, print its output to stderr and append it to `output`, if given.
+int RunCompiler(std::span<const std::string> command, std::string* output = nullptr) {
+    auto result = RunProcess(command);
+    if (!result) {
+        fmt::print(stderr, "nmt-cache: can't run the compiler: {}\n", result.error());
+        return EXIT_FAILURE;
+    }
+    fmt::print(stderr, "{}", result->output);
+    if (output) {
+        *output += result->output;
+    }
+    return result->exitCode < 0 ? EXIT_FAILURE : result->exitCode;
+}
+
+bool Restore(const fs::path& entryDir, const CompileCommand& cc) {
+    auto output = ReadFile(entryDir / k_outputFilename);
+    if (!output) {
+        return false;
+    }
+    std::error_code ec;
+    fs::copy_file(entryDir / k_objectFilename, cc.object, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        return false;
+    }
+    if (cc.depfile) {
+        fs::copy_file(
+            entryDir / k_depfileFilename, *cc.depfile, fs::copy_options::overwrite_existing, ec);
+    }
+    if (ec) {
+        return false;
+    }
+    fmt::print(stderr, "{}", *output);
+    return true;
+}
+
+// Errors are ignored, the object is just not cached.
+void Store(const fs::path& entryDir,
+           const CompileCommand& cc,
+           const fs::path& depfile,
+           std::string_view depfileContent,
+           std::string_view compilerOutput) {
+    std::string inputs;
+    for (auto& p : ParseMakeDepfilePrerequisites(depfileContent)) {
+        auto hash = HashFileContent(p);
+        if (!hash) {
+            return;
+        }
+        inputs += fmt::format(
+            "{} {}\n", StableHashToString(*hash), path_to_string(fs::absolute(p)));
+    }
+    // Written in a temporary directory and renamed, the concurrent compilations see either no
+    // entry or a complete one.
+    std::error_code ec;
+    auto tmpDir = fs::path(entryDir).concat(fmt::format(".tmp{}", getpid()));
+    fs::remove_all(tmpDir, ec);
+    if (!fs::create_directories(tmpDir, ec) || ec) {
+        return;
+    }
+    fs::copy_file(cc.object, tmpDir / k_objectFilename, ec);
+    if (!ec && cc.depfile) {
+        fs::copy_file(depfile, tmpDir / k_depfileFilename, ec);
+    }
+    if (ec || !WriteFile(tmpDir / k_inputsFilename, inputs)
+        || !WriteFile(tmpDir / k_outputFilename, compilerOutput)) {
+        fs::remove_all(tmpDir, ec);
+        return;
+    }
+    fs::remove_all(entryDir, ec);  // An entry with changed inputs.
+    fs::rename(tmpDir, entryDir, ec);
+    if (ec) {
+        fs::remove_all(tmpDir, ec);
+    }
+}
+
+}  // namespace
+
+int RunCompilerLauncher(std::span<const std::string> command,
+                        const std::optional<fs::path>& cacheDir) {
+    auto cc = cacheDir ? ParseCompileCommand(command) : std::nullopt;
+    if (!cc) {
+        return RunCompiler(command);
+    }
+    auto inputsHash = HashGeneratedInputs(cc->cpp);
+    auto compilerHash = CompilerHash(*cacheDir, command.front());
+    if (!inputsHash || !compilerHash) {
+        return RunCompiler(command);
+    }
+    auto key = StableHasher()
+                   .add(k_cacheVersion)
+                   .add(*compilerHash)
+                   .add(command)
+                   .add(*inputsHash)
+                   .digest();
+    auto keyString = StableHashToString(key);
+    auto entryDir = *cacheDir / keyString.substr(0, 2) / keyString;
+
+    std::error_code ec;
+    if (fs::is_directory(entryDir, ec) && InputsUnchanged(entryDir) && Restore(entryDir, *cc)) {
+        return EXIT_SUCCESS;
+    }
+
+    // The dependency file lists the headers the generated inputs don't cover.
+    std::vector<std::string> commandWithDepfile(command.begin(), command.end());
+    fs::path depfile;
+    if (cc->depfile) {
+        depfile = *cc->depfile;
+    } else {
+        depfile = fs::path(cc->object).concat(".nmt-cache.d");
+        commandWithDepfile.insert(commandWithDepfile.end(),
+                                  {"-MD", "-MF", path_to_string(depfile)});
+    }
+    std::string compilerOutput;
+    auto exitCode = RunCompiler(commandWithDepfile, &compilerOutput);
+    auto depfileContent = ReadFile(depfile);
+    if (exitCode == EXIT_SUCCESS && depfileContent) {
+        Store(entryDir, *cc, depfile, *depfileContent, compilerOutput);
+    }
+    if (!cc->depfile) {
+        fs::remove(depfile, ec);
+    }
+    return exitCode;
+}
+
+std::optional<fs::path> DefaultObjectCacheDir() {
+    if (auto* dir = getenv("NMT_CACHE_DIR"); dir && *dir) {
+        return fs::path(dir);
+    }
+    if (auto* dir = getenv("XDG_CACHE_HOME"); dir && *dir) {
+        return fs::path(dir) / "nmt" / "objects";
+    }
+    if (auto* dir = getenv("HOME"); dir && *dir) {
+        return fs::path(dir) / ".cache" / "nmt" / "objects";
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+
+// Compiler launcher with a local, content-addressed object cache (the `nmt-cache` tool, used as
+// `CMAKE_CXX_COMPILER_LAUNCHER`). Only the compilations of the generated cpp files are cached, the
+// other commands are run as they are.
+//
+// The key of an object is the hash of the compiler (the binary the command runs and its
+// `--version`), the compiler command and the contents of the generated cpp, the generated headers
+// and the sources it includes, transitively. These are found by following
+// the absolute `#include` paths of the generated files, no preprocessing is needed. The other
+// headers (system and non-nmt headers) are taken from the dependency file written by the compiler
+// and their contents are stored with the object, an object is used only if they're unchanged.
+// Since different versions of the sources have different keys, switching back to a previously
+// built version (e.g. a branch) restores the objects instead of compiling them. The warnings the
+// compiler printed are stored with the object and printed again when it's restored.
+//
+// The compiler is expected to accept the GCC/Clang options (`-c`, `-o`, `-MD`, `-MF`).
+
+/// Run `command` (the compiler and its arguments), take the object from or store it in the cache
+/// in `cacheDir` (if any). Return the exit code of the compiler (0 on a cache hit).
+int RunCompilerLauncher(std::span<const std::string> command,
+                        const std::optional<std::filesystem::path>& cacheDir);
+
+/// `$NMT_CACHE_DIR`, or `nmt/objects` in `$XDG_CACHE_HOME` or in `$HOME/.cache`.
+std::optional<std::filesystem::path> DefaultObjectCacheDir();
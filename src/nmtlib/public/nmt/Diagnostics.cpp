@@ -0,0 +1,134 @@
+#include "nmt/Diagnostics.h"
+
+#include <cstdio>
+
+DiagnosticLevel DiagnosticLevelOf(const Diagnostic::V& d) {
+    return std::visit(
+        []<class T>(const T&) {
+            return T::k_level;
+        },
+        d);
+}
+
+std::string FormatDiagnostic(const Entities& entities, const Diagnostic::V& d) {
+    return switch_variant(
+        d,
+        [](const Diagnostic::CantReadDirectory& x) {
+            return fmt::format("Can't read directory `{}`, reason: {}", x.path, x.ec.message());
+        },
+        [](const Diagnostic::CantGetFileStatus& x) {
+            return fmt::format("Can't get status of file `{}`, reason: {}", x.path, x.ec.message());
+        },
+        [](const Diagnostic::CantCheckDirectory& x) {
+            return fmt::format(
+                "Can't check if path `{}` is a directory, reason: {}", x.path, x.ec.message());
+        },
+        [](const Diagnostic::UnsupportedFileType& x) {
+            if (x.type == std::filesystem::file_type::not_found) {
+                return fmt::format("File `{}` has a type of `not_found` and that's strange, what "
+                                   "should we do with that? For now it's an error",
+                                   x.path);
+            }
+            return fmt::format(
+                "File `{}` has a type of {} and it's not yet decided what to do with this type",
+                x.path,
+                to_string_view(x.type));
+        },
+        [&](const Diagnostic::CantReadSource& x) {
+            return fmt::format("Can't read file: {}", entities.sourcePath(x.sourceId));
+        },
+        [&](const Diagnostic::ProcessingFailed& x) {
+            return fmt::format(
+                "Failed to process file {}, reason: {}", entities.sourcePath(x.sourceId), x.reason);
+        },
+        [](const Diagnostic::Error& x) {
+            return x.message;
+        },
+        [&](const Diagnostic::ForwardDeclarableNeed& x) {
+            // The body of a function may need it complete, the generated cpp then has to include
+            // its header.
+            auto kind = entities.entitySummary(x.sourceId).GetEntityKind();
+            const bool function = kind == EntityKind::fn || kind == EntityKind::memfn;
+            return fmt::format("{}: `{}` is used only where an incomplete type will do, `#needs: "
+                               "{}*`{} would forward declare it",
+                               entities.sourcePath(x.sourceId),
+                               x.need,
+                               x.need,
+                               function ? fmt::format(" with `#defneeds: {}`", x.need) : "");
+        },
+        [](const Diagnostic::ForwardDeclarations& x) {
+            return fmt::format("Forward declarations: {} needs {} forward declared, their headers "
+                               "are included by {} fewer cpp files",
+                               x.needs,
+                               x.applied ? "are" : "can be",
+                               x.sparedCpps);
+        },
+        [&](const Diagnostic::NeedsMismatch& x) {
+            std::string differences;
+            if (!x.missing.empty()) {
+                differences = fmt::format("missing: {}", fmt::join(x.missing, ", "));
+            }
+            if (!x.unused.empty()) {
+                differences += fmt::format(
+                    "{}unused: {}", differences.empty() ? "" : "; ", fmt::join(x.unused, ", "));
+            }
+            return fmt::format("{}: the identifiers reference `#{}: {}`{}",
+                               entities.sourcePath(x.sourceId),
+                               enum_name(x.keyword),
+                               fmt::join(x.inferredNeeds, ", "),
+                               differences.empty() ? "" : fmt::format(" ({})", differences));
+        },
+        [](const Diagnostic::NeedsInferred& x) {
+            return fmt::format("Needs inference: {} entities {} the needs inferred from their "
+                               "identifiers, {} needs were missing, {} unused",
+                               x.entities,
+                               x.applied ? "use" : "can use",
+                               x.missing,
+                               x.unused);
+        },
+        [](const Diagnostic::IgnoredFileExtension& x) {
+            return fmt::format("Ignoring file with extension `{}`: {}", x.path.extension(), x.path);
+        },
+        [](const Diagnostic::IgnoredDirectoryInMemberDir& x) {
+            return fmt::format(
+                "Directory `{}` ignored: it's inside a directory for struct/class members.",
+                x.path);
+        },
+        [&](const Diagnostic::IgnoredSourceWithoutAnnotations& x) {
+            return fmt::format("Ignoring file without NMT annotations: {}",
+                               entities.sourcePath(x.sourceId));
+        },
+        [&](const Diagnostic::GeneratedHeader& x) {
+            auto& e = entities.entitySummary(x.sourceId);
+            return fmt::format("Processed {} from {}", e.name, e.sourcePath);
+        });
+}
+
+void PrintDiagnostics(const Entities& entities, std::span<const Diagnostic::V> records) {
+    fmt::memory_buffer out, err;
+    for (auto& d : records) {
+        switch (DiagnosticLevelOf(d)) {
+            case DiagnosticLevel::error:
+                fmt::format_to(std::back_inserter(err), "Error: {}\n", FormatDiagnostic(entities, d));
+                break;
+            case DiagnosticLevel::info:
+                fmt::format_to(std::back_inserter(out), "{}\n", FormatDiagnostic(entities, d));
+                break;
+            case DiagnosticLevel::verbose:
+                fmt::format_to(std::back_inserter(out), "Note: {}\n", FormatDiagnostic(entities, d));
+                break;
+        }
+    }
+    if (out.size() > 0) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (err.size() > 0) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+    }
+}
+
+void FlushDiagnostics(const Entities& entities, Diagnostics& diagnostics) {
+    PrintDiagnostics(entities, diagnostics.records());
+    diagnostics.clear();
+}
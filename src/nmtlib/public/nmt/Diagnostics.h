@@ -0,0 +1,164 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/ForwardDeclarableNeeds.h"
+
+#include "util/enum_traits.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+enum class DiagnosticLevel { error, info, verbose };
+template<>
+struct enum_traits<DiagnosticLevel> {
+    using enum DiagnosticLevel;
+    static constexpr std::array<DiagnosticLevel, 3> elements{error, info, verbose};
+    static constexpr std::array<std::string_view, elements.size()> names{
+        "error", "info", "verbose"};
+};
+
+// The records hold what's needed to format the message (source ids, paths, error codes), the
+// message is formatted only when it's printed.
+namespace Diagnostic {
+struct CantReadDirectory {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    std::filesystem::path path;
+    std::error_code ec;
+};
+struct CantGetFileStatus {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    std::filesystem::path path;
+    std::error_code ec;
+};
+struct CantCheckDirectory {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    std::filesystem::path path;
+    std::error_code ec;
+};
+struct UnsupportedFileType {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    std::filesystem::path path;
+    std::filesystem::file_type type;
+};
+struct CantReadSource {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    Entities::Id sourceId;
+};
+struct ProcessingFailed {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    Entities::Id sourceId;
+    std::string reason;
+};
+// Already formatted error (e.g. from an `std::expected` of a lower layer).
+struct Error {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::error;
+    std::string message;
+};
+struct ForwardDeclarableNeed {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::info;
+    Entities::Id sourceId;
+    std::string need;
+};
+struct ForwardDeclarations {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::info;
+    size_t needs;
+    size_t sparedCpps;
+    bool applied;
+};
+struct NeedsMismatch {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::info;
+    Entities::Id sourceId;
+    SpecialCommentKeyword keyword;  // `needs` or `defneeds`.
+    std::vector<std::string> inferredNeeds, missing, unused;
+};
+struct NeedsInferred {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::info;
+    size_t entities;
+    size_t missing;
+    size_t unused;
+    bool applied;
+};
+struct IgnoredFileExtension {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::verbose;
+    std::filesystem::path path;
+};
+struct IgnoredDirectoryInMemberDir {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::verbose;
+    std::filesystem::path path;
+};
+struct IgnoredSourceWithoutAnnotations {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::verbose;
+    Entities::Id sourceId;
+};
+struct GeneratedHeader {
+    static constexpr DiagnosticLevel k_level = DiagnosticLevel::verbose;
+    Entities::Id sourceId;
+};
+using V = std::variant<CantReadDirectory,
+                       CantGetFileStatus,
+                       CantCheckDirectory,
+                       UnsupportedFileType,
+                       CantReadSource,
+                       ProcessingFailed,
+                       Error,
+                       ForwardDeclarableNeed,
+                       ForwardDeclarations,
+                       NeedsMismatch,
+                       NeedsInferred,
+                       IgnoredFileExtension,
+                       IgnoredDirectoryInMemberDir,
+                       IgnoredSourceWithoutAnnotations,
+                       GeneratedHeader>;
+}  // namespace Diagnostic
+
+DiagnosticLevel DiagnosticLevelOf(const Diagnostic::V& d);
+/// The source ids of the record are looked up in `entities`.
+std::string FormatDiagnostic(const Entities& entities, const Diagnostic::V& d);
+
+// Collects the diagnostic records up to a level, the records of higher levels are not even
+// constructed. Errors are always collected.
+class Diagnostics {
+   public:
+    explicit Diagnostics(DiagnosticLevel maxLevel)
+        : _maxLevel(std::max(maxLevel, DiagnosticLevel::error)) {}
+
+    bool enabled(DiagnosticLevel level) const {
+        return level <= _maxLevel;
+    }
+    template<class T, class... Args>
+    void report(Args&&... args) {
+        if (enabled(T::k_level)) {
+            _records.emplace_back(std::in_place_type<T>, std::forward<Args>(args)...);
+            if constexpr (T::k_level == DiagnosticLevel::error) {
+                ++_errorCount;
+            }
+        }
+    }
+    std::span<const Diagnostic::V> records() const {
+        return _records;
+    }
+    /// Number of errors reported since construction, `clear` doesn't reset it.
+    size_t errorCount() const {
+        return _errorCount;
+    }
+    void clear() {
+        _records.clear();
+    }
+
+   private:
+    DiagnosticLevel _maxLevel;
+    std::vector<Diagnostic::V> _records;
+    size_t _errorCount = 0;
+};
+
+/// Format the records into one buffer per stream and write them at once: errors go to stderr, the
+/// others to stdout.
+void PrintDiagnostics(const Entities& entities, std::span<const Diagnostic::V> records);
+/// Print the records of `diagnostics` and clear them.
+void FlushDiagnostics(const Entities& entities, Diagnostics& diagnostics);
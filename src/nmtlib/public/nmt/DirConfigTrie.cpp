@@ -0,0 +1,132 @@
+#include "nmt/DirConfigTrie.h"
+
+#include "HeapBytes.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// True if the config file sets every setting, so the configs above it don't matter below it.
+bool SetsAllSettings(const DirConfigFile& config) {
+    return config.namespace_.has_value();
+}
+}  // namespace
+
+DirConfigTrie::DirConfigTrie()
+    : _nodes(1) {}
+
+void DirConfigTrie::addDir(const fs::path& dir) {
+    nodeOf(dir);
+}
+
+void DirConfigTrie::set(DirConfigFile config) {
+    auto node = nodeOf(config.parentDir);
+    if (!_nodes[node].config) {
+        ++_configCount;
+    }
+    _nodes[node].config = std::move(config);
+    resolveSubtree(node);
+}
+
+void DirConfigTrie::erase(const fs::path& dir) {
+    auto it = _nodeByDir.find(dir);
+    if (it == _nodeByDir.end() || !_nodes[it->second].config) {
+        return;
+    }
+    _nodes[it->second].config.reset();
+    --_configCount;
+    resolveSubtree(it->second);
+}
+
+const DirSettings& DirConfigTrie::settings(const fs::path& dir) const {
+    for (auto d = dir; !d.empty();) {
+        if (auto* node = findNode(d)) {
+            return node->settings;
+        }
+        auto parent = d.parent_path();
+        if (parent == d) {
+            break;  // A root directory.
+        }
+        d = std::move(parent);
+    }
+    return _nodes.front().settings;
+}
+
+std::vector<fs::path> DirConfigTrie::dependentDirs(const fs::path& dir) const {
+    std::vector<fs::path> result;
+    auto* node = findNode(dir);
+    if (!node) {
+        return result;
+    }
+    std::vector<const Node*> pending{node};
+    while (!pending.empty()) {
+        auto* n = pending.back();
+        pending.pop_back();
+        result.push_back(n->dir);
+        for (auto child : n->children) {
+            auto& c = _nodes[child];
+            if (!c.config || !SetsAllSettings(*c.config)) {
+                pending.push_back(&c);
+            }
+        }
+    }
+    return result;
+}
+
+int64_t DirConfigTrie::heapBytes() const {
+    int64_t bytes = int64_t(_nodes.capacity() * sizeof(Node)) + FlatHashMapBytes(_nodeByDir);
+    for (auto& n : _nodes) {
+        bytes += 2 * HeapBytes(n.dir) + HeapBytes(n.children) + HeapBytes(n.settings.namespace_);
+        if (n.config) {
+            bytes += HeapBytes(n.config->parentDir) + HeapBytes(n.config->namespace_);
+        }
+    }
+    return bytes;
+}
+
+uint32_t DirConfigTrie::nodeOf(const fs::path& dir) {
+    // The dir and its ancestors up to the first existing node, which is the root if none of them
+    // exists.
+    std::vector<fs::path> missing;
+    uint32_t parent = 0;
+    for (auto d = dir; !d.empty();) {
+        if (auto it = _nodeByDir.find(d); it != _nodeByDir.end()) {
+            parent = it->second;
+            break;
+        }
+        auto p = d.parent_path();
+        const bool isRootDir = p == d;
+        missing.push_back(std::move(d));
+        if (isRootDir) {
+            break;
+        }
+        d = std::move(p);
+    }
+    for (auto& d : missing | std::views::reverse) {
+        auto node = uint32_t(_nodes.size());
+        // A new node has no config file and no children yet, it inherits the settings.
+        _nodes.push_back(Node{.dir = d, .parent = parent, .settings = _nodes[parent].settings});
+        _nodes[parent].children.push_back(node);
+        _nodeByDir.emplace(std::move(d), node);
+        parent = node;
+    }
+    return parent;
+}
+
+const DirConfigTrie::Node* DirConfigTrie::findNode(const fs::path& dir) const {
+    auto it = _nodeByDir.find(dir);
+    return it == _nodeByDir.end() ? nullptr : &_nodes[it->second];
+}
+
+void DirConfigTrie::resolveSubtree(uint32_t node) {
+    std::vector<uint32_t> pending{node};
+    while (!pending.empty()) {
+        auto index = pending.back();
+        pending.pop_back();
+        auto& n = _nodes[index];
+        n.settings = index == 0 ? DirSettings{} : _nodes[n.parent].settings;
+        if (n.config && n.config->namespace_) {
+            n.settings.namespace_ = *n.config->namespace_;
+        }
+        append_range(pending, n.children);
+    }
+}
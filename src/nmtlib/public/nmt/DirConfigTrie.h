@@ -0,0 +1,61 @@
+#pragma once
+
+#include "nmt/DirConfigFile.h"
+#include "nmt/base_types.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The settings of a directory inherited from the dir config files: each setting comes from the
+// closest dir config file in the directory or above it which sets it.
+struct DirSettings {
+    std::string namespace_;  // Empty: the global namespace.
+};
+
+// The dir config files in a trie of the source directories. The settings of a directory are
+// resolved when it's added, and when a config file changes only the settings of its subtree are
+// resolved again, so `settings()` is a single hash lookup for the added directories.
+class DirConfigTrie {
+   public:
+    DirConfigTrie();
+
+    /// Add `dir` and its ancestors, the directories containing the sources.
+    void addDir(const std::filesystem::path& dir);
+    /// Add or replace the config file of `config.parentDir`.
+    void set(DirConfigFile config);
+    /// Remove the config file of `dir`, if any.
+    void erase(const std::filesystem::path& dir);
+
+    /// The settings of `dir`, or of its closest added ancestor if it's not added.
+    const DirSettings& settings(const std::filesystem::path& dir) const;
+    /// The added directories whose settings may change if the config file of `dir` changes: the
+    /// subtree of `dir` except below the config files which set all settings.
+    std::vector<std::filesystem::path> dependentDirs(const std::filesystem::path& dir) const;
+
+    int64_t configCount() const {
+        return _configCount;
+    }
+    /// Estimated, see `Project::Stats`.
+    int64_t heapBytes() const;
+
+   private:
+    struct Node {
+        std::filesystem::path dir;  // Empty for the root.
+        uint32_t parent = 0;
+        std::vector<uint32_t> children;
+        std::optional<DirConfigFile> config;
+        DirSettings settings;
+    };
+    // `_nodes[0]` is the root, the parent of the root directories (`/`, `C:\`).
+    std::vector<Node> _nodes;
+    flat_hash_map<std::filesystem::path, uint32_t, path_hash> _nodeByDir;
+    int64_t _configCount = 0;
+
+    /// Add the node if it doesn't exist.
+    uint32_t nodeOf(const std::filesystem::path& dir);
+    const Node* findNode(const std::filesystem::path& dir) const;
+    void resolveSubtree(uint32_t node);
+};
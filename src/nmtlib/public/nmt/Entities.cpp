@@ -1,9 +1,28 @@
 #include "nmt/Entities.h"
 
+#include "BatchedFileIO.h"
+#include "EntitySpill.h"
+#include "HeapBytes.h"
+
 namespace fs = std::filesystem;
 namespace ItemState = EntitiesItemState;
 using namespace vx;
 
+namespace {
+// Index of the alternative `T` of the variant `V`.
+template<class T, class V>
+struct AlternativeIndex;
+template<class T, class... Ts>
+struct AlternativeIndex<T, std::variant<Ts...>> {
+    static constexpr uint8_t value = [] {
+        constexpr std::array<bool, sizeof...(Ts)> matches{std::is_same_v<T, Ts>...};
+        return uint8_t(std::ranges::find(matches, true) - matches.begin());
+    }();
+};
+template<class T>
+constexpr uint8_t k_stateIndex = AlternativeIndex<T, ItemState::V>::value;
+}  // namespace
+
 std::expected<int64_t, std::string> Entities::addSource(int64_t targetId,
                                                         const fs::path& targetSourceDir,
                                                         const std::filesystem::path& path) {
@@ -14,10 +33,17 @@ std::expected<int64_t, std::string> Entities::addSource(int64_t targetId,
     }
     CHECK(isCanonicalPathPrefixOfOther(targetSourceDir, path));
     const auto id = nextId++;
-    auto itb = sourcePathToId.insert(std::make_pair(std::move(canonicalPath), id));
+    auto sourcePath = std::make_shared<const fs::path>(std::move(canonicalPath));
+    auto itb = sourcePathToId.mut().insert(std::make_pair(sourcePath, id));
     if (itb.second) {
-        const auto& sourcePath = itb.first->first;
-        items.insert(std::make_pair(id, Item{targetId, sourcePath, ItemState::NewSource{}}));
+        items.insert(id, Item{std::move(sourcePath), ItemState::NewSource{}});
+        while (stateIndices.size() <= size_t(id)) {
+            targetIds.push_back(0);
+            stateIndices.push_back(k_noItem);
+            lastWriteTimes.push_back(fs::file_time_type::min());
+        }
+        targetIds.mut(size_t(id)) = targetId;
+        stateIndices.mut(size_t(id)) = k_stateIndex<ItemState::NewSource>;
     } else {
         DCHECK(itb.second) << fmt::format("Duplicated source: {}", path);
     }
@@ -26,50 +52,51 @@ std::expected<int64_t, std::string> Entities::addSource(int64_t targetId,
 }
 
 std::vector<Entities::Id> Entities::dirtySources() const {
-    std::vector<Id> ids;
-    ids.reserve(items.size());
-    for (auto& [k, v] : items) {
-        if (switch_variant(
-                v.state,
-                [](ItemState::NewSource) {
-                    return true;
-                },
-                [](ItemState::CantReadFile) {
-                    return true;
-                },
-                [&v](const ItemState::SourceWithoutSpecialComments& x) {
-                    std::error_code ec;
-                    auto lastWriteTime = fs::last_write_time(v.sourcePath, ec);
-                    return ec || lastWriteTime > x.lastWriteTime;
-                },
-                [&v](const ItemState::Error& x) {
-                    std::error_code ec;
-                    auto lastWriteTime = fs::last_write_time(v.sourcePath, ec);
-                    return ec || lastWriteTime > x.lastWriteTime;
-                },
-                [&v](const Entity& x) {
-                    std::error_code ec;
-                    auto lastWriteTime = fs::last_write_time(v.sourcePath, ec);
-                    return ec || lastWriteTime > x.lastWriteTime;
-                })) {
-            ids.push_back(k);
+    // Sources without a recorded last write time are dirty, the others are stat-ed in a batch.
+    std::vector<Id> ids, statIds;
+    std::vector<const fs::path*> statPaths;
+    for (size_t c = 0; c < stateIndices.chunkCount(); ++c) {
+        auto states = stateIndices.chunk(c);
+        for (size_t i = 0; i < states.size(); ++i) {
+            const auto id = Id(c * stateIndices.k_chunkSize + i);
+            switch (states[i]) {
+                case k_noItem:
+                    break;
+                case k_stateIndex<ItemState::NewSource>:
+                case k_stateIndex<ItemState::CantReadFile>:
+                    ids.push_back(id);
+                    break;
+                default:
+                    statIds.push_back(id);
+                    statPaths.push_back(items.at(id).sourcePath.get());
+                    break;
+            }
         }
     }
-    std::ranges::sort(ids, {}, [this](Id x) -> const fs::path& {
-        return items.at(x).sourcePath;
+    auto currentLastWriteTimes = LastWriteTimes(statPaths);
+    for (size_t i = 0; i < statIds.size(); ++i) {
+        if (!currentLastWriteTimes[i]
+            || *currentLastWriteTimes[i] > lastWriteTimes[size_t(statIds[i])]) {
+            ids.push_back(statIds[i]);
+        }
+    }
+
+    std::vector<std::pair<const fs::path*, Id>> pathsAndIds;
+    pathsAndIds.reserve(ids.size());
+    for (auto id : ids) {
+        pathsAndIds.emplace_back(items.at(id).sourcePath.get(), id);
+    }
+    std::ranges::sort(pathsAndIds, [](const auto& x, const auto& y) {
+        return *x.first < *y.first;
     });
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = pathsAndIds[i].second;
+    }
     return ids;
 }
 
 std::vector<Entities::Id> Entities::entities() const {
-    std::vector<Id> ids;
-    ids.reserve(items.size());
-    for (auto& [k, v] : items) {
-        if (v.state | is<Entity>) {
-            ids.push_back(k);
-        }
-    }
-    return ids;
+    return itemsWithEntities();
 }
 
 std::string_view itemStateName(const ItemState::V& x) {
@@ -88,95 +115,187 @@ std::string_view itemStateName(const ItemState::V& x) {
     );
 }
 
+std::expected<std::monostate, std::string> Entities::enableSpilling(int64_t cacheCapBytes) {
+    TRY_ASSIGN(s, EntitySpill::Create(cacheCapBytes));
+    spill = std::move(s);
+    return {};
+}
+
+void Entities::trimSpillCache() const {
+    if (spill) {
+        spill->trimCache();
+    }
+}
+
 const Entity& Entities::entity(Id id) const {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item#{} not found", id);
-    CHECK(it->second.state | is<Entity>) << fmt::format(
-        "Item#{} has no entity, it's state is: {}", id, itemStateName(it->second.state));
-    return std::get<Entity>(it->second.state);
+    auto* item = items.find(id);
+    CHECK(item) << fmt::format("Item#{} not found", id);
+    CHECK(item->state | is<Entity>) << fmt::format(
+        "Item#{} has no entity, it's state is: {}", id, itemStateName(item->state));
+    auto& e = std::get<Entity>(item->state);
+    if (item->spilledProps) {
+        return spill->load(e, *item->spilledProps);
+    }
+    return e;
+}
+
+const Entity& Entities::entitySummary(Id id) const {
+    auto* item = items.find(id);
+    CHECK(item) << fmt::format("Item#{} not found", id);
+    CHECK(item->state | is<Entity>) << fmt::format(
+        "Item#{} has no entity, it's state is: {}", id, itemStateName(item->state));
+    return std::get<Entity>(item->state);
 }
 
 const std::filesystem::path& Entities::sourcePath(Id id) const {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item#{} not found", id);
-    return it->second.sourcePath;
+    auto* item = items.find(id);
+    CHECK(item) << fmt::format("Item#{} not found", id);
+    return *item->sourcePath;
 }
 
 int64_t Entities::targetId(Id id) const {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item#{} not found", id);
-    return it->second.targetId;
+    CHECK(id >= 0 && size_t(id) < stateIndices.size() && stateIndices[size_t(id)] != k_noItem)
+        << fmt::format("Item#{} not found", id);
+    return targetIds[size_t(id)];
 }
 
 std::vector<Entities::Id> Entities::itemsWithEntities() const {
     std::vector<Id> ids;
-    ids.reserve(items.size());
-    for (auto& [k, v] : items) {
-        if (v.state | is<Entity>) {
-            ids.push_back(k);
+    for (size_t c = 0; c < stateIndices.chunkCount(); ++c) {
+        auto states = stateIndices.chunk(c);
+        for (size_t i = 0; i < states.size(); ++i) {
+            if (states[i] == k_stateIndex<Entity>) {
+                ids.push_back(Id(c * stateIndices.k_chunkSize + i));
+            }
         }
     }
     return ids;
 }
 
-std::optional<Entities::Id> Entities::findNonMemberByName(int64_t targetId,
-                                                          std::string_view name) const {
-    // TODO add lookup table after namespace has been implemented.
-    std::optional<Id> maybeId;
-    for (auto& [k, v] : items) {
-        if (auto* e = std::get_if<Entity>(&v.state); e && e->name == name && e->targetId == targetId
-                                                     && !isMemberEntityKind(e->GetEntityKind())) {
-            CHECK(!maybeId) << fmt::format(
-                "Two entities (#{} and #{}) with the same name: {}", *maybeId, k, name);
-            maybeId = k;
-        }
+std::optional<Entities::Id> Entities::findEntityBySourcePath(int64_t targetId,
+                                                             const std::filesystem::path& p) const {
+    auto it = sourcePathToId->find(p);
+    if (it == sourcePathToId->end()) {
+        return std::nullopt;
     }
-    return maybeId;
+    auto id = size_t(it->second);
+    if (stateIndices[id] != k_stateIndex<Entity> || targetIds[id] != targetId) {
+        return std::nullopt;
+    }
+    return it->second;
 }
 
-std::optional<Entities::Id> Entities::findEntityBySourcePath(int64_t targetId,
-                                                             const std::filesystem::path& p) const {
-    // TODO add lookup table after namespace has been implemented.
-    std::optional<Id> maybeId;
-    for (auto& [k, v] : items) {
-        if (auto* e = std::get_if<Entity>(&v.state);
-            e && e->sourcePath == p && e->targetId == targetId) {
-            CHECK(!maybeId) << fmt::format(
-                "Two entities (#{} and #{}) with the same sourcePath: {}", *maybeId, k, p);
-            maybeId = k;
-        }
+void Entities::setState(Id id, ItemState::V state) {
+    auto* item = items.findMut(id);
+    CHECK(item) << fmt::format("Item id #{} doesn't exist", id);
+    stateIndices.mut(size_t(id)) = uint8_t(state.index());
+    lastWriteTimes.mut(size_t(id)) = switch_variant(
+        state,
+        [](const ItemState::SourceWithoutSpecialComments& x) {
+            return x.lastWriteTime;
+        },
+        [](const ItemState::Error& x) {
+            return x.lastWriteTime;
+        },
+        [](const Entity& x) {
+            return x.lastWriteTime;
+        },
+        [](const auto&) {
+            return fs::file_time_type::min();
+        });
+    item->spilledProps.reset();
+    if (auto* e = std::get_if<Entity>(&state); e && spill) {
+        item->spilledProps = spill->append(e->dependentProps);
     }
-    return maybeId;
+    item->state = std::move(state);
 }
 
 void Entities::updateSourceWithEntity(Id id, Entity entity) {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item id #{} doesn't exist", id);
-    it->second.state = std::move(entity);
+    setState(id, std::move(entity));
 }
 
 void Entities::updateSourceNoSpecialComments(Id id, std::filesystem::file_time_type lastWriteTime) {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item id #{} doesn't exist", id);
-    it->second.state = ItemState::SourceWithoutSpecialComments{lastWriteTime};
+    setState(id, ItemState::SourceWithoutSpecialComments{lastWriteTime});
 }
 
 void Entities::updateSourceCantReadFile(Id id) {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item id #{} doesn't exist", id);
-    it->second.state = ItemState::CantReadFile{};
+    setState(id, ItemState::CantReadFile{});
 }
 
 void Entities::updateSourceError(Id id,
                                  std::vector<std::string> errors,
                                  std::filesystem::file_time_type lastWriteTime) {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Item id #{} doesn't exist", id);
-    it->second.state = ItemState::Error{std::move(errors), lastWriteTime};
+    setState(id, ItemState::Error{std::move(errors), lastWriteTime});
 }
 
 const Entities::Item& Entities::source(Id id) const {
-    auto it = items.find(id);
-    CHECK(it != items.end()) << fmt::format("Source #{} doesn't exist", id);
-    return it->second;
+    auto* item = items.find(id);
+    CHECK(item) << fmt::format("Source #{} doesn't exist", id);
+    return *item;
+}
+
+Entities::Stats Entities::stats() const {
+    Stats s;
+    s.sources = int64_t(items.size());
+    s.itemsBytes = int64_t(items.chunkBytes() + targetIds.chunkBytes() + stateIndices.chunkBytes()
+                           + lastWriteTimes.chunkBytes());
+    s.sourcePathToIdBytes = FlatHashMapBytes(*sourcePathToId);
+    s.spilledBytes = spill ? spill->fileBytes() : 0;
+    for (auto& [path, id] : *sourcePathToId) {
+        s.sourcePathToIdBytes += SharedPtrBytes(path) + HeapBytes(*path);
+    }
+    for (auto [id, item] : items) {
+        switch_variant(
+            item.state,
+            [&s](const Entity& e) {
+                ++s.entitiesPerKind[size_t(std::to_underlying(e.GetEntityKind()))];
+                s.entitiesBytes += HeapBytes(e.name) + HeapBytes(e.sourcePath)
+                                   + HeapBytes(e.sourceRelPath) + HeapBytes(e.namespace_);
+                auto addNeeds = [&s](const std::vector<std::string>& needs) {
+                    s.needsEdges += int64_t(needs.size());
+                    s.entitiesBytes += HeapBytes(needs);
+                };
+                switch_variant(
+                    e.dependentProps,
+                    [&](const EntityDependentProperties::Enum& dp) {
+                        s.entitiesBytes += HeapBytes(dp.opaqueEnumDeclaration);
+                        addNeeds(dp.opaqueEnumDeclarationNeeds);
+                        addNeeds(dp.declarationNeeds);
+                    },
+                    [&](const EntityDependentProperties::Fn& dp) {
+                        s.entitiesBytes +=
+                            HeapBytes(dp.declaration) + HeapBytes(dp.forwardDeclarableNeeds);
+                        addNeeds(dp.declarationNeeds);
+                        addNeeds(dp.definitionNeeds);
+                    },
+                    [&](const EntityDependentProperties::StructOrClass& dp) {
+                        s.entitiesBytes += HeapBytes(dp.forwardDeclaration)
+                                           + HeapBytes(dp.forwardDeclarableNeeds)
+                                           + FlatHashMapBytes(dp.memberFunctions);
+                        for (auto& [name, _] : dp.memberFunctions) {
+                            s.entitiesBytes += HeapBytes(name);
+                        }
+                        addNeeds(dp.forwardDeclarationNeeds);
+                        addNeeds(dp.declarationNeeds);
+                    },
+                    [&](const EntityDependentProperties::Header& dp) {
+                        s.entitiesBytes += HeapBytes(dp.forwardDeclarableNeeds);
+                        addNeeds(dp.declarationNeeds);
+                    },
+                    [&](const EntityDependentProperties::MemFn& dp) {
+                        s.entitiesBytes +=
+                            HeapBytes(dp.declaration) + HeapBytes(dp.forwardDeclarableNeeds);
+                        addNeeds(dp.declarationNeeds);
+                        addNeeds(dp.definitionNeeds);
+                    });
+            },
+            [&s](const ItemState::CantGetCanonicalPath& x) {
+                s.itemsBytes += HeapBytes(x.message);
+            },
+            [&s](const ItemState::Error& x) {
+                s.itemsBytes += HeapBytes(x.messages);
+            },
+            [](const auto&) {});
+    }
+    return s;
 }
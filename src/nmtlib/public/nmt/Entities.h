@@ -2,9 +2,15 @@
 
 #include "nmt/Entity.h"
 #include "nmt/base_types.h"
+#include "util/Cow.h"
+#include "util/PersistentColumn.h"
+#include "util/PersistentIdMap.h"
 
+#include <array>
 #include <expected>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 #include <vector>
@@ -25,15 +31,32 @@ struct Error {
 using V = std::variant<NewSource, CantReadFile, SourceWithoutSpecialComments, Error, Entity>;
 }  // namespace EntitiesItemState
 
+class EntitySpill;
+
 class Entities {
    public:
     using Id = int64_t;
+    // The record of the dependent properties of a spilled entity, see `enableSpilling()`.
+    struct SpilledProps {
+        uint64_t offset;
+        uint32_t size;
+    };
+    // The cold part of an item, the hot fields are in the columns.
     struct Item {
-        int64_t targetId;
-        const std::filesystem::path& sourcePath;  // points to sourcePathToId keys
+        std::shared_ptr<const std::filesystem::path> sourcePath;  // Shared with sourcePathToId.
         EntitiesItemState::V state;
+        // If set, the `dependentProps` of the entity in `state` are default constructed.
+        std::optional<SpilledProps> spilledProps;
     };
 
+    Entities() = default;
+    /// Copying is cheap, the copies share the items (in chunks) and the source path index until
+    /// they're written. Copies can be read and written on different threads.
+    Entities(const Entities&) = default;
+    Entities(Entities&&) = default;
+    Entities& operator=(const Entities&) = default;
+    Entities& operator=(Entities&&) = default;
+
     /// Adding a source which has already been added is an error in Debug, ignored in Release.
     [[nodiscard]] std::expected<int64_t, std::string> addSource(
         int64_t targetId,
@@ -46,9 +69,20 @@ class Entities {
     /// Return sources with valid entities.
     std::vector<Id> entities() const;
 
+    /// Streaming mode for very large trees: the dependent properties (declarations, needs) of the
+    /// entities added from now on are written to a temporary file and loaded back on demand by
+    /// `entity()`, keeping about `cacheCapBytes` of them in memory, see `trimSpillCache()`.
+    [[nodiscard]] std::expected<std::monostate, std::string> enableSpilling(int64_t cacheCapBytes);
+    /// Drop the entities loaded by `entity()` if they're over the cap of `enableSpilling()`. No
+    /// reference returned by `entity()` can be held while calling it. No-op without spilling.
+    void trimSpillCache() const;
+
     /// It's an error if there's no entity for `id` (either because `id` doesn't exist or the item
-    /// at `id` has no entity)
+    /// at `id` has no entity). In streaming mode the reference is valid until `trimSpillCache()`.
     const Entity& entity(Id id) const;
+    /// Same as `entity()` but the dependent properties of a spilled entity are not loaded, only
+    /// their alternative (the kind) is valid. For the name, kind, paths, visibility and hashes.
+    const Entity& entitySummary(Id id) const;
 
     /// It's an error if `id` doesn't exist.
     const Entities::Item& source(Id id) const;
@@ -60,10 +94,20 @@ class Entities {
     int64_t targetId(Id id) const;
 
     std::vector<Id> itemsWithEntities() const;
-    std::optional<Id> findNonMemberByName(int64_t targetId, std::string_view name) const;
     std::optional<Id> findEntityBySourcePath(int64_t targetId,
                                              const std::filesystem::path& p) const;
 
+    struct Stats {
+        int64_t sources = 0;
+        std::array<int64_t, enum_size<EntityKind>()> entitiesPerKind{};
+        int64_t needsEdges = 0;  // Items of the entities' needs lists.
+        // Estimated heap bytes of the items (without entities), the source path index and the
+        // entities.
+        int64_t itemsBytes = 0, sourcePathToIdBytes = 0, entitiesBytes = 0;
+        int64_t spilledBytes = 0;  // On disk, in streaming mode.
+    };
+    Stats stats() const;
+
     /// It's an error if `id` doesn't exist.
     void updateSourceWithEntity(Id id, Entity entity);
     /// It's an error if `id` doesn't exist.
@@ -76,9 +120,46 @@ class Entities {
                            std::filesystem::file_time_type lastWriteTime);
 
    private:
-    flat_hash_map<Id, Item> items;
-    node_hash_map<std::filesystem::path, Id, path_hash>
-        sourcePathToId;  // Keys must have stable addresses, Item::sourcePath is a reference to the
-                         // key.
+    void setState(Id id, EntitiesItemState::V state);
+
+    // Hash and compare the pointed-to paths, paths can be looked up without a `shared_ptr`.
+    struct SharedPathHash {
+        using is_transparent = void;
+        size_t operator()(const std::filesystem::path& p) const {
+            return std::filesystem::hash_value(p);
+        }
+        size_t operator()(const std::shared_ptr<const std::filesystem::path>& p) const {
+            return std::filesystem::hash_value(*p);
+        }
+    };
+    struct SharedPathEq {
+        using is_transparent = void;
+        static const std::filesystem::path& Deref(const std::filesystem::path& p) {
+            return p;
+        }
+        static const std::filesystem::path& Deref(
+            const std::shared_ptr<const std::filesystem::path>& p) {
+            return *p;
+        }
+        template<class X, class Y>
+        bool operator()(const X& x, const Y& y) const {
+            return Deref(x) == Deref(y);
+        }
+    };
+    using SourcePathToId = flat_hash_map<std::shared_ptr<const std::filesystem::path>,
+                                         Id,
+                                         SharedPathHash,
+                                         SharedPathEq>;
+
+    PersistentIdMap<Item> items;  // Ids are allocated by `nextId`, dense.
+    // The hot fields of the items, indexed by id, read by the full scans without touching `items`.
+    PersistentColumn<int64_t> targetIds;
+    PersistentColumn<uint8_t> stateIndices;  // `EntitiesItemState::V::index()`, or `k_noItem`.
+    // Of the states which have one, see `dirtySources()`.
+    PersistentColumn<std::filesystem::file_time_type> lastWriteTimes;
+    static constexpr uint8_t k_noItem = 0xff;
+    // Written only by `addSource`, which clones it if it's shared with a copy.
+    Cow<SourcePathToId> sourcePathToId;
     Id nextId = 1;
+    std::shared_ptr<EntitySpill> spill;  // Shared with the copies, see `enableSpilling()`.
 };
@@ -13,20 +13,24 @@ void Entity::Print() {
             fmt::print("declaration: {}\n", x.declaration);
             fmt::print("needs: {}\n", fmt::join(x.declarationNeeds, ", "));
             fmt::print("defNeeds: {}\n", fmt::join(x.definitionNeeds, ", "));
+            fmt::print("forward declarable needs: {}\n", fmt::join(x.forwardDeclarableNeeds, ", "));
         },
         [](const EntityDependentProperties::StructOrClass& x) {
             fmt::print("forward declaration: {}\n", x.forwardDeclaration);
             fmt::print("fdneeds: {}\n", fmt::join(x.forwardDeclarationNeeds, ", "));
             fmt::print("needs: {}\n", fmt::join(x.declarationNeeds, ", "));
+            fmt::print("forward declarable needs: {}\n", fmt::join(x.forwardDeclarableNeeds, ", "));
             fmt::print("{} member functions\n", x.memberFunctions.size());
         },
         [](const EntityDependentProperties::Header& x) {
             fmt::print("needs: {}\n", fmt::join(x.declarationNeeds, ", "));
+            fmt::print("forward declarable needs: {}\n", fmt::join(x.forwardDeclarableNeeds, ", "));
         },
         [](const EntityDependentProperties::MemFn& x) {
             fmt::print("declaration: {}\n", x.declaration);
             fmt::print("needs: {}\n", fmt::join(x.declarationNeeds, ", "));
             fmt::print("defNeeds: {}\n", fmt::join(x.definitionNeeds, ", "));
+            fmt::print("forward declarable needs: {}\n", fmt::join(x.forwardDeclarableNeeds, ", "));
         });
     if (namespace_) {
         fmt::print("namespace: {}\n", *namespace_);
@@ -65,3 +69,10 @@ std::string_view Entity::ForwardDeclaration() const {
                                       enum_name(GetEntityKind()));
     }
 }
+
+bool ForwardDeclaresNeed(const std::vector<std::string>* forwardDeclarableNeeds,
+                         std::string_view need,
+                         const Entity& needed) {
+    return forwardDeclarableNeeds && needed.ForwardDeclarationNeedsOrNull()
+        && std::ranges::binary_search(*forwardDeclarableNeeds, need);
+}
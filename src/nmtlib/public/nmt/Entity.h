@@ -25,22 +25,28 @@ struct Fn {
     std::string declaration;
     // The source file contains the function-definition.
     std::vector<std::string> declarationNeeds, definitionNeeds;
+    // The `declarationNeeds` used only where an incomplete type will do, see
+    // `ForwardDeclaresNeed()`.
+    std::vector<std::string> forwardDeclarableNeeds;
 };
 struct StructOrClass {
     std::string forwardDeclaration;
     // The source file contains the struct/class declaration with an optional, special macro to
     // inject the member declarations.
     std::vector<std::string> forwardDeclarationNeeds, declarationNeeds;
+    std::vector<std::string> forwardDeclarableNeeds;  // See `Fn`.
     flat_hash_map<std::string, MemberFunction> memberFunctions;
 };
 struct Header {
     // The source file contains a header-only entity, like type alias (using) or inline variable.
     std::vector<std::string> declarationNeeds;
+    std::vector<std::string> forwardDeclarableNeeds;  // See `Fn`.
 };
 struct MemFn {
     std::string declaration;
     // The source file contains the function-definition.
     std::vector<std::string> declarationNeeds, definitionNeeds;
+    std::vector<std::string> forwardDeclarableNeeds;  // See `Fn`.
 };
 using V = std::variant<Enum, Fn, StructOrClass, StructOrClass, Header, MemFn>;
 // Make sure V's alternatives correspond to EntityKind values.
@@ -85,3 +91,11 @@ struct Entity {
     const std::vector<std::string>* ForwardDeclarationNeedsOrNull() const;
     std::string_view ForwardDeclaration() const;
 };
+
+/// True if `need` (a declaration need), resolved to `needed`, is among `forwardDeclarableNeeds`
+/// (sorted, null if the needs are not to be forward declared automatically) and `needed` can be
+/// forward declared, so its forward declaration is generated instead of including its header, as
+/// if the need were `need*`.
+bool ForwardDeclaresNeed(const std::vector<std::string>* forwardDeclarableNeeds,
+                         std::string_view need,
+                         const Entity& needed);
@@ -0,0 +1,84 @@
+#include "nmt/ForwardDeclarableNeeds.h"
+
+#include "nmt/IncludeGraph.h"
+#include "nmt/Project.h"
+#include "nmt/SymbolTable.h"
+
+ForwardDeclarationReport FindForwardDeclarableNeeds(const Project& project) {
+    auto& entities = project.entities();
+    auto entityIds = entities.itemsWithEntities();
+    const SymbolTable symbols(project);
+    ForwardDeclarationReport report;
+    std::vector<Entities::Id> neededIds;
+    for (auto id : entityIds) {
+        entities.trimSpillCache();  // No reference to the entities is held between the iterations.
+        auto& e = entities.entity(id);
+        const std::vector<std::string>* forwardDeclarable = switch_variant(
+            e.dependentProps,
+            [](const EntityDependentProperties::Enum&) -> const std::vector<std::string>* {
+                return nullptr;
+            },
+            [](const auto& dp) -> const std::vector<std::string>* {
+                return &dp.forwardDeclarableNeeds;
+            });
+        if (!forwardDeclarable) {
+            continue;
+        }
+        for (auto& need : *forwardDeclarable) {
+            auto maybeId = symbols.resolve(e, need);
+            if (maybeId
+                && ForwardDeclaresNeed(forwardDeclarable, need, entities.entitySummary(*maybeId))) {
+                report.needs.push_back(ForwardDeclarationReport::Need{.id = id, .need = need});
+                neededIds.push_back(*maybeId);
+            }
+        }
+    }
+    if (neededIds.empty()) {
+        return report;
+    }
+    sort_unique_inplace(neededIds);
+
+    std::vector<std::string> errors;  // Reported by generating the boilerplate.
+    auto memberRelations = FindMemberRelations(project, entityIds, errors);
+    const IncludeGraph current(project, memberRelations);
+    const IncludeGraph forwardDeclared(project, memberRelations, AutoForwardDeclarations::apply);
+    for (auto id : neededIds) {
+        const Entities::Id ids[] = {id};
+        auto before = current.cppIncluders(current.transitiveHeaderIncluders(ids)).size();
+        auto after =
+            forwardDeclared.cppIncluders(forwardDeclared.transitiveHeaderIncluders(ids)).size();
+        report.sparedCpps += before - std::min(before, after);
+    }
+    return report;
+}
+
+std::vector<std::string> FunctionDefinitionNeeds(const Entities& entities,
+                                                 const SymbolTable& symbols,
+                                                 AutoForwardDeclarations autoForwardDeclarations,
+                                                 const Entity& e) {
+    std::vector<std::string> result;
+    auto add = [&](const auto& dp) {
+        result = dp.definitionNeeds;
+        if (autoForwardDeclarations != AutoForwardDeclarations::apply) {
+            return;
+        }
+        for (auto& need : dp.forwardDeclarableNeeds) {
+            auto maybeId = symbols.resolve(e, need);
+            if (maybeId
+                && ForwardDeclaresNeed(
+                    &dp.forwardDeclarableNeeds, need, entities.entitySummary(*maybeId))) {
+                result.push_back(need);
+            }
+        }
+    };
+    switch_variant(
+        e.dependentProps,
+        [&](const EntityDependentProperties::Fn& dp) {
+            add(dp);
+        },
+        [&](const EntityDependentProperties::MemFn& dp) {
+            add(dp);
+        },
+        [](const auto&) {});
+    return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/enums.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Project;
+class SymbolTable;
+
+// The declaration needs which `AutoForwardDeclarations::apply` forward declares: they're used only
+// where an incomplete type will do and the needed entity is a struct, class or enum.
+struct ForwardDeclarationReport {
+    struct Need {
+        Entities::Id id;  // The needing entity.
+        std::string need;
+    };
+    std::vector<Need> needs;  // In the order of the entities.
+    // Summed over the headers of the needed entities: how many fewer cpp files include them,
+    // directly or transitively, if the needs are forward declared. As many fewer recompilations as
+    // the headers change.
+    size_t sparedCpps = 0;
+};
+
+ForwardDeclarationReport FindForwardDeclarableNeeds(const Project& project);
+
+/// The needs of the generated cpp of the function or member function `e` (empty for the other
+/// entities): its definition needs and, with `AutoForwardDeclarations::apply`, the declaration
+/// needs forward declared in its header, which the definition may need complete.
+std::vector<std::string> FunctionDefinitionNeeds(const Entities& entities,
+                                                 const SymbolTable& symbols,
+                                                 AutoForwardDeclarations autoForwardDeclarations,
+                                                 const Entity& e);
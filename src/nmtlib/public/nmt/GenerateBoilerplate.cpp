@@ -3,25 +3,69 @@
 #include "GeneratedFileWriter.h"
 #include "nmtutil.h"
 
+#include "nmt/Diagnostics.h"
+#include "nmt/ForwardDeclarableNeeds.h"
+#include "nmt/IncludeGraph.h"
 #include "nmt/Project.h"
+#include "nmt/SymbolTable.h"
+#include "util/StableHash.h"
+#include "util/TaskScheduler.h"
 
 namespace fs = std::filesystem;
 
 namespace {
 
+std::string NeedErrorMessage(const Entities& entities,
+                             const Entity& e,
+                             std::string_view needName,
+                             const std::vector<Entities::Id>& candidates) {
+    if (candidates.empty()) {
+        return fmt::format("Entity `{}` needs `{}` but it's missing.", e.name, needName);
+    }
+    std::vector<std::string> sourcePaths;
+    for (auto id : candidates) {
+        sourcePaths.push_back(fmt::format("{}", entities.sourcePath(id)));
+    }
+    return fmt::format("Entity `{}` needs `{}` but it's ambiguous: {}",
+                       e.name,
+                       needName,
+                       fmt::join(sourcePaths, ", "));
+}
+
+// `content` (lines) in `namespace ns { ... }`, unless `ns` is the global namespace.
+std::string InNamespace(std::string_view ns, std::string_view content) {
+    if (ns.empty()) {
+        return std::string(content);
+    }
+    return fmt::format("namespace {} {{\n{}}}\n", ns, content);
+}
+
+std::string NamespacedForwardDeclaration(const SymbolTable& symbols, const Entity& e) {
+    auto& ns = symbols.namespaceOf(e);
+    if (ns.empty()) {
+        return std::string(e.ForwardDeclaration());
+    }
+    return fmt::format("namespace {} {{ {} }}", ns, e.ForwardDeclaration());
+}
+
 struct IncludeSectionBuilder {
-    explicit IncludeSectionBuilder(const Project& project)
-        : project(project) {}
+    IncludeSectionBuilder(const Project& project, const SymbolTable& symbols)
+        : project(project)
+        , symbols(symbols) {}
+    // The needs in `forwardDeclarable` are forward declared if possible, see
+    // `ForwardDeclaresNeed()`.
     void addNeedsAsHeaders(const Entities& entities,
                            const Entity& e,
-                           const std::vector<std::string>& needs) {
+                           const std::vector<std::string>& needs,
+                           const std::vector<std::string>* forwardDeclarable = nullptr) {
         DCHECK(!failedAndErrorsHasBeenReturned);
-        std::vector<std::string> additionalNeeds;
-        const std::vector<std::string>* currentNeeds = &needs;
-        while (!currentNeeds->empty()) {
-            additionalNeeds = addNeedsAsHeadersCore(entities, e, *currentNeeds);
-            // TODO: prevent infinite loop because of some circular dependency.
-            currentNeeds = &additionalNeeds;
+        std::vector<EntityNeeds> pending;
+        addNeedsAsHeadersCore(entities, e, needs, forwardDeclarable, pending);
+        // The forward declaration needs of a needed entity are resolved in its own target.
+        while (!pending.empty()) {
+            auto [x, xNeeds] = pending.back();
+            pending.pop_back();
+            addNeedsAsHeadersCore(entities, *x, *xNeeds, nullptr, pending);
         }
     }
     std::expected<std::string, std::vector<std::string>> render() {
@@ -59,11 +103,40 @@ struct IncludeSectionBuilder {
         return content;
     }
 
+    // In module mode the headers go to the global module fragment, and the needed entities are
+    // declared by the module interface of their target, which is imported for the other targets.
+    struct ModuleParts {
+        std::vector<std::string> headers;
+        std::vector<Entities::Id> needed, forwardDeclared;
+        std::vector<std::string> rawForwardDeclarations;  // The `struct Foo` needs.
+    };
+    /// Instead of `render()`.
+    std::expected<ModuleParts, std::vector<std::string>> renderModuleParts() {
+        CHECK(!failedAndErrorsHasBeenReturned);
+        failedAndErrorsHasBeenReturned = true;
+        if (!errors.empty()) {
+            return std::unexpected(std::move(errors));
+        }
+        ModuleParts r;
+        for (auto* v :
+             {&locals, &externalsInDirs, &externalWithExtension, &externalsWithoutExtension}) {
+            sort_unique_inplace(*v);
+            append_range(r.headers, std::move(*v));
+        }
+        r.needed = std::move(neededIds);
+        r.forwardDeclared = std::move(forwardDeclaredIds);
+        r.rawForwardDeclarations = std::move(rawForwardDeclarations);
+        return r;
+    }
+
    private:
+    using EntityNeeds = std::pair<const Entity*, const std::vector<std::string>*>;
     const Project& project;
+    const SymbolTable& symbols;
     bool failedAndErrorsHasBeenReturned = false;
     std::vector<std::string> generateds, locals, externalsInDirs, externalWithExtension,
-        externalsWithoutExtension, forwardDeclarations;
+        externalsWithoutExtension, forwardDeclarations, rawForwardDeclarations;
+    std::vector<Entities::Id> neededIds, forwardDeclaredIds;
     std::vector<std::string> errors;
     void addHeader(std::string_view s) {
         assert(!s.empty());
@@ -79,12 +152,13 @@ struct IncludeSectionBuilder {
         }
         v->push_back(std::string(s));
     };
-    // Return additional needs coming from the enums which have needs for their
-    // opaque-enum-declaration.
-    std::vector<std::string> addNeedsAsHeadersCore(const Entities& entities,
-                                                   const Entity& e,
-                                                   const std::vector<std::string>& needs) {
-        std::vector<std::string> additionalNeeds;
+    // Append to `additionalNeeds` the needs of the forward declarations, like the needs of the
+    // opaque-enum-declarations of enums.
+    void addNeedsAsHeadersCore(const Entities& entities,
+                               const Entity& e,
+                               const std::vector<std::string>& needs,
+                               const std::vector<std::string>* forwardDeclarable,
+                               std::vector<EntityNeeds>& additionalNeeds) {
         for (auto& need : needs) {
             LOG_IF(FATAL, need.empty()) << "Empty need name.";
             if (need[0] == '<' || need[0] == '"') {
@@ -102,9 +176,10 @@ struct IncludeSectionBuilder {
                     }
                     forwardDeclarations.push_back(
                         fmt::format("{} {};", need.substr(0, spaceIdx), identifier));
+                    rawForwardDeclarations.push_back(forwardDeclarations.back());
                 } else {
                     std::string_view needName = need;
-                    const bool refOnly = needName.back() == '*';
+                    bool refOnly = needName.back() == '*';
                     if (refOnly) {
                         needName.remove_suffix(1);
                     }
@@ -112,13 +187,14 @@ struct IncludeSectionBuilder {
                         errors.push_back(fmt::format("Entity `{}` can't include itself.", e.name));
                         continue;
                     }
-                    auto maybeId = entities.findNonMemberByName(e.targetId, needName);
+                    auto maybeId = symbols.resolve(e, needName);
                     if (!maybeId) {
-                        errors.push_back(fmt::format(
-                            "Entity `{}` needs `{}` but it's missing.", e.name, needName));
+                        errors.push_back(
+                            NeedErrorMessage(entities, e, needName, maybeId.error()));
                         continue;
                     }
                     auto& ne = entities.entity(*maybeId);
+                    refOnly = refOnly || ForwardDeclaresNeed(forwardDeclarable, need, ne);
                     if (refOnly) {
                         auto* v = ne.ForwardDeclarationNeedsOrNull();
                         if (v == nullptr) {
@@ -130,59 +206,538 @@ struct IncludeSectionBuilder {
                                             enum_name(ne.GetEntityKind())));
                             continue;
                         }
-                        additionalNeeds.insert(additionalNeeds.end(), BEGIN_END(*v));
-                        forwardDeclarations.push_back(fmt::format("{}", ne.ForwardDeclaration()));
+                        // Circular forward declaration needs are added once.
+                        if (!std::ranges::contains(forwardDeclaredIds, *maybeId)) {
+                            additionalNeeds.emplace_back(&ne, v);
+                        }
+                        forwardDeclarations.push_back(NamespacedForwardDeclaration(symbols, ne));
+                        forwardDeclaredIds.push_back(*maybeId);
                     } else {
                         generateds.push_back(
                             fmt::format("\"{}\"", project.headerPath(false, *maybeId)));
+                        neededIds.push_back(*maybeId);
                     }
                 }
             }
         }
-        return additionalNeeds;
     }
 };
-/*
-struct TargetSubdirOfSourcePath {
-    std::vector<std::pair<fs::path, fs::path>> parentDirToSubdir;
-    template<class PathToDirConfigFileMap>
-    explicit TargetSubdirOfSourcePath(const PathToDirConfigFileMap& dirConfigFiles) {
-        parentDirToSubdir.reserve(dirConfigFiles.size());
-        for (auto& [k, v] : dirConfigFiles) {
-            if (v.subdir) {
-                parentDirToSubdir.push_back(std::make_pair(v.parentDir, *v.subdir));
+// Increment if the generated content changes for the same inputs, to invalidate the fingerprints
+// written by the previous versions.
+constexpr uint64_t k_fingerprintVersion = 2;
+
+void HashEntityProps(StableHasher& h, const Entity& e) {
+    h.add(uint64_t(e.GetEntityKind()))
+        .add(e.name)
+        .add(e.sourcePath)
+        .add(e.namespace_)
+        .add(uint64_t(e.visibility));
+    switch_variant(
+        e.dependentProps,
+        [&h](const EntityDependentProperties::Enum& dp) {
+            h.add(dp.opaqueEnumDeclaration)
+                .add(dp.opaqueEnumDeclarationNeeds)
+                .add(dp.declarationNeeds);
+        },
+        [&h](const EntityDependentProperties::Fn& dp) {
+            h.add(dp.declaration).add(dp.declarationNeeds).add(dp.definitionNeeds);
+        },
+        [&h](const EntityDependentProperties::StructOrClass& dp) {
+            h.add(dp.forwardDeclaration).add(dp.forwardDeclarationNeeds).add(dp.declarationNeeds);
+        },
+        [&h](const EntityDependentProperties::Header& dp) {
+            h.add(dp.declarationNeeds);
+        },
+        [&h](const EntityDependentProperties::MemFn& dp) {
+            h.add(dp.declaration).add(dp.declarationNeeds).add(dp.definitionNeeds);
+        });
+}
+
+// Hash what `IncludeSectionBuilder::addNeedsAsHeaders` resolves the needs to: the header paths of
+// the needed entities, the forward declarations and their needs. Unresolvable needs are hashed as
+// such, producing the files will report the error.
+void HashResolvedNeeds(StableHasher& h,
+                       const Project& project,
+                       const SymbolTable& symbols,
+                       const Entity& e,
+                       const std::vector<std::string>& needs,
+                       const std::vector<std::string>* forwardDeclarable = nullptr) {
+    std::vector<std::pair<const Entity*, const std::vector<std::string>*>> pending{{&e, &needs}};
+    flat_hash_set<Entities::Id> forwardDeclared;  // Against circular forward declaration needs.
+    while (!pending.empty()) {
+        auto [x, xNeeds] = pending.back();
+        pending.pop_back();
+        // Only `needs` are forward declared automatically, not the needs of the forward
+        // declarations.
+        auto* xForwardDeclarable = xNeeds == &needs ? forwardDeclarable : nullptr;
+        for (auto& need : *xNeeds) {
+            h.add(need);
+            if (need.empty() || need[0] == '<' || need[0] == '"' || need.starts_with("struct ")
+                || need.starts_with("class ") || need.starts_with("enum ")) {
+                continue;  // The need itself is what gets rendered.
+            }
+            std::string_view needName = need;
+            bool refOnly = needName.back() == '*';
+            if (refOnly) {
+                needName.remove_suffix(1);
+            }
+            auto maybeId = symbols.resolve(*x, needName);
+            if (!maybeId) {
+                h.add(uint64_t(0)).add(uint64_t(maybeId.error().size()));
+                continue;
+            }
+            auto& ne = project.entities().entity(*maybeId);
+            refOnly = refOnly || ForwardDeclaresNeed(xForwardDeclarable, need, ne);
+            h.add(uint64_t(1));
+            if (refOnly) {
+                h.add(NamespacedForwardDeclaration(symbols, ne));
+                if (auto* v = ne.ForwardDeclarationNeedsOrNull();
+                    v && forwardDeclared.insert(*maybeId).second) {
+                    pending.emplace_back(&ne, v);
+                }
+            } else {
+                h.add(project.headerPath(false, *maybeId));
+            }
+        }
+    }
+}
+
+// Fingerprint of everything the generated files of an entity are produced from.
+uint64_t EntityFingerprint(const Project& project,
+                           const SymbolTable& symbols,
+                           OutputMode outputMode,
+                           AutoForwardDeclarations autoForwardDeclarations,
+                           Entities::Id id,
+                           const fs::path& outputDir,
+                           const std::vector<Entities::Id>* members,
+                           std::optional<Entities::Id> containingEntity) {
+    auto& e = project.entities().entity(id);
+    StableHasher h;
+    h.add(k_fingerprintVersion)
+        .add(uint64_t(outputMode))
+        .add(outputDir)
+        .add(project.headerPath(false, id));
+    HashEntityProps(h, e);
+    h.add(symbols.namespaceOf(e));
+    auto hashNeeds = [&](const Entity& x,
+                         const std::vector<std::string>& needs,
+                         const std::vector<std::string>* forwardDeclarable = nullptr) {
+        HashResolvedNeeds(h,
+                          project,
+                          symbols,
+                          x,
+                          needs,
+                          autoForwardDeclarations == AutoForwardDeclarations::apply
+                              ? forwardDeclarable
+                              : nullptr);
+    };
+    switch_variant(
+        e.dependentProps,
+        [&](const EntityDependentProperties::Enum& dp) {
+            hashNeeds(e, dp.opaqueEnumDeclarationNeeds);
+            hashNeeds(e, dp.declarationNeeds);
+        },
+        [&](const EntityDependentProperties::Fn& dp) {
+            hashNeeds(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+            hashNeeds(e,
+                      FunctionDefinitionNeeds(
+                          project.entities(), symbols, autoForwardDeclarations, e));
+        },
+        [&](const EntityDependentProperties::StructOrClass& dp) {
+            hashNeeds(e, dp.forwardDeclarationNeeds);
+            hashNeeds(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+        },
+        [&](const EntityDependentProperties::Header& dp) {
+            hashNeeds(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+        },
+        [&](const EntityDependentProperties::MemFn& dp) {
+            hashNeeds(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+            hashNeeds(e,
+                      FunctionDefinitionNeeds(
+                          project.entities(), symbols, autoForwardDeclarations, e));
+        });
+    if (members) {
+        h.add(uint64_t(members->size()));
+        for (auto mid : *members) {
+            auto& me = project.entities().entity(mid);
+            HashEntityProps(h, me);
+            if (auto* dp = std::get_if<EntityDependentProperties::MemFn>(&me.dependentProps)) {
+                hashNeeds(me, dp->declarationNeeds, &dp->forwardDeclarableNeeds);
+            }
+        }
+    }
+    if (containingEntity) {
+        h.add(project.headerPath(false, *containingEntity));
+    }
+    return h.digest();
+}
+
+const std::vector<Entities::Id>* MembersOrNull(const MemberRelations& memberRelations,
+                                               Entities::Id id) {
+    auto it = memberRelations.containingEntityToMembers.find(id);
+    return it == memberRelations.containingEntityToMembers.end() ? nullptr : &it->second;
+}
+
+// The needs of the generated header of `e`, including the declaration needs of its members.
+void AddHeaderNeeds(IncludeSectionBuilder& includes,
+                    const Project& project,
+                    AutoForwardDeclarations autoForwardDeclarations,
+                    const Entity& e,
+                    const std::vector<Entities::Id>* members) {
+    const bool forwardDeclare = autoForwardDeclarations == AutoForwardDeclarations::apply;
+    auto addNeedsAsHeaders = [&](const std::vector<std::string>& needs,
+                                 const std::vector<std::string>* forwardDeclarable = nullptr) {
+        includes.addNeedsAsHeaders(
+            project.entities(), e, needs, forwardDeclare ? forwardDeclarable : nullptr);
+    };
+    switch_variant(
+        e.dependentProps,
+        [&](const EntityDependentProperties::Enum& dp) {
+            addNeedsAsHeaders(dp.opaqueEnumDeclarationNeeds);
+            addNeedsAsHeaders(dp.declarationNeeds);
+        },
+        [&](const EntityDependentProperties::Fn& dp) {
+            addNeedsAsHeaders(dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+        },
+        [&](const EntityDependentProperties::StructOrClass& dp) {
+            addNeedsAsHeaders(dp.forwardDeclarationNeeds);
+            addNeedsAsHeaders(dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+            if (members) {
+                for (auto mfid : *members) {
+                    auto& me = project.entities().entity(mfid);
+                    assert(me.GetEntityKind() == EntityKind::memfn);
+                    auto& mdp = std::get<EntityDependentProperties::MemFn>(me.dependentProps);
+                    addNeedsAsHeaders(mdp.declarationNeeds, &mdp.forwardDeclarableNeeds);
+                }
             }
+        },
+        [&](const EntityDependentProperties::Header& dp) {
+            addNeedsAsHeaders(dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+        },
+        [](const EntityDependentProperties::MemFn&) {
+            // memfn's declaration needs go to the class/struct header.
+        });
+}
+
+// What the generated header of `e` contains after the includes: the declaration of a function,
+// otherwise the source, in the namespace of the entity. Writes the member declarations file of a
+// struct/class.
+std::string DeclarationContent(const Project& project,
+                               const SymbolTable& symbols,
+                               GeneratedFileWriter& gfw,
+                               Entities::Id id,
+                               const Entity& e,
+                               const std::vector<Entities::Id>* members,
+                               std::optional<uint64_t> fingerprint) {
+    auto& ns = symbols.namespaceOf(e);
+    switch (e.GetEntityKind()) {
+        case EntityKind::enum_:
+        case EntityKind::header:
+            return InNamespace(ns, fmt::format("#include \"{}\"\n", e.sourcePath));
+        case EntityKind::fn:
+            return InNamespace(
+                ns,
+                fmt::format("{}\n",
+                            std::get<EntityDependentProperties::Fn>(e.dependentProps).declaration));
+        case EntityKind::struct_:
+        case EntityKind::class_: {
+            // TODO (not here) determine source files' relative dires and
+            // generate output files according to relative dirs.
+            // TODO (not here): check how fmt::format formats paths on Windows (unicode)
+            // TODO: for k_nmtIncludeMemberDeclarationsMacro consider using either R""
+            // literals or generic_path, because of the slashes and other characters.
+            // Also need to verify how unicode paths work.
+            fs::path memberDeclarationsPath;
+            if (!members) {
+                memberDeclarationsPath = project.emptyHeaderPath(true, e.targetId);
+            } else {
+                std::string mdContent = fmt::format("{}\n\n", k_autogeneratedWarningLine);
+                for (auto& m : k_memberDefinitionMacros) {
+                    mdContent += fmt::format("#define {} {}\n", m.name, m.forHeader);
+                }
+                mdContent += "\n";
+                for (auto& mfid : *members) {
+                    auto& mfe = project.entities().entity(mfid);
+                    auto& dp = std::get<std::to_underlying(EntityKind::memfn)>(mfe.dependentProps);
+                    mdContent += fmt::format("{}\n", dp.declaration);
+                }
+                mdContent += "\n";
+                for (auto& m : k_memberDefinitionMacros) {
+                    mdContent += fmt::format("#undef {}\n", m.name);
+                }
+                memberDeclarationsPath = project.memberDeclarationsPath(true, id);
+                gfw.Write(memberDeclarationsPath, mdContent, fingerprint);
+            }
+            return fmt::format(
+                "#define {} \"{}\"\n{}#undef {}\n",
+                k_nmtIncludeMemberDeclarationsMacro,
+                project.targets().at(e.targetId).outputDir / memberDeclarationsPath,
+                InNamespace(ns, fmt::format("#include \"{}\"\n", e.sourcePath)),
+                k_nmtIncludeMemberDeclarationsMacro);
         }
-        std::ranges::sort(parentDirToSubdir);
-        for (size_t i = 0; i < parentDirToSubdir.size(); ++i) {
-            DCHECK(parentDirToSubdir[i - 1].first != parentDirToSubdir[i].first) << fmt::format(
-                "Duplicated parent paths for dir config files: {}", parentDirToSubdir[i - 1].first);
+        case EntityKind::memfn:
+            // memfn declaration goes to the member function declaration file which gets
+            // injected with a macro.
+            LOG(FATAL) << "No declaration content for a member function.";
+    }
+}
+
+// The name of the module of a target. Module names are identifiers separated by dots.
+std::string ModuleName(std::string_view targetName) {
+    std::string r;
+    for (auto c : targetName) {
+        r += isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' ? c : '_';
+    }
+    if (r.empty() || isdigit(static_cast<unsigned char>(r.front()))) {
+        r.insert(0, "_");
+    }
+    return r;
+}
+
+// The start of a module unit: the global module fragment with the headers, the module declaration,
+// the imports and the `struct Foo` needs, which are attached to the global module.
+std::string ModuleUnitPreamble(std::vector<std::string> headers,
+                               std::string_view moduleDeclaration,
+                               std::vector<std::string> imports,
+                               std::vector<std::string> rawForwardDeclarations) {
+    std::string content = fmt::format("{}\n", k_autogeneratedWarningLine);
+    if (!headers.empty()) {
+        sort_unique_inplace(headers);
+        content += "module;\n";
+        for (auto& h : headers) {
+            content += fmt::format("#include {}\n", h);
         }
+        content += "\n";
     }
-    const fs::path& subdir(const fs::path& sourcePath) const {
-        static const fs::path k_emptyPath;
-        if (parentDirToSubdir.empty() || !sourcePath.has_parent_path()) {
-            return k_emptyPath;
+    content += fmt::format("{};\n", moduleDeclaration);
+    if (!imports.empty()) {
+        sort_unique_inplace(imports);
+        content += "\n";
+        for (auto& i : imports) {
+            content += fmt::format("import {};\n", i);
         }
-        auto parentPath = sourcePath.parent_path();
-        auto it = std::ranges::upper_bound(
-            parentDirToSubdir, parentPath, {}, [](auto&& x) -> const fs::path& {
-                return x.first;
-            });
-        if (it == std::ranges::begin(parentDirToSubdir)) {
-            return k_emptyPath;
+    }
+    if (!rawForwardDeclarations.empty()) {
+        sort_unique_inplace(rawForwardDeclarations);
+        content += "\nextern \"C++\" {\n";
+        for (auto& fd : rawForwardDeclarations) {
+            content += fmt::format("{}\n", fd);
+        }
+        content += "}\n";
+    }
+    return content;
+}
+
+// The primary module interface unit of a target: the declarations of its non-member entities
+// `ids`, ordered by their needs, the public ones exported.
+std::expected<std::string, std::vector<std::string>> ModuleInterfaceContent(
+    const Project& project,
+    const SymbolTable& symbols,
+    AutoForwardDeclarations autoForwardDeclarations,
+    const MemberRelations& memberRelations,
+    GeneratedFileWriter& gfw,
+    int64_t targetId,
+    std::span<const Entities::Id> ids) {
+    auto& entities = project.entities();
+    auto& targetName = project.targets().at(targetId).name;
+    std::vector<std::string> errors, headers, imports, rawForwardDeclarations, forwardDeclarations;
+    flat_hash_map<Entities::Id, std::vector<Entities::Id>> neededInTarget;
+    for (auto id : ids) {
+        auto& e = entities.entity(id);
+        IncludeSectionBuilder includes(project, symbols);
+        AddHeaderNeeds(
+            includes, project, autoForwardDeclarations, e, MembersOrNull(memberRelations, id));
+        auto partsOr = includes.renderModuleParts();
+        if (!partsOr) {
+            for (auto& error : partsOr.error()) {
+                errors.push_back(fmt::format(
+                    "Failed generating boilerplate for {}, reason: {}", e.sourcePath, error));
+            }
+            continue;
+        }
+        auto& parts = *partsOr;
+        append_range(headers, std::move(parts.headers));
+        append_range(rawForwardDeclarations, std::move(parts.rawForwardDeclarations));
+        for (auto nid : parts.needed) {
+            if (entities.targetId(nid) == targetId) {
+                neededInTarget[id].push_back(nid);
+            } else {
+                imports.push_back(ModuleName(project.targets().at(entities.targetId(nid)).name));
+            }
+        }
+        for (auto nid : parts.forwardDeclared) {
+            auto& ne = entities.entity(nid);
+            if (ne.targetId == targetId) {
+                // A redeclaration must be exported if and only if the first declaration is.
+                forwardDeclarations.push_back(
+                    fmt::format("{}{}",
+                                ne.visibility == Visibility::public_ ? "export " : "",
+                                NamespacedForwardDeclaration(symbols, ne)));
+            } else {
+                imports.push_back(ModuleName(project.targets().at(ne.targetId).name));
+            }
+        }
+    }
+
+    // Unlike the headers, the declarations can't include what they need: the needed entities of
+    // the target are declared first.
+    std::vector<Entities::Id> order;
+    flat_hash_map<Entities::Id, bool> visited;  // False while visiting the needs.
+    auto visit = [&](auto& self, Entities::Id id) -> void {
+        if (auto it = visited.find(id); it != visited.end()) {
+            if (!it->second) {
+                errors.push_back(fmt::format("Circular needs in module `{}` at {}",
+                                             ModuleName(targetName),
+                                             entities.sourcePath(id)));
+            }
+            return;
+        }
+        visited.emplace(id, false);
+        if (auto it = neededInTarget.find(id); it != neededInTarget.end()) {
+            for (auto nid : it->second) {
+                self(self, nid);
+            }
+        }
+        visited[id] = true;
+        order.push_back(id);
+    };
+    for (auto id : ids) {
+        visit(visit, id);
+    }
+    if (!errors.empty()) {
+        return std::unexpected(std::move(errors));
+    }
+
+    std::string content =
+        ModuleUnitPreamble(std::move(headers),
+                           fmt::format("export module {}", ModuleName(targetName)),
+                           std::move(imports),
+                           std::move(rawForwardDeclarations));
+    if (!forwardDeclarations.empty()) {
+        sort_unique_inplace(forwardDeclarations);
+        content += "\n";
+        for (auto& fd : forwardDeclarations) {
+            content += fmt::format("{}\n", fd);
         }
-        --it;  // There is always a previous item because parentDirToSubdir is not empty.
-        auto mr = std::ranges::mismatch(it->first, parentPath);
-        bool dirConfigFileParentIsPrefixOfSourcePath = mr.in1 == it->first.end();
-        return dirConfigFileParentIsPrefixOfSourcePath ? it->second : k_emptyPath;
     }
+    for (auto id : order) {
+        auto& e = entities.entity(id);
+        auto declaration = DeclarationContent(
+            project, symbols, gfw, id, e, MembersOrNull(memberRelations, id), std::nullopt);
+        if (e.visibility == Visibility::public_) {
+            content += fmt::format("\nexport {{\n{}}}\n", declaration);
+        } else {
+            content += fmt::format("\n{}", declaration);
+        }
+    }
+    return content;
+}
+
+// A module implementation unit with the definition of a function or member function.
+std::expected<std::string, std::vector<std::string>> ModuleImplementationContent(
+    const Project& project,
+    const SymbolTable& symbols,
+    const Entity& e,
+    const std::vector<std::string>& definitionNeeds) {
+    IncludeSectionBuilder includes(project, symbols);
+    includes.addNeedsAsHeaders(project.entities(), e, definitionNeeds);
+    TRY_ASSIGN(parts, includes.renderModuleParts());
+    // The entities of the own target are declared by the module interface.
+    std::vector<std::string> imports;
+    for (auto* v : {&parts.needed, &parts.forwardDeclared}) {
+        for (auto nid : *v) {
+            auto neededTargetId = project.entities().targetId(nid);
+            if (neededTargetId != e.targetId) {
+                imports.push_back(ModuleName(project.targets().at(neededTargetId).name));
+            }
+        }
+    }
+    auto& targetName = project.targets().at(e.targetId).name;
+    std::string content = ModuleUnitPreamble(std::move(parts.headers),
+                                             fmt::format("module {}", ModuleName(targetName)),
+                                             std::move(imports),
+                                             std::move(parts.rawForwardDeclarations));
+    auto includeSource =
+        InNamespace(symbols.namespaceOf(e), fmt::format("#include \"{}\"\n", e.sourcePath));
+    if (e.GetEntityKind() != EntityKind::memfn) {
+        return content + fmt::format("\n{}", includeSource);
+    }
+    content += "\n";
+    for (auto& m : k_memberDefinitionMacros) {
+        content += fmt::format("#define {} {}\n", m.name, m.forCpp);
+    }
+    content += fmt::format("\n{}\n", includeSource);
+    for (auto& m : k_memberDefinitionMacros) {
+        content += fmt::format("#undef {}\n", m.name);
+    }
+    return content;
+}
+
+// The generated headers of a target, relative to the output dir.
+struct TargetHeaders {
+    int64_t targetId = 0;
+    // The entity headers, which include everything they need so they can be compiled alone.
+    std::vector<fs::path> selfContained;
+    // The member declarations and the empty header, included in the middle of the sources.
+    std::vector<fs::path> textual;
 };
-*/
+
+// Module names and the submodule names of Clang are identifiers.
+std::string ClangModuleName(std::string_view name) {
+    auto r = ModuleName(name);
+    std::ranges::replace(r, '.', '_');
+    return r;
+}
+
+// A Clang module per target with a submodule per entity header, for `-fmodules`: each entity
+// header is parsed once and loaded from the module cache in the other translation units.
+std::string ClangModuleMapContent(const Project& project, std::span<const TargetHeaders> targets) {
+    std::string content = fmt::format("{}\n", k_autogeneratedWarningLine);
+    for (auto& th : targets) {
+        content += fmt::format("\nmodule nmt_{} {{\n",
+                               ClangModuleName(project.targets().at(th.targetId).name));
+        for (auto& h : th.textual) {
+            content += fmt::format("    textual header \"{}\"\n", h.generic_string());
+        }
+        flat_hash_set<std::string> names;
+        for (auto& h : th.selfContained) {
+            auto name = ClangModuleName(h.generic_string());
+            for (int i = 2; !names.insert(name).second; ++i) {
+                name = fmt::format("{}_{}", ClangModuleName(h.generic_string()), i);
+            }
+            content += fmt::format(
+                "    module {} {{\n        header \"{}\"\n        export *\n    }}\n",
+                name,
+                h.generic_string());
+        }
+        content += "}\n";
+    }
+    return content;
+}
+
+// The GCC module mapper file (`-fmodule-mapper=<file>`): a line for each entity header with its
+// path as included, which is absolute, and its compiled module interface, relative to the module
+// repository (`gcm.cache` by default). The header units are built with `-fmodule-header`. The
+// format has no comments, so no autogenerated warning.
+std::string GccModuleMapperContent(const fs::path& outputDir,
+                                   std::span<const TargetHeaders> targets) {
+    std::string content;
+    for (auto& th : targets) {
+        for (auto& h : th.selfContained) {
+            content += fmt::format(
+                "{} nmt/{}.gcm\n", (outputDir / h).generic_string(), h.generic_string());
+        }
+    }
+    return content;
+}
+
 }  // namespace
 
 std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
-    const Project& project) {
+    const Project& project,
+    Diagnostics& diagnostics,
+    OutputMode outputMode,
+    AutoForwardDeclarations autoForwardDeclarations) {
     node_hash_map<fs::path, GeneratedFileWriter, path_hash> gfws;
     std::vector<std::string> errors;
 
@@ -202,79 +757,51 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
 
     auto entityIds = project.entities().itemsWithEntities();
 
-    /*
-    TargetSubdirOfSourcePath targetSubdirOfSourcePath(project.dirConfigFiles);
-    auto targetSubdirOfSourcePathFn = [&targetSubdirOfSourcePath](const fs::path& x) {
-        return targetSubdirOfSourcePath.subdir(x);
+    const auto memberRelations = FindMemberRelations(project, entityIds, errors);
+    const SymbolTable symbols(project);
+    auto& membersToContainingEntityMap = memberRelations.memberToContainingEntity;
+    auto membersOrNull = [&](Entities::Id id) {
+        return MembersOrNull(memberRelations, id);
     };
-*/
 
-    flat_hash_map<int64_t, std::vector<Entities::Id>> containingEntityToMembersMap;
-    flat_hash_map<int64_t, int64_t> membersToContainingEntityMap;
-    {
-        for (auto id : entityIds) {
+    // Hashing the resolved needs is the bulk of the work for the unchanged entities. It only reads
+    // the project so it's done in parallel, the files are produced in order below. In batches, so
+    // in streaming mode the entities loaded for a batch can be dropped before the next one.
+    constexpr size_t k_entitiesPerBatch = 4096, k_entitiesPerTask = 64;
+    auto hashBatch = [&](size_t batchBegin) {
+        auto batchIds = std::span(entityIds).subspan(
+            batchBegin, std::min(k_entitiesPerBatch, entityIds.size() - batchBegin));
+        return ParallelMap(batchIds.size(), k_entitiesPerTask, [&](size_t i) {
+            auto id = batchIds[i];
             auto& e = project.entities().entity(id);
-            fmt::print("- {}\n", e.sourcePath);
-            if (auto* memfn = std::get_if<EntityDependentProperties::MemFn>(&e.dependentProps)) {
-                std::optional<fs::path> parentBasePath;
-                if (e.sourcePath.has_parent_path()) {
-                    auto parentPath = e.sourcePath.parent_path();
-                    if (auto structOrClassName =
-                            extractContainingStructOrClassNameFromMemberDir(parentPath)) {
-                        parentBasePath = parentPath.replace_filename(*structOrClassName);
-                    }
-                }
-                if (parentBasePath) {
-                    std::vector<int64_t> matchingContainingEntities;
-                    std::vector<fs::path> matchingContainingSourceFiles;
-                    for (auto hx : k_validSourceExtensions) {
-                        auto testPath = *parentBasePath;
-                        testPath.replace_extension(hx);
-                        if (auto maybeId =
-                                project.entities().findEntityBySourcePath(e.targetId, testPath)) {
-                            matchingContainingEntities.push_back(*maybeId);
-                            matchingContainingSourceFiles.push_back(std::move(testPath));
-                        }
-                    }
-                    switch (matchingContainingEntities.size()) {
-                        case 0:
-                            errors.push_back(
-                                fmt::format("Member function source file `{}`: no containing "
-                                            "class/struct source file found, extensions tried: {}",
-                                            e.sourcePath,
-                                            fmt::join(k_validSourceExtensions, ", ")));
-                            break;
-                        case 1: {
-                            containingEntityToMembersMap[matchingContainingEntities.front()]
-                                .push_back(id);
-                            auto itb = membersToContainingEntityMap.insert(
-                                std::make_pair(id, matchingContainingEntities.front()));
-                            CHECK(itb.second)
-                                << fmt::format("Entity #{} has 2 containing entities: #{} and #{}",
-                                               id,
-                                               itb.first->second,
-                                               matchingContainingEntities.front());
-                        } break;
-                        default:
-                            errors.push_back(
-                                fmt::format("Member function source file `{}`: multiple containing "
-                                            "class/struct source files found: {}",
-                                            e.sourcePath,
-                                            fmt::join(matchingContainingSourceFiles, ", ")));
-                            break;
-                    }
-                } else {
-                    errors.push_back(fmt::format(
-                        "Member function source file `{}` has no parent path", e.sourcePath));
-                }
+            auto& outputDir = project.targets().at(e.targetId).outputDir;
+            auto* members = membersOrNull(id);
+            std::optional<Entities::Id> containingEntity;
+            if (auto it = membersToContainingEntityMap.find(id);
+                it != membersToContainingEntityMap.end()) {
+                containingEntity = it->second;
             }
+            return EntityFingerprint(project,
+                                     symbols,
+                                     outputMode,
+                                     autoForwardDeclarations,
+                                     id,
+                                     outputDir,
+                                     members,
+                                     containingEntity);
+        });
+    };
+
+    std::vector<uint64_t> fingerprints;
+    for (size_t entityIndex = 0; entityIndex < entityIds.size(); ++entityIndex) {
+        if (entityIndex % k_entitiesPerBatch == 0) {
+            // No reference to the entities of the previous batch is held here.
+            project.entities().trimSpillCache();
+            fingerprints = hashBatch(entityIndex);
         }
-    }
-    for (auto id : entityIds) {
+        auto id = entityIds[entityIndex];
         auto& e = project.entities().entity(id);
-        auto targetIt = project.targets().find(e.targetId);
-        CHECK(targetIt != project.targets().end());
-        auto& target = targetIt->second;
+        auto& target = project.targets().at(e.targetId);
         auto& gfw = addGfw(target.outputDir, e.targetId);
         bool generateHeader;
         switch (e.GetEntityKind()) {
@@ -289,73 +816,57 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
                 generateHeader = false;
                 break;
         }
+        if (outputMode == OutputMode::modules) {
+            // The declarations go to the module interface of the target, only the definitions
+            // have their own files.
+            if (e.GetEntityKind() != EntityKind::fn && e.GetEntityKind() != EntityKind::memfn) {
+                continue;
+            }
+            generateHeader = false;
+        }
+
+        // Skip producing the files if none of their inputs changed since the previous run.
+        auto* members = membersOrNull(id);
+        const uint64_t fingerprint = fingerprints[entityIndex % k_entitiesPerBatch];
+        {
+            std::vector<fs::path> entityFiles;
+            if (generateHeader) {
+                entityFiles.push_back(project.headerPath(true, id));
+                if (members) {
+                    entityFiles.push_back(project.memberDeclarationsPath(true, id));
+                }
+            }
+            entityFiles.push_back(project.cppPath(true, id));
+            if (std::ranges::all_of(entityFiles, [&](const fs::path& f) {
+                    return gfw.IsUnchanged(f, fingerprint);
+                })) {
+                for (auto& f : entityFiles) {
+                    gfw.Keep(f, fingerprint);
+                }
+                continue;
+            }
+        }
+
+        if (outputMode == OutputMode::modules) {
+            auto contentOr = ModuleImplementationContent(
+                project,
+                symbols,
+                e,
+                FunctionDefinitionNeeds(project.entities(), symbols, autoForwardDeclarations, e));
+            if (!contentOr) {
+                append_range(errors, std::move(contentOr.error()));
+                continue;
+            }
+            gfw.Write(project.cppPath(true, id), *contentOr, fingerprint);
+            continue;
+        }
+
         if (generateHeader) {
             std::string headerContent =
                 fmt::format("{}\n#pragma once\n", k_autogeneratedWarningLine);
             {
-                IncludeSectionBuilder includes(project);
-                auto addNeedsAsHeaders =
-                    [&includes, &e, &project](const std::vector<std::string>& needs) {
-                        includes.addNeedsAsHeaders(project.entities(), e, needs);
-                    };
-                switch (e.GetEntityKind()) {
-                    case EntityKind::enum_:
-                        addNeedsAsHeaders(
-                            std::get<EntityDependentProperties::Enum>(e.dependentProps)
-                                .opaqueEnumDeclarationNeeds);
-                        addNeedsAsHeaders(
-                            std::get<EntityDependentProperties::Enum>(e.dependentProps)
-                                .declarationNeeds);
-                        break;
-                    case EntityKind::fn:
-                        addNeedsAsHeaders(std::get<EntityDependentProperties::Fn>(e.dependentProps)
-                                              .declarationNeeds);
-                        break;
-                    case EntityKind::struct_: {
-                        addNeedsAsHeaders(
-                            std::get<std::to_underlying(EntityKind::struct_)>(e.dependentProps)
-                                .forwardDeclarationNeeds);
-                        addNeedsAsHeaders(
-                            std::get<std::to_underlying(EntityKind::struct_)>(e.dependentProps)
-                                .declarationNeeds);
-                        auto it = containingEntityToMembersMap.find(id);
-                        if (it != containingEntityToMembersMap.end()) {
-                            for (auto& mfid : it->second) {
-                                auto& me = project.entities().entity(mfid);
-                                assert(me.GetEntityKind() == EntityKind::memfn);
-                                auto& dp = std::get<std::to_underlying(EntityKind::memfn)>(
-                                    me.dependentProps);
-                                addNeedsAsHeaders(dp.declarationNeeds);
-                            }
-                        }
-                    } break;
-                    case EntityKind::class_: {
-                        addNeedsAsHeaders(
-                            std::get<std::to_underlying(EntityKind::class_)>(e.dependentProps)
-                                .forwardDeclarationNeeds);
-                        addNeedsAsHeaders(
-                            std::get<std::to_underlying(EntityKind::class_)>(e.dependentProps)
-                                .declarationNeeds);
-                        auto it = containingEntityToMembersMap.find(id);
-                        if (it != containingEntityToMembersMap.end()) {
-                            for (auto& mfid : it->second) {
-                                auto& me = project.entities().entity(mfid);
-                                assert(me.GetEntityKind() == EntityKind::memfn);
-                                auto& dp = std::get<std::to_underlying(EntityKind::memfn)>(
-                                    me.dependentProps);
-                                addNeedsAsHeaders(dp.declarationNeeds);
-                            }
-                        }
-                    } break;
-                    case EntityKind::header:
-                        addNeedsAsHeaders(
-                            std::get<EntityDependentProperties::Header>(e.dependentProps)
-                                .declarationNeeds);
-                        break;
-                    case EntityKind::memfn:
-                        // memfn's declaration needs go to the class/struct header.
-                        break;
-                }
+                IncludeSectionBuilder includes(project, symbols);
+                AddHeaderNeeds(includes, project, autoForwardDeclarations, e, members);
                 auto renderedHeadersOr = includes.render();
                 if (!renderedHeadersOr) {
                     for (auto& error : renderedHeadersOr.error()) {
@@ -372,86 +883,41 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
                 }
             }
             headerContent += "\n";
-            switch (e.GetEntityKind()) {
-                case EntityKind::enum_:
-                case EntityKind::header:
-                    headerContent += fmt::format("#include \"{}\"\n", e.sourcePath);
-                    break;
-                case EntityKind::fn:
-                    headerContent += fmt::format(
-                        "{}\n",
-                        std::get<EntityDependentProperties::Fn>(e.dependentProps).declaration);
-                    break;
-                case EntityKind::struct_:
-                case EntityKind::class_: {
-                    // TODO (not here) determine source files' relative dires and
-                    // generate output files according to relative dirs.
-                    // TODO (not here): check how fmt::format formats paths on Windows (unicode)
-                    // TODO: for k_nmtIncludeMemberDeclarationsMacro consider using either R""
-                    // literals or generic_path, because of the slashes and other characters.
-                    // Also need to verify how unicode paths work.
-                    auto it = containingEntityToMembersMap.find(id);
-                    fs::path memberDeclarationsPath;
-                    if (it == containingEntityToMembersMap.end()) {
-                        memberDeclarationsPath = project.emptyHeaderPath(true, e.targetId);
-                    } else {
-                        std::string mdContent = fmt::format("{}\n\n", k_autogeneratedWarningLine);
-                        for (auto& m : k_memberDefinitionMacros) {
-                            mdContent += fmt::format("#define {} {}\n", m.name, m.forHeader);
-                        }
-                        mdContent += "\n";
-                        for (auto& mfid : it->second) {
-                            auto& mfe = project.entities().entity(mfid);
-                            auto& dp =
-                                std::get<std::to_underlying(EntityKind::memfn)>(mfe.dependentProps);
-                            mdContent += fmt::format("{}\n", dp.declaration);
-                        }
-                        mdContent += "\n";
-                        for (auto& m : k_memberDefinitionMacros) {
-                            mdContent += fmt::format("#undef {}\n", m.name);
-                        }
-                        memberDeclarationsPath = project.memberDeclarationsPath(true, id);
-                        gfw.Write(memberDeclarationsPath, mdContent);
-                    }
-                    headerContent += fmt::format("#define {} \"{}\"\n#include \"{}\"\n#undef {}\n",
-                                                 k_nmtIncludeMemberDeclarationsMacro,
-                                                 target.outputDir / memberDeclarationsPath,
-                                                 e.sourcePath,
-                                                 k_nmtIncludeMemberDeclarationsMacro);
-                } break;
-                case EntityKind::memfn:
-                    // memfn declaration goes to the member function declaration file which gets
-                    // injected with a macro.
-                    CHECK(false);
-                    break;
-            }
+            headerContent += DeclarationContent(project, symbols, gfw, id, e, members, fingerprint);
 
-            fmt::print("Processed {} from {}\n", e.name, e.sourcePath);
-            gfw.Write(project.headerPath(true, id), headerContent);
+            diagnostics.report<Diagnostic::GeneratedHeader>(id);
+            gfw.Write(project.headerPath(true, id), headerContent, fingerprint);
         }
         std::string cppContent;
         bool cppContentProductionFailed = false;
         switch_variant(
             e.dependentProps,
-            [&](const EntityDependentProperties::Fn& dp) {
+            [&](const EntityDependentProperties::Fn&) {
                 cppContent += fmt::format("{}\n#include \"{}\"\n",
                                           k_autogeneratedWarningLine,
                                           project.headerPath(false, id));
-                IncludeSectionBuilder includes(project);
-
-                includes.addNeedsAsHeaders(project.entities(), e, dp.definitionNeeds);
+                IncludeSectionBuilder includes(project, symbols);
+                includes.addNeedsAsHeaders(
+                    project.entities(),
+                    e,
+                    FunctionDefinitionNeeds(
+                        project.entities(), symbols, autoForwardDeclarations, e));
                 auto renderedHeadersOr = includes.render();
                 if (!renderedHeadersOr) {
                     append_range(errors, std::move(renderedHeadersOr.error()));
+                    cppContentProductionFailed = true;
                     return;
                 }
                 auto& renderedHeaders = *renderedHeadersOr;
                 if (!renderedHeaders.empty()) {
                     cppContent += fmt::format("\n{}", renderedHeaders);
                 }
-                cppContent += fmt::format("\n#include \"{}\"\n", e.sourcePath);
+                cppContent += fmt::format(
+                    "\n{}",
+                    InNamespace(symbols.namespaceOf(e),
+                                fmt::format("#include \"{}\"\n", e.sourcePath)));
             },
-            [&](const EntityDependentProperties::MemFn& dp) {
+            [&](const EntityDependentProperties::MemFn&) {
                 auto ceIt = membersToContainingEntityMap.find(id);
                 CHECK(ceIt != membersToContainingEntityMap.end())
                     << fmt::format("Containing struct/class not found for `{}`", e.sourcePath);
@@ -459,11 +925,16 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
                 cppContent += fmt::format("{}\n#include \"{}\"\n",
                                           k_autogeneratedWarningLine,
                                           project.headerPath(false, ceId));
-                IncludeSectionBuilder includes(project);
-                includes.addNeedsAsHeaders(project.entities(), e, dp.definitionNeeds);
+                IncludeSectionBuilder includes(project, symbols);
+                includes.addNeedsAsHeaders(
+                    project.entities(),
+                    e,
+                    FunctionDefinitionNeeds(
+                        project.entities(), symbols, autoForwardDeclarations, e));
                 auto renderedHeadersOr = includes.render();
                 if (!renderedHeadersOr) {
                     append_range(errors, std::move(renderedHeadersOr.error()));
+                    cppContentProductionFailed = true;
                     return;
                 }
                 auto& renderedHeaders = *renderedHeadersOr;
@@ -474,7 +945,10 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
                 for (auto& m : k_memberDefinitionMacros) {
                     cppContent += fmt::format("#define {} {}\n", m.name, m.forCpp);
                 }
-                cppContent += fmt::format("\n#include \"{}\"\n\n", e.sourcePath);
+                cppContent += fmt::format(
+                    "\n{}\n",
+                    InNamespace(symbols.namespaceOf(e),
+                                fmt::format("#include \"{}\"\n", e.sourcePath)));
                 for (auto& m : k_memberDefinitionMacros) {
                     cppContent += fmt::format("#undef {}\n", m.name);
                 }
@@ -485,10 +959,73 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
                                           project.headerPath(false, id));
             });
         if (cppContentProductionFailed) {
+            // The header is already written, without its fingerprint the next run produces the
+            // files again and reports the error again.
+            if (generateHeader) {
+                gfw.DropFingerprint(project.headerPath(true, id));
+                if (members) {
+                    gfw.DropFingerprint(project.memberDeclarationsPath(true, id));
+                }
+            }
             continue;
         }
-        gfw.Write(project.cppPath(true, id), cppContent);
+        gfw.Write(project.cppPath(true, id), cppContent, fingerprint);
     }  // for a: entities
+    if (outputMode == OutputMode::modules) {
+        for (auto targetId : project.targetsDisplayOrder()) {
+            project.entities().trimSpillCache();
+            std::vector<Entities::Id> ids;
+            for (auto id : entityIds) {
+                if (project.entities().targetId(id) == targetId
+                    && !isMemberEntityKind(project.entities().entitySummary(id).GetEntityKind())) {
+                    ids.push_back(id);
+                }
+            }
+            auto& target = project.targets().at(targetId);
+            auto& gfw = addGfw(target.outputDir, targetId);
+            auto contentOr = ModuleInterfaceContent(
+                project, symbols, autoForwardDeclarations, memberRelations, gfw, targetId, ids);
+            if (!contentOr) {
+                append_range(errors, std::move(contentOr.error()));
+                continue;
+            }
+            gfw.Write(project.moduleInterfacePath(true, targetId), *contentOr);
+        }
+    }
+    if (outputMode == OutputMode::headers) {
+        // The module maps of the targets sharing an output dir are written to the same files.
+        flat_hash_map<int64_t, TargetHeaders> headersByTarget;
+        for (auto id : entityIds) {
+            auto& e = project.entities().entitySummary(id);
+            if (e.GetEntityKind() == EntityKind::memfn) {
+                continue;
+            }
+            auto& th = headersByTarget[e.targetId];
+            th.selfContained.push_back(project.headerPath(true, id));
+            if (membersOrNull(id)) {
+                th.textual.push_back(project.memberDeclarationsPath(true, id));
+            }
+        }
+        node_hash_map<fs::path, std::vector<TargetHeaders>, path_hash> headersByOutputDir;
+        for (auto targetId : project.targetsDisplayOrder()) {
+            auto it = headersByTarget.find(targetId);
+            if (it == headersByTarget.end()) {
+                continue;
+            }
+            auto& th = it->second;
+            th.targetId = targetId;
+            th.textual.push_back(project.emptyHeaderPath(true, targetId));
+            std::ranges::sort(th.selfContained);
+            std::ranges::sort(th.textual);
+            headersByOutputDir[project.targets().at(targetId).outputDir].push_back(std::move(th));
+        }
+        for (auto& [outputDir, targets] : headersByOutputDir) {
+            auto& gfw = gfws.at(outputDir);
+            gfw.WriteNonSource(k_clangModuleMapFilename, ClangModuleMapContent(project, targets));
+            gfw.WriteNonSource(k_gccModuleMapperFilename,
+                               GccModuleMapperContent(outputDir, targets));
+        }
+    }
     flat_hash_set<fs::path, path_hash> generatedFiles;
     for (auto& [k, gfw] : gfws) {
         std::ranges::sort(gfw.currentFiles);
@@ -504,6 +1041,7 @@ std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
             fileListContent += fmt::format("{}\n", c);
         }
         gfw.Write(k_fileListFilename, fileListContent);
+        gfw.Flush();
         gfw.RemoveRemainingExistingFilesAndDirs();
     }
     if (errors.empty()) {
@@ -1,9 +1,18 @@
 #pragma once
 
+#include "nmt/enums.h"
+
 #include <expected>
 #include <string>
 #include <variant>
 
+class Diagnostics;
 struct Project;
 
-std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(const Project& project);
+/// Return the errors, the verbose diagnostics are reported to `diagnostics`. The needs are forward
+/// declared automatically only with `AutoForwardDeclarations::apply`.
+std::expected<std::monostate, std::vector<std::string>> GenerateBoilerplate(
+    const Project& project,
+    Diagnostics& diagnostics,
+    OutputMode outputMode = OutputMode::headers,
+    AutoForwardDeclarations autoForwardDeclarations = AutoForwardDeclarations::off);
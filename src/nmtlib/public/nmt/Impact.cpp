@@ -0,0 +1,107 @@
+#include "nmt/Impact.h"
+
+#include "nmt/IncludeGraph.h"
+#include "nmt/Project.h"
+#include "nmt/constants.h"
+
+namespace fs = std::filesystem;
+
+std::expected<ImpactReport, std::string> ComputeImpact(
+    const Project& project,
+    std::span<const fs::path> changedSources,
+    AutoForwardDeclarations autoForwardDeclarations) {
+    auto& entities = project.entities();
+    std::vector<Entities::Id> changedIds;
+    flat_hash_set<fs::path, path_hash> changedConfigDirs;
+    for (auto& source : changedSources) {
+        std::error_code ec;
+        auto path = fs::canonical(source, ec);
+        if (ec) {
+            return std::unexpected(
+                fmt::format("Can't get canonical path of {}: {}", source, ec.message()));
+        }
+        std::optional<Entities::Id> id;
+        for (auto& [targetId, target] : project.targets()) {
+            if (!id) {
+                id = entities.findEntityBySourcePath(targetId, path);
+            }
+        }
+        if (!id && path_to_string(path.stem()) == k_dirConfigFileName) {
+            // Changes the namespace of the entities inheriting it.
+            for (auto& dir : project.dirConfigs().dependentDirs(path.parent_path())) {
+                changedConfigDirs.insert(std::move(dir));
+            }
+            continue;
+        }
+        if (!id) {
+            return std::unexpected(fmt::format("{} is not an entity of the project", path));
+        }
+        changedIds.push_back(*id);
+    }
+
+    auto entityIds = entities.itemsWithEntities();
+    if (!changedConfigDirs.empty()) {
+        for (auto id : entityIds) {
+            if (changedConfigDirs.contains(entities.sourcePath(id).parent_path())) {
+                changedIds.push_back(id);
+            }
+        }
+    }
+    std::vector<std::string> errors;  // Reported by generating the boilerplate.
+    auto memberRelations = FindMemberRelations(project, entityIds, errors);
+    IncludeGraph includeGraph(project, memberRelations, autoForwardDeclarations);
+
+    // Entities whose generated files are regenerated, and those whose header or cpp includes an
+    // affected file.
+    flat_hash_set<Entities::Id> regenerated;
+    std::vector<Entities::Id> changedHeaders, forwardDeclaringCpps;
+    for (auto id : changedIds) {
+        regenerated.insert(id);
+        if (auto it = memberRelations.memberToContainingEntity.find(id);
+            it != memberRelations.memberToContainingEntity.end()) {
+            // The declaration is in the member declarations of the containing entity.
+            regenerated.insert(it->second);
+            changedHeaders.push_back(it->second);
+        } else if (!isMemberEntityKind(entities.entitySummary(id).GetEntityKind())) {
+            changedHeaders.push_back(id);
+        }
+        // The files inlining the forward declaration are regenerated, conservatively: the forward
+        // declaration may not have changed.
+        for (auto x : includeGraph.headerForwardDeclarers(id)) {
+            regenerated.insert(x);
+            changedHeaders.push_back(x);
+        }
+        for (auto x : includeGraph.cppForwardDeclarers(id)) {
+            regenerated.insert(x);
+            forwardDeclaringCpps.push_back(x);
+        }
+    }
+    auto affectedHeaders = includeGraph.transitiveHeaderIncluders(changedHeaders);
+    auto affectedCpps = includeGraph.cppIncluders(affectedHeaders);
+    affectedCpps.insert(BEGIN_END(changedIds));  // Includes the source.
+    affectedCpps.insert(BEGIN_END(forwardDeclaringCpps));
+
+    ImpactReport report;
+    flat_hash_set<int64_t> targetIds;
+    auto addFile = [&](fs::path path, Entities::Id id) {
+        report.files.push_back(ImpactReport::File{
+            .path = std::move(path), .entityId = id, .regenerated = regenerated.contains(id)});
+        targetIds.insert(entities.targetId(id));
+    };
+    for (auto id : affectedHeaders) {
+        addFile(project.headerPath(false, id), id);
+        if (memberRelations.containingEntityToMembers.contains(id)) {
+            addFile(project.memberDeclarationsPath(false, id), id);
+        }
+    }
+    for (auto id : affectedCpps) {
+        addFile(project.cppPath(false, id), id);
+    }
+    report.recompiledCpps = affectedCpps.size();
+    std::ranges::sort(report.files, {}, &ImpactReport::File::path);
+    for (auto targetId : targetIds) {
+        report.targets.push_back(project.targets().at(targetId).name);
+    }
+    std::ranges::sort(report.targets);
+    return report;
+}
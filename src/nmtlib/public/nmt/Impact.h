@@ -0,0 +1,38 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/enums.h"
+
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+struct Project;
+
+// The generated files affected by changing some sources.
+struct ImpactReport {
+    struct File {
+        std::filesystem::path path;
+        Entities::Id entityId;
+        // True: the file is regenerated (its content may change). False: its content doesn't
+        // change but it includes a changed file, directly or transitively.
+        bool regenerated;
+    };
+    std::vector<File> files;           // Sorted by path.
+    std::vector<std::string> targets;  // The targets containing the files, sorted.
+    size_t recompiledCpps = 0;         // Number of cpp files in `files`.
+};
+
+/// Return the generated files which are regenerated or (transitively) include a regenerated file
+/// or a source if the `changedSources` change. The needs are taken from the current state of the
+/// project. Walks the reverse include edges of the generated headers: a `Foo*` need inlines the
+/// forward declaration of `Foo` but doesn't include its header, so the changes of `Foo` only
+/// regenerate the files with the forward declaration, they don't propagate through it. A changed
+/// dir config file changes the entities of the dirs inheriting its settings.
+/// Return an error if a changed source is neither an entity nor a dir config file.
+std::expected<ImpactReport, std::string> ComputeImpact(
+    const Project& project,
+    std::span<const std::filesystem::path> changedSources,
+    AutoForwardDeclarations autoForwardDeclarations = AutoForwardDeclarations::off);
@@ -0,0 +1,271 @@
+#include "nmt/IncludeGraph.h"
+
+#include "nmtutil.h"
+
+#include "nmt/ForwardDeclarableNeeds.h"
+#include "nmt/Project.h"
+#include "nmt/SymbolTable.h"
+
+namespace fs = std::filesystem;
+
+MemberRelations FindMemberRelations(const Project& project,
+                                    std::span<const Entities::Id> entityIds,
+                                    std::vector<std::string>& errors) {
+    MemberRelations r;
+    for (auto id : entityIds) {
+        auto& e = project.entities().entitySummary(id);
+        if (!std::holds_alternative<EntityDependentProperties::MemFn>(e.dependentProps)) {
+            continue;
+        }
+        std::optional<fs::path> parentBasePath;
+        if (e.sourcePath.has_parent_path()) {
+            auto parentPath = e.sourcePath.parent_path();
+            if (auto structOrClassName =
+                    extractContainingStructOrClassNameFromMemberDir(parentPath)) {
+                parentBasePath = parentPath.replace_filename(*structOrClassName);
+            }
+        }
+        if (!parentBasePath) {
+            errors.push_back(fmt::format("Member function source file `{}` has no parent path",
+                                         e.sourcePath));
+            continue;
+        }
+        std::vector<int64_t> matchingContainingEntities;
+        std::vector<fs::path> matchingContainingSourceFiles;
+        for (auto hx : k_validSourceExtensions) {
+            auto testPath = *parentBasePath;
+            testPath.replace_extension(hx);
+            if (auto maybeId = project.entities().findEntityBySourcePath(e.targetId, testPath)) {
+                matchingContainingEntities.push_back(*maybeId);
+                matchingContainingSourceFiles.push_back(std::move(testPath));
+            }
+        }
+        switch (matchingContainingEntities.size()) {
+            case 0:
+                errors.push_back(
+                    fmt::format("Member function source file `{}`: no containing "
+                                "class/struct source file found, extensions tried: {}",
+                                e.sourcePath,
+                                fmt::join(k_validSourceExtensions, ", ")));
+                break;
+            case 1: {
+                r.containingEntityToMembers[matchingContainingEntities.front()].push_back(id);
+                auto itb = r.memberToContainingEntity.insert(
+                    std::make_pair(id, matchingContainingEntities.front()));
+                CHECK(itb.second) << fmt::format("Entity #{} has 2 containing entities: #{} and #{}",
+                                                 id,
+                                                 itb.first->second,
+                                                 matchingContainingEntities.front());
+            } break;
+            default:
+                errors.push_back(
+                    fmt::format("Member function source file `{}`: multiple containing "
+                                "class/struct source files found: {}",
+                                e.sourcePath,
+                                fmt::join(matchingContainingSourceFiles, ", ")));
+                break;
+        }
+    }
+    return r;
+}
+
+namespace {
+
+// Append the entities whose headers `needs` include to `result` and the ones forward declared
+// in place to `forwardDeclaredResult`, see `ForwardDeclaresNeed()` for `forwardDeclarable`.
+void ResolveNeeds(const Entities& entities,
+                  const SymbolTable& symbols,
+                  const Entity& e,
+                  const std::vector<std::string>& needs,
+                  const std::vector<std::string>* forwardDeclarable,
+                  std::vector<Entities::Id>& result,
+                  std::vector<Entities::Id>& forwardDeclaredResult) {
+    // The forward declaration needs of a needed entity are resolved in its own target.
+    std::vector<std::pair<const Entity*, const std::vector<std::string>*>> pending{{&e, &needs}};
+    flat_hash_set<Entities::Id> forwardDeclared;  // Against circular forward declaration needs.
+    while (!pending.empty()) {
+        auto [x, xNeeds] = pending.back();
+        pending.pop_back();
+        auto* xForwardDeclarable = xNeeds == &needs ? forwardDeclarable : nullptr;
+        for (auto& need : *xNeeds) {
+            if (need.empty() || need[0] == '<' || need[0] == '"' || need.starts_with("struct ")
+                || need.starts_with("class ") || need.starts_with("enum ")) {
+                continue;
+            }
+            std::string_view needName = need;
+            bool refOnly = needName.back() == '*';
+            if (refOnly) {
+                needName.remove_suffix(1);
+            }
+            auto maybeId = symbols.resolve(*x, needName);
+            if (!maybeId) {
+                continue;
+            }
+            // The kind of the summary tells if the need can be forward declared.
+            auto& summary = entities.entitySummary(*maybeId);
+            refOnly = refOnly || ForwardDeclaresNeed(xForwardDeclarable, need, summary);
+            if (!refOnly) {
+                result.push_back(*maybeId);
+            } else if (forwardDeclared.insert(*maybeId).second) {
+                auto& ne = entities.entity(*maybeId);
+                if (auto* v = ne.ForwardDeclarationNeedsOrNull()) {
+                    pending.emplace_back(&ne, v);
+                    forwardDeclaredResult.push_back(*maybeId);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+IncludeGraph::IncludeGraph(const Project& project,
+                           const MemberRelations& memberRelations,
+                           AutoForwardDeclarations autoForwardDeclarations) {
+    auto& entities = project.entities();
+    auto entityIds = entities.itemsWithEntities();
+    const SymbolTable symbols(project);
+    for (auto id : entityIds) {
+        entities.trimSpillCache();  // No reference to the entities is held between the iterations.
+        auto& e = entities.entity(id);
+        auto& inc = includes[id];
+        auto resolveHeader = [&](const Entity& x,
+                                 const std::vector<std::string>& needs,
+                                 const std::vector<std::string>* forwardDeclarable = nullptr) {
+            ResolveNeeds(entities,
+                         symbols,
+                         x,
+                         needs,
+                         autoForwardDeclarations == AutoForwardDeclarations::apply
+                             ? forwardDeclarable
+                             : nullptr,
+                         inc.header,
+                         inc.headerForwardDeclarations);
+        };
+        auto resolveFunctionCpp = [&] {
+            ResolveNeeds(entities,
+                         symbols,
+                         e,
+                         FunctionDefinitionNeeds(entities, symbols, autoForwardDeclarations, e),
+                         nullptr,
+                         inc.cpp,
+                         inc.cppForwardDeclarations);
+        };
+        auto resolveMemberDeclarationNeeds = [&] {
+            auto it = memberRelations.containingEntityToMembers.find(id);
+            if (it == memberRelations.containingEntityToMembers.end()) {
+                return;
+            }
+            for (auto mid : it->second) {
+                auto& me = entities.entity(mid);
+                if (auto* dp = std::get_if<EntityDependentProperties::MemFn>(&me.dependentProps)) {
+                    resolveHeader(me, dp->declarationNeeds, &dp->forwardDeclarableNeeds);
+                }
+            }
+        };
+        switch_variant(
+            e.dependentProps,
+            [&](const EntityDependentProperties::Enum& dp) {
+                resolveHeader(e, dp.opaqueEnumDeclarationNeeds);
+                resolveHeader(e, dp.declarationNeeds);
+                inc.cpp.push_back(id);
+            },
+            [&](const EntityDependentProperties::Fn& dp) {
+                resolveHeader(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+                inc.cpp.push_back(id);
+                resolveFunctionCpp();
+            },
+            [&](const EntityDependentProperties::StructOrClass& dp) {
+                resolveHeader(e, dp.forwardDeclarationNeeds);
+                resolveHeader(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+                resolveMemberDeclarationNeeds();
+                inc.cpp.push_back(id);
+            },
+            [&](const EntityDependentProperties::Header& dp) {
+                resolveHeader(e, dp.declarationNeeds, &dp.forwardDeclarableNeeds);
+                inc.cpp.push_back(id);
+            },
+            [&](const EntityDependentProperties::MemFn&) {
+                if (auto it = memberRelations.memberToContainingEntity.find(id);
+                    it != memberRelations.memberToContainingEntity.end()) {
+                    inc.cpp.push_back(it->second);
+                }
+                resolveFunctionCpp();
+            });
+        sort_unique_inplace(inc.header);
+        sort_unique_inplace(inc.cpp);
+        sort_unique_inplace(inc.headerForwardDeclarations);
+        sort_unique_inplace(inc.cppForwardDeclarations);
+    }
+    for (auto& [id, inc] : includes) {
+        for (auto included : inc.header) {
+            includers[included].header.push_back(id);
+        }
+        for (auto included : inc.cpp) {
+            includers[included].cpp.push_back(id);
+        }
+        for (auto forwardDeclared : inc.headerForwardDeclarations) {
+            includers[forwardDeclared].headerForwardDeclarations.push_back(id);
+        }
+        for (auto forwardDeclared : inc.cppForwardDeclarations) {
+            includers[forwardDeclared].cppForwardDeclarations.push_back(id);
+        }
+    }
+}
+
+std::span<const Entities::Id> IncludeGraph::headerIncludes(Entities::Id id) const {
+    auto it = includes.find(id);
+    return it == includes.end() ? std::span<const Entities::Id>() : it->second.header;
+}
+
+std::span<const Entities::Id> IncludeGraph::cppIncludes(Entities::Id id) const {
+    auto it = includes.find(id);
+    return it == includes.end() ? std::span<const Entities::Id>() : it->second.cpp;
+}
+
+std::span<const Entities::Id> IncludeGraph::headerForwardDeclarers(Entities::Id id) const {
+    auto it = includers.find(id);
+    return it == includers.end() ? std::span<const Entities::Id>()
+                                 : it->second.headerForwardDeclarations;
+}
+
+std::span<const Entities::Id> IncludeGraph::cppForwardDeclarers(Entities::Id id) const {
+    auto it = includers.find(id);
+    return it == includers.end() ? std::span<const Entities::Id>()
+                                 : it->second.cppForwardDeclarations;
+}
+
+flat_hash_set<Entities::Id> IncludeGraph::transitiveHeaderIncluders(
+    std::span<const Entities::Id> ids) const {
+    flat_hash_set<Entities::Id> result;
+    std::vector<Entities::Id> stack;
+    auto add = [&](Entities::Id id) {
+        if (result.insert(id).second) {
+            stack.push_back(id);
+        }
+    };
+    for (auto id : ids) {
+        add(id);
+    }
+    while (!stack.empty()) {
+        auto id = stack.back();
+        stack.pop_back();
+        if (auto it = includers.find(id); it != includers.end()) {
+            for (auto includer : it->second.header) {
+                add(includer);
+            }
+        }
+    }
+    return result;
+}
+
+flat_hash_set<Entities::Id> IncludeGraph::cppIncluders(
+    const flat_hash_set<Entities::Id>& headerIds) const {
+    flat_hash_set<Entities::Id> result;
+    for (auto id : headerIds) {
+        if (auto it = includers.find(id); it != includers.end()) {
+            result.insert(BEGIN_END(it->second.cpp));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/base_types.h"
+#include "nmt/enums.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+struct Project;
+
+// The containing struct/class of the member functions.
+struct MemberRelations {
+    flat_hash_map<int64_t, std::vector<Entities::Id>> containingEntityToMembers;
+    flat_hash_map<int64_t, int64_t> memberToContainingEntity;
+};
+
+/// Find the containing struct/class of the member functions of `entityIds` from the name of their
+/// member dir. The errors are appended to `errors`.
+MemberRelations FindMemberRelations(const Project& project,
+                                    std::span<const Entities::Id> entityIds,
+                                    std::vector<std::string>& errors);
+
+// Which generated headers the generated files of the entities include, resolving the needs the same
+// way as `GenerateBoilerplate`. A `Foo*` need doesn't include the header of `Foo`, only the headers
+// of the needs of its forward declaration, neither does a need forward declared automatically: the
+// forward declaration is inlined in the including file, which is recorded separately. The needs
+// which can't be resolved are ignored.
+class IncludeGraph {
+   public:
+    IncludeGraph(const Project& project,
+                 const MemberRelations& memberRelations,
+                 AutoForwardDeclarations autoForwardDeclarations = AutoForwardDeclarations::off);
+
+    /// The entities whose generated headers are included by the generated header of `id` (none for
+    /// member functions, which have no header).
+    std::span<const Entities::Id> headerIncludes(Entities::Id id) const;
+    /// The entities whose generated headers are included by the generated cpp of `id`, including
+    /// its own (or its containing entity's) header.
+    std::span<const Entities::Id> cppIncludes(Entities::Id id) const;
+
+    /// The entities whose generated header (for a struct/class, including its member declarations)
+    /// inlines the forward declaration of `id`, directly or through the forward declaration needs
+    /// of another forward declared entity.
+    std::span<const Entities::Id> headerForwardDeclarers(Entities::Id id) const;
+    /// The entities whose generated cpp inlines the forward declaration of `id`.
+    std::span<const Entities::Id> cppForwardDeclarers(Entities::Id id) const;
+
+    /// `ids` and the entities whose generated header includes the header of any of them, directly
+    /// or transitively.
+    flat_hash_set<Entities::Id> transitiveHeaderIncluders(std::span<const Entities::Id> ids) const;
+    /// The entities whose generated cpp includes the header of any of `headerIds`.
+    flat_hash_set<Entities::Id> cppIncluders(const flat_hash_set<Entities::Id>& headerIds) const;
+
+   private:
+    struct Includes {
+        std::vector<Entities::Id> header, cpp;  // Sorted, unique.
+        std::vector<Entities::Id> headerForwardDeclarations, cppForwardDeclarations;  // Same.
+    };
+    flat_hash_map<Entities::Id, Includes> includes;
+    // The reverse edges: which entities' header and cpp include the header of the key, or inline
+    // its forward declaration.
+    flat_hash_map<Entities::Id, Includes> includers;
+};
@@ -0,0 +1,252 @@
+#include "nmt/InferNeeds.h"
+
+#include "BatchedFileIO.h"
+#include "ParsePreprocessedSource.h"
+#include "PreprocessSource.h"
+#include "nmtutil.h"
+
+#include "nmt/Project.h"
+#include "nmt/SymbolTable.h"
+
+#include "util/TaskScheduler.h"
+
+namespace fs = std::filesystem;
+namespace DP = EntityDependentProperties;
+
+namespace {
+// The sources of a batch are read and tokenized together, their contents are dropped before the
+// next batch is read.
+constexpr size_t k_sourcesPerBatch = 4096;
+// Tokenizing is the expensive part, a few sources per task are enough to amortize the scheduling.
+constexpr size_t k_sourcesPerTask = 8;
+
+bool IsKeptAsWritten(std::string_view need) {
+    return need.empty() || need[0] == '<' || need[0] == '"' || need.starts_with("struct ")
+        || need.starts_with("class ") || need.starts_with("enum ");
+}
+
+// The entity `name` references and the prefix of `name` which resolves to it.
+std::optional<std::pair<Entities::Id, std::string_view>> ResolveReference(
+    const SymbolTable& symbols, const Entity& from, std::string_view name) {
+    for (auto n = name;;) {
+        if (auto maybeId = symbols.resolve(from, n)) {
+            return std::pair(*maybeId, n);
+        }
+        auto i = n.rfind("::");
+        if (i == std::string_view::npos || i == 0) {
+            return std::nullopt;
+        }
+        n = n.substr(0, i);
+    }
+}
+
+// The referenced entities with their shortest spelling.
+using References = flat_hash_map<Entities::Id, std::string>;
+
+void AddReference(References& references, Entities::Id id, std::string_view spelling) {
+    auto [it, inserted] = references.try_emplace(id, spelling);
+    if (!inserted
+        && std::pair(spelling.size(), spelling)
+               < std::pair(it->second.size(), std::string_view(it->second))) {
+        it->second = spelling;
+    }
+}
+
+// Compare the annotated `needs` (sorted) with the `referenced` entities, an annotated need keeps
+// its spelling.
+void InferList(const SymbolTable& symbols,
+               const Entity& e,
+               const std::vector<std::string>& needs,
+               const References& referenced,
+               const flat_hash_set<Entities::Id>& refOnly,
+               InferredNeeds::List& list) {
+    flat_hash_map<Entities::Id, std::string_view> annotated;
+    for (auto& need : needs) {
+        if (IsKeptAsWritten(need)) {
+            list.needs.push_back(need);
+            continue;
+        }
+        std::string_view needName = need;
+        if (needName.back() == '*') {
+            needName.remove_suffix(1);
+        }
+        auto maybeId = symbols.resolve(e, needName);
+        if (!maybeId) {
+            list.needs.push_back(need);  // Reported by generating the boilerplate.
+            continue;
+        }
+        annotated.emplace(*maybeId, needName);
+        if (!referenced.contains(*maybeId)) {
+            list.unused.push_back(need);
+        }
+    }
+    for (auto& [id, spelling] : referenced) {
+        auto it = annotated.find(id);
+        std::string need(it == annotated.end() ? std::string_view(spelling) : it->second);
+        if (it == annotated.end()) {
+            list.missing.push_back(need);
+        }
+        if (refOnly.contains(id)) {
+            need += '*';
+        }
+        list.needs.push_back(std::move(need));
+    }
+    sort_unique_inplace(list.needs);
+    std::ranges::sort(list.missing);
+    list.changed = list.needs != needs;
+}
+
+std::optional<InferredNeeds> InferEntityNeeds(const Entities& entities,
+                                              const SymbolTable& symbols,
+                                              Entities::Id id,
+                                              const Entity& e,
+                                              const ReferencedNames& names) {
+    // The entity itself and the struct/class of a member function are not needs.
+    flat_hash_set<Entities::Id> excluded{id};
+    if (e.GetEntityKind() == EntityKind::memfn) {
+        if (auto className =
+                extractContainingStructOrClassNameFromMemberDir(e.sourcePath.parent_path())) {
+            if (auto classId = symbols.resolve(e, *className)) {
+                excluded.insert(*classId);
+            }
+        }
+    }
+    References declaration, definition;
+    // An entity is forward declarable if all its references in the declaration are.
+    flat_hash_map<Entities::Id, bool> forwardDeclarable;
+    for (auto& name : names.declaration) {
+        auto r = ResolveReference(symbols, e, name);
+        if (!r || excluded.contains(r->first)) {
+            continue;
+        }
+        AddReference(declaration, r->first, r->second);
+        auto& needed = entities.entitySummary(r->first);
+        const bool x = r->second.size() == name.size()
+                    && ForwardDeclaresNeed(&names.declarationForwardDeclarable, name, needed);
+        auto [it, _] = forwardDeclarable.try_emplace(r->first, true);
+        it->second = it->second && x;
+    }
+    flat_hash_set<Entities::Id> refOnly;
+    for (auto& [neededId, x] : forwardDeclarable) {
+        if (x) {
+            refOnly.insert(neededId);
+        }
+    }
+    for (auto& name : names.definition) {
+        auto r = ResolveReference(symbols, e, name);
+        if (!r || excluded.contains(r->first)
+            || (declaration.contains(r->first) && !refOnly.contains(r->first))) {
+            continue;
+        }
+        AddReference(definition, r->first, r->second);
+    }
+
+    InferredNeeds result;
+    result.id = id;
+    auto& declarationNeeds = std::visit(
+        [](const auto& dp) -> const std::vector<std::string>& {
+            return dp.declarationNeeds;
+        },
+        e.dependentProps);
+    InferList(symbols, e, declarationNeeds, declaration, refOnly, result.declaration);
+    auto* definitionNeeds = switch_variant(
+        e.dependentProps,
+        [](const DP::Fn& dp) -> const std::vector<std::string>* {
+            return &dp.definitionNeeds;
+        },
+        [](const DP::MemFn& dp) -> const std::vector<std::string>* {
+            return &dp.definitionNeeds;
+        },
+        [](const auto&) -> const std::vector<std::string>* {
+            return nullptr;
+        });
+    if (definitionNeeds) {
+        result.definition.emplace();
+        InferList(symbols, e, *definitionNeeds, definition, {}, *result.definition);
+    }
+    if (!result.declaration.changed && !(result.definition && result.definition->changed)) {
+        return std::nullopt;
+    }
+    return result;
+}
+}  // namespace
+
+std::vector<InferredNeeds> InferNeeds(const Project& project) {
+    auto& entities = project.entities();
+    auto entityIds = entities.itemsWithEntities();
+    const SymbolTable symbols(project);
+    std::vector<InferredNeeds> result;
+    for (size_t begin = 0; begin < entityIds.size(); begin += k_sourcesPerBatch) {
+        auto ids = std::span(entityIds).subspan(
+            begin, std::min(k_sourcesPerBatch, entityIds.size() - begin));
+        std::vector<fs::path> sourcePaths;
+        std::vector<EntityKind> kinds;
+        sourcePaths.reserve(ids.size());
+        kinds.reserve(ids.size());
+        for (auto id : ids) {
+            sourcePaths.push_back(entities.sourcePath(id));
+            kinds.push_back(entities.entitySummary(id).GetEntityKind());
+        }
+        auto sourceContents = ReadFiles(sourcePaths);
+        auto referencedNames = ParallelMap(
+            ids.size(), k_sourcesPerTask, [&](size_t i) -> std::optional<ReferencedNames> {
+                if (!sourceContents[i]) {
+                    return std::nullopt;
+                }
+                auto pps = PreprocessSource(*sourceContents[i]);
+                if (!pps || pps->specialComments.empty()) {
+                    return std::nullopt;
+                }
+                auto names = FindReferencedNames(*pps, sourcePaths[i], kinds[i]);
+                if (!names) {
+                    return std::nullopt;
+                }
+                return std::move(*names);
+            });
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (!referencedNames[i]) {
+                continue;
+            }
+            // No reference to the entities is held between the iterations.
+            entities.trimSpillCache();
+            if (auto x = InferEntityNeeds(
+                    entities, symbols, ids[i], entities.entity(ids[i]), *referencedNames[i])) {
+                result.push_back(std::move(*x));
+            }
+        }
+    }
+    return result;
+}
+
+void ApplyInferredNeeds(Project& project, const std::vector<InferredNeeds>& inferred) {
+    for (auto& x : inferred) {
+        project.entities().trimSpillCache();
+        auto e = project.entities().entity(x.id);
+        auto setDefinitionNeeds = [&x](std::vector<std::string>& definitionNeeds) {
+            if (x.definition) {
+                definitionNeeds = x.definition->needs;
+            }
+        };
+        // The inferred needs are already `Foo*` where a forward declaration will do.
+        switch_variant(
+            e.dependentProps,
+            [&x](DP::Enum& dp) {
+                dp.declarationNeeds = x.declaration.needs;
+            },
+            [&](DP::Fn& dp) {
+                dp.declarationNeeds = x.declaration.needs;
+                setDefinitionNeeds(dp.definitionNeeds);
+                dp.forwardDeclarableNeeds.clear();
+            },
+            [&](DP::MemFn& dp) {
+                dp.declarationNeeds = x.declaration.needs;
+                setDefinitionNeeds(dp.definitionNeeds);
+                dp.forwardDeclarableNeeds.clear();
+            },
+            [&x](auto& dp) {
+                dp.declarationNeeds = x.declaration.needs;
+                dp.forwardDeclarableNeeds.clear();
+            });
+        project.entities_updateSourceWithEntity(x.id, std::move(e));
+    }
+}
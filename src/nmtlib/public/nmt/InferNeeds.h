@@ -0,0 +1,35 @@
+#pragma once
+
+#include "nmt/Entities.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+struct Project;
+
+// The needs of an entity inferred from the identifiers in its source which reference the entities
+// of the project (see `SymbolTable`): a qualified name references the entity of its longest
+// resolving prefix (`Color::red` references `Color`). A declaration need is `Foo*` if every use of
+// it is one where an incomplete type will do (see `ForwardDeclaresNeed()`). The definition needs
+// are the entities referenced only in the body of a function (or needed complete only there). The
+// needs the identifiers can't tell are kept as written: the headers (`<vector>`, `"foo.h"`), the
+// raw forward declarations (`struct Foo`), the names which don't resolve and the `#fdneeds`.
+struct InferredNeeds {
+    struct List {
+        std::vector<std::string> needs;    // The inferred `#needs`/`#defneeds`, sorted.
+        std::vector<std::string> missing;  // Referenced but not annotated, sorted.
+        std::vector<std::string> unused;   // Annotated but not referenced, sorted.
+        bool changed = false;  // `needs` differs from the annotated needs.
+    };
+    Entities::Id id;
+    List declaration;
+    std::optional<List> definition;  // Only the functions have definition needs.
+};
+
+/// The entities whose inferred needs differ from the annotated ones, in the order of the entities.
+/// The sources are read and tokenized again, the ones which can't be are left out.
+std::vector<InferredNeeds> InferNeeds(const Project& project);
+/// Replace the annotated needs of the entities with the inferred ones, in memory: the sources are
+/// not rewritten.
+void ApplyInferredNeeds(Project& project, const std::vector<InferredNeeds>& inferred);
@@ -1,17 +1,28 @@
 #include "nmt/ProcessSource.h"
+#include "nmt/Diagnostics.h"
 #include "nmt/Project.h"
 
+#include "BatchedFileIO.h"
 #include "ParsePreprocessedSource.h"
 #include "PreprocessSource.h"
 #include "ReadFile.h"
 
+#include "util/TaskScheduler.h"
+
 namespace fs = std::filesystem;
 
 ProcessSourceResult::V ProcessSource(int64_t targetId,
                                      const fs::path& targetRootSourceDir,
                                      const std::filesystem::path& sourcePath) {
+    return ProcessSourceContent(targetId, targetRootSourceDir, sourcePath, ReadFile(sourcePath));
+}
+
+ProcessSourceResult::V ProcessSourceContent(int64_t targetId,
+                                            const fs::path& targetRootSourceDir,
+                                            const std::filesystem::path& sourcePath,
+                                            std::optional<std::string> sourceContentOrNullopt) {
     TRY_ASSIGN_OR_RETURN_VALUE(
-        sourceContent, ReadFile(sourcePath), ProcessSourceResult::CantReadFile{});
+        sourceContent, std::move(sourceContentOrNullopt), ProcessSourceResult::CantReadFile{});
     TRY_ASSIGN_OR_RETURN_VALUE(
         pps,
         PreprocessSource(sourceContent),
@@ -46,41 +57,94 @@ ProcessSourceResult::V ProcessSource(int64_t targetId,
     }
 }
 
-std::pair<std::vector<std::string>, std::vector<std::string>> ProcessSourceAndUpdateProject(
-    Project& project, Entities::Id id, bool verbose) {
-    std::vector<std::string> errors, verboseMessages;
-    auto& sourcePath = project.entities().sourcePath(id);
-    std::error_code ec;
-    auto lastWriteTime = std::filesystem::last_write_time(sourcePath, ec);
-    if (ec) {
-        lastWriteTime = std::filesystem::file_time_type::min();
+void UpdateProjectWithProcessSourceResult(Project& project,
+                                          Entities::Id id,
+                                          ProcessSourceResult::V result,
+                                          std::filesystem::file_time_type lastWriteTime,
+                                          Diagnostics& diagnostics) {
+    // A dir config file which can't be parsed any more doesn't configure its dir.
+    if (!std::holds_alternative<DirConfigFile>(result)) {
+        auto& sourcePath = project.entities().sourcePath(id);
+        if (path_to_string(sourcePath.stem()) == k_dirConfigFileName) {
+            project.dirConfigs_erase(sourcePath.parent_path());
+        }
     }
-    auto targetId = project.entities().targetId(id);
     switch_variant(
-        ProcessSource(targetId, project.targets().at(targetId).sourceDir, sourcePath),
+        std::move(result),
         [&](Entity&& x) {
+            x.lastWriteTime = lastWriteTime;
             project.entities_updateSourceWithEntity(id, std::move(x));
         },
         [&](DirConfigFile&& x) {
-            project.dirConfigFiles()[sourcePath] = std::move(x);
+            project.dirConfigs_set(std::move(x));
         },
         [&](ProcessSourceResult::SourceWithoutSpecialComments) {
             project.entities_updateSourceNoSpecialComments(id, lastWriteTime);
-            if (verbose) {
-                verboseMessages.push_back(
-                    fmt::format("Ignoring file without NMT annotations: {}", sourcePath));
-            }
+            diagnostics.report<Diagnostic::IgnoredSourceWithoutAnnotations>(id);
         },
         [&](ProcessSourceResult::CantReadFile) {
             project.entities_updateSourceCantReadFile(id);
-            errors.push_back(fmt::format("Can't read file: {}", sourcePath));
+            diagnostics.report<Diagnostic::CantReadSource>(id);
         },
         [&](ProcessSourceResult::Error&& x) {
             for (auto& m : x.messages) {
-                errors.push_back(
-                    fmt::format("Failed to process file {}, reason: {}", sourcePath, m));
+                diagnostics.report<Diagnostic::ProcessingFailed>(id, m);
             }
             project.entities_updateSourceError(id, std::move(x.messages), lastWriteTime);
         });
-    return make_pair(std::move(errors), std::move(verboseMessages));
+}
+
+std::filesystem::file_time_type LastWriteTimeOrMin(const std::filesystem::path& sourcePath) {
+    std::error_code ec;
+    auto lastWriteTime = std::filesystem::last_write_time(sourcePath, ec);
+    return ec ? std::filesystem::file_time_type::min() : lastWriteTime;
+}
+
+void ProcessSourceAndUpdateProject(Project& project, Entities::Id id, Diagnostics& diagnostics) {
+    auto& sourcePath = project.entities().sourcePath(id);
+    // Stat before reading: an edit in between is seen as dirty by the next run.
+    auto lastWriteTime = LastWriteTimeOrMin(sourcePath);
+    auto targetId = project.entities().targetId(id);
+    auto result = ProcessSourceContent(targetId,
+                                       project.targets().at(targetId).sourceDir,
+                                       sourcePath,
+                                       ReadFile(sourcePath));
+    UpdateProjectWithProcessSourceResult(
+        project, id, std::move(result), lastWriteTime, diagnostics);
+}
+
+std::vector<ProcessedSource> ProcessSources(const Project& project,
+                                            std::span<const Entities::Id> ids) {
+    std::vector<fs::path> sourcePaths;
+    std::vector<const fs::path*> statPaths;
+    sourcePaths.reserve(ids.size());
+    statPaths.reserve(ids.size());
+    for (auto id : ids) {
+        statPaths.push_back(&project.entities().sourcePath(id));
+        sourcePaths.push_back(*statPaths.back());
+    }
+    // Stat before reading: an edit in between is seen as dirty by the next run.
+    auto lastWriteTimes = LastWriteTimes(statPaths);
+    auto sourceContents = ReadFiles(sourcePaths);
+    // Parsing is the expensive part, a few sources per task are enough to amortize the scheduling.
+    constexpr size_t k_sourcesPerTask = 8;
+    return ParallelMap(ids.size(), k_sourcesPerTask, [&](size_t i) {
+        auto lastWriteTime = lastWriteTimes[i].value_or(fs::file_time_type::min());
+        auto targetId = project.entities().targetId(ids[i]);
+        auto& targetRootSourceDir = project.targets().at(targetId).sourceDir;
+        return ProcessedSource{
+            .id = ids[i],
+            .result = ProcessSourceContent(
+                targetId, targetRootSourceDir, sourcePaths[i], std::move(sourceContents[i])),
+            .lastWriteTime = lastWriteTime};
+    });
+}
+
+void ProcessSourcesAndUpdateProject(Project& project,
+                                    std::span<const Entities::Id> ids,
+                                    Diagnostics& diagnostics) {
+    for (auto& ps : ProcessSources(project, ids)) {
+        UpdateProjectWithProcessSourceResult(
+            project, ps.id, std::move(ps.result), ps.lastWriteTime, diagnostics);
+    }
 }
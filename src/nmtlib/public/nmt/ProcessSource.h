@@ -1,12 +1,17 @@
+#pragma once
+
 #include "nmt/DirConfigFile.h"
 #include "nmt/Entities.h"
 #include "nmt/Entity.h"
 
 #include <filesystem>
+#include <optional>
+#include <span>
 #include <string>
 #include <variant>
 #include <vector>
 
+class Diagnostics;
 struct Project;
 
 namespace ProcessSourceResult {
@@ -20,5 +25,33 @@ using V = std::variant<Entity, DirConfigFile, SourceWithoutSpecialComments, Cant
 ProcessSourceResult::V ProcessSource(int64_t targetId,
                                      const std::filesystem::path& targetRootSourceDir,
                                      const std::filesystem::path& sourcePath);
-std::pair<std::vector<std::string>, std::vector<std::string>> ProcessSourceAndUpdateProject(
-    Project& project, Entities::Id id, bool verbose);
+/// Same as `ProcessSource` but with already read content, nullopt means the file couldn't be read.
+ProcessSourceResult::V ProcessSourceContent(int64_t targetId,
+                                            const std::filesystem::path& targetRootSourceDir,
+                                            const std::filesystem::path& sourcePath,
+                                            std::optional<std::string> sourceContent);
+/// Update the project with the result of processing the source `id`, report the diagnostics to
+/// `diagnostics`.
+void UpdateProjectWithProcessSourceResult(Project& project,
+                                          Entities::Id id,
+                                          ProcessSourceResult::V result,
+                                          std::filesystem::file_time_type lastWriteTime,
+                                          Diagnostics& diagnostics);
+/// `file_time_type::min()` if the last write time can't be queried.
+std::filesystem::file_time_type LastWriteTimeOrMin(const std::filesystem::path& sourcePath);
+void ProcessSourceAndUpdateProject(Project& project, Entities::Id id, Diagnostics& diagnostics);
+struct ProcessedSource {
+    Entities::Id id;
+    ProcessSourceResult::V result;
+    std::filesystem::file_time_type lastWriteTime;
+};
+/// Read (in a single batch) and process the sources on the shared `TaskScheduler` without updating
+/// the project. The results are in the order of `ids` and can be applied later with
+/// `UpdateProjectWithProcessSourceResult`, possibly on another thread.
+std::vector<ProcessedSource> ProcessSources(const Project& project,
+                                            std::span<const Entities::Id> ids);
+/// Same as calling `ProcessSourceAndUpdateProject` for each id but the sources are read in a
+/// single batch.
+void ProcessSourcesAndUpdateProject(Project& project,
+                                    std::span<const Entities::Id> ids,
+                                    Diagnostics& diagnostics);
@@ -22,16 +22,115 @@ std::expected<ProgramOptions, int> ParseProgramOptions(int argc, char* argv[]) {
            "-o,--output-dir",
            args.outputDir,
            fmt::format("Output directory, will be created or content erased/updated, as needed. "
-                       "List of generated files will be written to `<output-dir>/{}`",
+                       "List of generated files will be written to `<output-dir>/{}`, which is "
+                       "rewritten only if the list changes",
                        k_fileListFilename))
         ->required();
+    std::vector<std::string> dependencies;
+    app.add_option("-d,--dependency",
+                   dependencies,
+                   "`<name> <source-dir> <output-dir>` of an additional target, can be repeated. "
+                   "The entities can need the public entities of the other targets")
+        ->expected(3);
     app.add_flag("-v,--verbose", args.verbose, "Print more diagnostics");
+    app.add_option("-j,--jobs",
+                   args.jobs,
+                   "Number of threads used by all phases together, 0 means one per hardware thread")
+        ->capture_default_str();
+    std::string statsFormat;
+    const std::vector<std::string> statsFormats(BEGIN_END(enum_traits<StatsFormat>::names));
+    app.add_option("--stats",
+                   statsFormat,
+                   fmt::format("Print entity counts, memory usage and allocations per phase ({})",
+                               fmt::join(statsFormats, ", ")))
+        ->check(CLI::IsMember(statsFormats));
+    std::string outputMode;
+    const std::vector<std::string> outputModes(BEGIN_END(enum_traits<OutputMode>::names));
+    app.add_option("--output-mode",
+                   outputMode,
+                   fmt::format("`headers` (default): a header and a cpp per entity. `modules`: a "
+                               "C++20 module interface unit per target (`<output-dir>/public/"
+                               "<target>/{}`), a cpp per function definition",
+                               k_moduleInterfaceFilename))
+        ->check(CLI::IsMember(outputModes));
+    std::string autoForwardDeclarations;
+    const std::vector<std::string> autoForwardDeclarationsValues(
+        BEGIN_END(enum_traits<AutoForwardDeclarations>::names));
+    app.add_option("--auto-forward-declarations",
+                   autoForwardDeclarations,
+                   "Declaration needs used only by pointer or reference (or in function "
+                   "signatures): `off` (default), `suggest` forward declaring them, `apply`: "
+                   "forward declare them instead of including their headers")
+        ->check(CLI::IsMember(autoForwardDeclarationsValues));
+    std::string needsInference;
+    const std::vector<std::string> needsInferenceValues(
+        BEGIN_END(enum_traits<NeedsInference>::names));
+    app.add_option("--infer-needs",
+                   needsInference,
+                   "Infer the needs from the identifiers referencing the entities: `off` "
+                   "(default), `suggest` the differences to the annotated needs, `apply`: use the "
+                   "inferred needs instead of the annotated ones")
+        ->check(CLI::IsMember(needsInferenceValues));
+    app.add_option("--max-entity-memory",
+                   args.maxEntityMemoryMiB,
+                   "Streaming mode for very large trees: spill the parsed entities to a temporary "
+                   "file and keep about this many MiB of them in memory")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--check-compiler",
+                   args.checkCompiler,
+                   "Compiler for checking the generated cpp files of the entities (GUI app)")
+        ->capture_default_str();
+    std::string checkFlags;
+    app.add_option("--check-flags",
+                   checkFlags,
+                   "Space-separated compiler flags for checking the generated cpp files of "
+                   "the entities, e.g. `-std=c++23 -Iinclude` (GUI app)");
+
+    auto* impact = app.add_subcommand(
+        "impact",
+        "Print the generated files which are regenerated or recompiled if the given sources "
+        "change, and their targets. Nothing is generated");
+    impact->fallthrough();
+    impact->add_option("sources", args.impactSources, "Changed source files")->required();
 
     try {
         app.parse(argc, argv);
     } catch (const CLI::ParseError& e) {
         return std::unexpected(app.exit(e));
     }
+    if (impact->parsed()) {
+        args.command = Command::impact;
+    }
+    if (!statsFormat.empty()) {
+        args.stats = enum_from_name<StatsFormat>(statsFormat);
+        CHECK(args.stats);  // Validated by the parser.
+    }
+    if (!outputMode.empty()) {
+        auto mode = enum_from_name<OutputMode>(outputMode);
+        CHECK(mode);  // Validated by the parser.
+        args.outputMode = *mode;
+    }
+    if (!autoForwardDeclarations.empty()) {
+        auto mode = enum_from_name<AutoForwardDeclarations>(autoForwardDeclarations);
+        CHECK(mode);  // Validated by the parser.
+        args.autoForwardDeclarations = *mode;
+    }
+    if (!needsInference.empty()) {
+        auto mode = enum_from_name<NeedsInference>(needsInference);
+        CHECK(mode);  // Validated by the parser.
+        args.needsInference = *mode;
+    }
+    CHECK(dependencies.size() % 3 == 0);  // Validated by the parser.
+    for (size_t i = 0; i < dependencies.size(); i += 3) {
+        args.dependencies.push_back(TargetOptions{.name = std::move(dependencies[i]),
+                                                  .sourceDir = dependencies[i + 1],
+                                                  .outputDir = dependencies[i + 2]});
+    }
+    for (auto flag : checkFlags | std::views::split(' ')) {
+        if (!std::ranges::empty(flag)) {
+            args.checkFlags.emplace_back(std::ranges::begin(flag), std::ranges::end(flag));
+        }
+    }
 
     return args;
 }
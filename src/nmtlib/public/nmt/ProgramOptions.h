@@ -1,14 +1,53 @@
 #pragma once
 
+#include "nmt/enums.h"
+#include "util/enum_traits.h"
+
 #include <expected>
 #include <filesystem>
+#include <optional>
+#include <string>
 #include <vector>
 
+enum class StatsFormat { text, json };
+template<>
+struct enum_traits<StatsFormat> {
+    using enum StatsFormat;
+    static constexpr std::array<StatsFormat, 2> elements{text, json};
+    static constexpr std::array<std::string_view, elements.size()> names{"text", "json"};
+};
+
+enum class Command {
+    generate,  // Default: generate the boilerplate.
+    impact,    // `nmt impact <sources>`: print the generated files affected by the sources.
+};
+
+// A target given by `--dependency`.
+struct TargetOptions {
+    std::string name;
+    std::filesystem::path sourceDir;
+    std::filesystem::path outputDir;
+};
+
 struct ProgramOptions {
+    Command command = Command::generate;
+    std::vector<std::filesystem::path> impactSources;
     bool verbose = false;
+    unsigned jobs = 0;  // Threads of the shared `TaskScheduler`, 0: one per hardware thread.
+    std::optional<StatsFormat> stats;
+    OutputMode outputMode = OutputMode::headers;
+    AutoForwardDeclarations autoForwardDeclarations = AutoForwardDeclarations::off;
+    NeedsInference needsInference = NeedsInference::off;
+    // Streaming mode: spill the entities to disk and keep about this much of them in memory.
+    std::optional<int64_t> maxEntityMemoryMiB;
     std::filesystem::path sourceDir;
     std::filesystem::path outputDir;
     std::string target;
+    // Additional targets, their public entities can be needed across the targets.
+    std::vector<TargetOptions> dependencies;
+    // Compile check of the entities' generated cpp files (GUI app).
+    std::string checkCompiler = "c++";
+    std::vector<std::string> checkFlags;
 };
 
 std::expected<ProgramOptions, int> ParseProgramOptions(int argc, char* argv[]);
@@ -1,64 +1,69 @@
 #include "nmt/Project.h"
 
+#include "HeapBytes.h"
 #include "nmtutil.h"
 
+#include "nmt/Diagnostics.h"
 #include "nmt/ProcessSource.h"
 
 namespace fs = std::filesystem;
 
-Project::AddSourcesFromMemberDirResult Project::addSourcesFromMemberDir(
-    int64_t targetId, const fs::path& memberDir, int64_t structClassTreeItemId) {
+Project::Project(const Project& y)
+    : _nextId(y._nextId)
+    , _targets(y._targets)
+    , _targetsDisplayOrder(y._targetsDisplayOrder)
+    , _targetTreeItemsDisplayOrder(y._targetTreeItemsDisplayOrder)
+    , _treeItems(y._treeItems)
+    , _entities(y._entities)
+    , _dirConfigs(y._dirConfigs) {}
+
+std::vector<int64_t> Project::addSourcesFromMemberDir(int64_t targetId,
+                                                     const fs::path& memberDir,
+                                                     int64_t structClassTreeItemId,
+                                                     Diagnostics& diagnostics,
+                                                     const SourceAddedFn& onSourceAdded) {
     auto& target = _targets.at(targetId);
 
     std::vector<int64_t> children;
-    std::vector<std::string> errors, verboseMessages;
     std::error_code ec;
     auto dit = fs::directory_iterator(memberDir, ec);
     if (ec) {
-        return AddSourcesFromMemberDirResult{
-            .errors = make_vector(
-                fmt::format("Can't read directory `{}`, reason: {}", memberDir, ec.message())),
-        };
+        diagnostics.report<Diagnostic::CantReadDirectory>(memberDir, ec);
+        return children;
     }
+    _dirConfigs.mut().addDir(memberDir);
     for (; dit != fs::directory_iterator(); ++dit) {
         auto status = dit->status(ec);
         if (ec) {
-            errors.push_back(fmt::format(
-                "Can't get status of file `{}`, reason: {}", dit->path(), ec.message()));
+            diagnostics.report<Diagnostic::CantGetFileStatus>(dit->path(), ec);
             continue;
         }
         switch (status.type()) {
             using enum fs::file_type;
-            case not_found:
-                errors.push_back(fmt::format("File `{}` has a type of `not_found` and "
-                                             "that's strange, what "
-                                             "should we do with that? For now it's an error",
-                                             dit->path()));
-                break;
             case regular: {
-                auto ext = dit->path().extension();
-                if (k_validSourceExtensions.contains(ext)) {
+                if (k_validSourceExtensions.contains(dit->path().extension())) {
                     if (auto sourceIdOr =
                             _entities.addSource(targetId, target.sourceDir, dit->path())) {
                         auto childId = _nextId++;
-                        _treeItems.insert(std::make_pair(
+                        _treeItems.insert(
                             childId,
                             ProjectTreeItem::LeafSource{.parentTreeItem = structClassTreeItemId,
-                                                        .sourceId = *sourceIdOr}));
+                                                        .sourceId = *sourceIdOr});
                         children.push_back(childId);
+                        if (onSourceAdded) {
+                            onSourceAdded(*sourceIdOr);
+                        }
                     } else {
-                        errors.push_back(std::move(sourceIdOr.error()));
+                        diagnostics.report<Diagnostic::Error>(std::move(sourceIdOr.error()));
                     }
                 } else {
-                    verboseMessages.push_back(
-                        fmt::format("Ignoring file with extension `{}`: {}", ext, dit->path()));
+                    diagnostics.report<Diagnostic::IgnoredFileExtension>(dit->path());
                 }
             } break;
             case directory:
-                verboseMessages.push_back(fmt::format("Directory `{}` ignored: it's inside a "
-                                                      "directory for struct/class members.",
-                                                      dit->path()));
+                diagnostics.report<Diagnostic::IgnoredDirectoryInMemberDir>(dit->path());
                 break;
+            case not_found:
             case none:
             case symlink:
             case block:
@@ -66,102 +71,85 @@ Project::AddSourcesFromMemberDirResult Project::addSourcesFromMemberDir(
             case fifo:
             case socket:
             case unknown:
-                errors.push_back(fmt::format("File `{}` has a type of {} and it's not yet "
-                                             "decided what to do with this type",
-                                             dit->path(),
-                                             to_string_view(status.type())));
+                diagnostics.report<Diagnostic::UnsupportedFileType>(dit->path(), status.type());
                 break;
         }
     }
-    return AddSourcesFromMemberDirResult{.children = std::move(children),
-                                         .errors = std::move(errors),
-                                         .verboseMessages = std::move(verboseMessages)};
+    return children;
 }
 
-Project::AddSourcesAndTreeItemsRecursivelyResult Project::addSourcesAndTreeItemsRecursively(
-    int64_t targetId, int64_t subdirTreeItemId) {
+void Project::addSourcesAndTreeItemsRecursively(int64_t targetId,
+                                                int64_t subdirTreeItemId,
+                                                Diagnostics& diagnostics,
+                                                const SourceAddedFn& onSourceAdded) {
     auto& target = _targets.at(targetId);
-    auto& treeItem = _treeItems.at(subdirTreeItemId);
+    auto& treeItem = _treeItems.atMut(subdirTreeItemId);
     CHECK(treeItem | vx::is<ProjectTreeItem::Subdir>);
     auto& subdir = std::get<ProjectTreeItem::Subdir>(treeItem);
     std::error_code ec;
     auto dit = fs::directory_iterator(subdir.sourceDir, ec);
     if (ec) {
-        return AddSourcesAndTreeItemsRecursivelyResult{
-            .errors = make_vector(fmt::format(
-                "Can't read directory `{}`, reason: {}", subdir.sourceDir, ec.message()))};
+        diagnostics.report<Diagnostic::CantReadDirectory>(subdir.sourceDir, ec);
+        return;
     }
-    AddSourcesAndTreeItemsRecursivelyResult result;
+    _dirConfigs.mut().addDir(subdir.sourceDir);
     for (; dit != fs::directory_iterator(); ++dit) {
         auto status = dit->status(ec);
         if (ec) {
-            result.errors.push_back(fmt::format(
-                "Can't get status of file `{}`, reason: {}", dit->path(), ec.message()));
+            diagnostics.report<Diagnostic::CantGetFileStatus>(dit->path(), ec);
             continue;
         }
         switch (status.type()) {
             using enum fs::file_type;
-            case not_found:
-                result.errors.push_back(
-                    fmt::format("File `{}` has a type of `not_found` and that's strange, what "
-                                "should we do with that? For now it's an error",
-                                dit->path()));
-                break;
             case regular: {
-                auto ext = dit->path().extension();
-                if (k_validSourceExtensions.contains(ext)) {
+                if (k_validSourceExtensions.contains(dit->path().extension())) {
                     if (auto sourceIdOr =
                             _entities.addSource(targetId, target.sourceDir, dit->path())) {
+                        if (onSourceAdded) {
+                            onSourceAdded(*sourceIdOr);
+                        }
                         auto childId = _nextId++;
                         auto memberDir = structOrClassSourcePathToMemberDir(dit->path());
                         bool memberDirIsDirectory =
                             fs::exists(memberDir, ec) && fs::is_directory(memberDir, ec);
                         if (ec) {
-                            result.errors.push_back(
-                                fmt::format("Can't check if path `{}` is a directory, reason: {}",
-                                            memberDir,
-                                            ec.message()));
+                            diagnostics.report<Diagnostic::CantCheckDirectory>(memberDir, ec);
                         }
                         if (memberDirIsDirectory) {
-                            auto asfmdResult =
-                                addSourcesFromMemberDir(targetId, memberDir, childId);
-                            append_range(result.errors, std::move(asfmdResult.errors));
-                            append_range(result.verboseMessages,
-                                         std::move(asfmdResult.verboseMessages));
+                            auto children = addSourcesFromMemberDir(
+                                targetId, memberDir, childId, diagnostics, onSourceAdded);
                             _treeItems.insert(
-                                std::make_pair(childId,
-                                               ProjectTreeItem::StructOrClass{
-                                                   .sourceId = *sourceIdOr,
-                                                   .parentTreeItem = subdirTreeItemId,
-                                                   .sourceDir = memberDir,
-                                                   .children = std::move(asfmdResult.children)}));
+                                childId,
+                                ProjectTreeItem::StructOrClass{.sourceId = *sourceIdOr,
+                                                               .parentTreeItem = subdirTreeItemId,
+                                                               .sourceDir = memberDir,
+                                                               .children = std::move(children)});
                         } else {
-                            _treeItems.insert(std::make_pair(
+                            _treeItems.insert(
                                 childId,
                                 ProjectTreeItem::LeafSource{.parentTreeItem = subdirTreeItemId,
-                                                            .sourceId = *sourceIdOr}));
+                                                            .sourceId = *sourceIdOr});
                         }
                         subdir.children.push_back(childId);
                     } else {
-                        result.errors.push_back(std::move(sourceIdOr.error()));
+                        diagnostics.report<Diagnostic::Error>(std::move(sourceIdOr.error()));
                     }
                 } else {
-                    result.verboseMessages.push_back(
-                        fmt::format("Ignoring file with extension `{}`: {}", ext, dit->path()));
+                    diagnostics.report<Diagnostic::IgnoredFileExtension>(dit->path());
                 }
             } break;
             case directory:
                 if (!isPathLikeMemberDir(dit->path())) {
                     auto childId = _nextId++;
-                    _treeItems.insert(
-                        std::make_pair(childId,
-                                       ProjectTreeItem::Subdir{.parentTreeItem = subdirTreeItemId,
-                                                               .sourceDir = dit->path()}));
-                    auto r = addSourcesAndTreeItemsRecursively(targetId, childId);
-                    append_range(result.errors, std::move(r.errors));
-                    append_range(result.verboseMessages, std::move(r.verboseMessages));
+                    _treeItems.insert(childId,
+                                      ProjectTreeItem::Subdir{.parentTreeItem = subdirTreeItemId,
+                                                              .sourceDir = dit->path()});
+                    subdir.children.push_back(childId);
+                    addSourcesAndTreeItemsRecursively(
+                        targetId, childId, diagnostics, onSourceAdded);
                 }
                 break;
+            case not_found:
             case none:
             case symlink:
             case block:
@@ -169,19 +157,17 @@ Project::AddSourcesAndTreeItemsRecursivelyResult Project::addSourcesAndTreeItems
             case fifo:
             case socket:
             case unknown:
-                result.errors.push_back(fmt::format(
-                    "File `{}` has a type of {} and it's not yet decided what to do with this type",
-                    dit->path(),
-                    to_string_view(status.type())));
+                diagnostics.report<Diagnostic::UnsupportedFileType>(dit->path(), status.type());
                 break;
         }
     }
-    return result;
 }
 
-std::expected<Project::AddTargetResult, std::string> Project::addTarget(std::string targetName,
-                                                                        fs::path sourceDir,
-                                                                        fs::path outputDir) {
+std::expected<int64_t, std::string> Project::addTarget(std::string targetName,
+                                                      fs::path sourceDir,
+                                                      fs::path outputDir,
+                                                      Diagnostics& diagnostics,
+                                                      const SourceAddedFn& onSourceAdded) {
     CHECK(!targetName.empty());
     if (auto maybeId = findTargetByName(targetName)) {
         return std::unexpected(fmt::format("Target {} already exists", targetName));
@@ -211,19 +197,25 @@ std::expected<Project::AddTargetResult, std::string> Project::addTarget(std::str
                                                      .treeItem = treeItemId}));
     CHECK(itb.second);
     auto& target = itb.first->second;
-    _treeItems.insert(
-        std::make_pair(treeItemId,
-                       ProjectTreeItem::Subdir{.targetId = targetId,
-                                               .parentTreeItem = k_implicitRootTreeItemId,
-                                               .sourceDir = target.sourceDir}));
-    _targetsDisplayOrder.push_back(targetId);
-    std::ranges::sort(_targetsDisplayOrder, {}, [this](int64_t targetId) -> const std::string& {
-        return _targets.at(targetId).name;
-    });
-    auto r = addSourcesAndTreeItemsRecursively(targetId, treeItemId);
-    return AddTargetResult{.targetId = targetId,
-                           .nonFatalErrors = std::move(r.errors),
-                           .verboseMessages = std::move(r.verboseMessages)};
+    _treeItems.insert(treeItemId,
+                      ProjectTreeItem::Subdir{.targetId = targetId,
+                                              .parentTreeItem = k_implicitRootTreeItemId,
+                                              .sourceDir = target.sourceDir});
+    addSourcesAndTreeItemsRecursively(targetId, treeItemId, diagnostics, onSourceAdded);
+    auto displayOrderIt =
+        std::ranges::upper_bound(_targetsDisplayOrder,
+                                 target.name,
+                                 {},
+                                 [this](int64_t targetId) -> const std::string& {
+                                     return _targets.at(targetId).name;
+                                 });
+    auto row = displayOrderIt - _targetsDisplayOrder.begin();
+    _targetsDisplayOrder.insert(displayOrderIt, targetId);
+    _targetTreeItemsDisplayOrder.insert(_targetTreeItemsDisplayOrder.begin() + row, treeItemId);
+    if (_treeListener) {
+        _treeListener->treeItemsInserted(k_implicitRootTreeItemId, int(row), 1);
+    }
+    return targetId;
 }
 
 std::optional<int64_t> Project::findTargetByName(std::string_view name) const {
@@ -246,7 +238,7 @@ fs::path decoratedTargetNameSubdir(std::string_view targetName, Visibility visib
 }
 
 std::filesystem::path Project::headerPath(bool relativeToOutputDir, int64_t entityId) const {
-    auto& e = _entities.entity(entityId);
+    auto& e = _entities.entitySummary(entityId);
     auto targetIt = _targets.find(e.targetId);
     CHECK(targetIt != _targets.end()) << fmt::format("Target #{} not found", e.targetId);
     auto& target = targetIt->second;
@@ -256,7 +248,7 @@ std::filesystem::path Project::headerPath(bool relativeToOutputDir, int64_t enti
 
 std::filesystem::path Project::memberDeclarationsPath(bool relativeToOutputDir,
                                                       int64_t entityId) const {
-    auto& e = _entities.entity(entityId);
+    auto& e = _entities.entitySummary(entityId);
 
     switch (e.GetEntityKind()) {
         case EntityKind::class_:
@@ -283,7 +275,7 @@ std::filesystem::path Project::memberDeclarationsPath(bool relativeToOutputDir,
 }
 
 std::filesystem::path Project::cppPath(bool relativeToOutputDir, int64_t entityId) const {
-    auto& e = _entities.entity(entityId);
+    auto& e = _entities.entitySummary(entityId);
 
     auto targetIt = _targets.find(e.targetId);
     CHECK(targetIt != _targets.end()) << fmt::format("Target #{} not found", e.targetId);
@@ -304,6 +296,14 @@ std::filesystem::path Project::emptyHeaderPath(bool relativeToOutputDir, int64_t
     return relativeToOutputDir ? relPath : target.outputDir / relPath;
 }
 
+std::filesystem::path Project::moduleInterfacePath(bool relativeToOutputDir,
+                                                   int64_t targetId) const {
+    auto& target = _targets.at(targetId);
+    auto relPath =
+        decoratedTargetNameSubdir(target.name, Visibility::public_) / k_moduleInterfaceFilename;
+    return relativeToOutputDir ? relPath : target.outputDir / relPath;
+}
+
 void Project::updateSourceInTree(int64_t id) {
     auto& source = _entities.source(id);
     auto* entity = std::get_if<Entity>(&source.state);
@@ -324,10 +324,11 @@ void Project::updateSourceInTree(int64_t id) {
     } else {
         structOrClass = false;
     }
-    auto treeItemId = findTreeItemBySourcePath(source.targetId, source.sourcePath);
+    auto targetId = _entities.targetId(id);
+    auto treeItemId = findTreeItemBySourcePath(targetId, *source.sourcePath);
     CHECK(treeItemId) << fmt::format(
-        "Target #{}, source `{}` not found in tree for update", source.targetId, source.sourcePath);
-    auto& treeItem = _treeItems.at(*treeItemId);
+        "Target #{}, source `{}` not found in tree for update", targetId, *source.sourcePath);
+    auto& treeItem = _treeItems.atMut(*treeItemId);
     bool existingTreeItemIsStructOrClass = false;
     int64_t parentTreeItem = k_implicitRootTreeItemId;
     switch_variant(
@@ -347,25 +348,72 @@ void Project::updateSourceInTree(int64_t id) {
         });
     DCHECK(parentTreeItem != k_implicitRootTreeItemId);
     if (existingTreeItemIsStructOrClass) {
-        if (!structOrClass) {
+        auto& structOrClassInTree = std::get<ProjectTreeItem::StructOrClass>(treeItem);
+        if (structOrClass) {
+            // Keep the member tree items.
+            DCHECK(structOrClassInTree.sourceId == id);
+        } else {
             // Remove children.
-            auto& structOrClassInTree = std::get<ProjectTreeItem::StructOrClass>(treeItem);
-            for (auto childId : structOrClassInTree.children) {
+            auto removedIds = std::move(structOrClassInTree.children);
+            for (auto childId : removedIds) {
                 _treeItems.erase(childId);
             }
-            structOrClassInTree.children.clear();
+            treeItem =
+                ProjectTreeItem::LeafSource{.parentTreeItem = parentTreeItem, .sourceId = id};
+            if (_treeListener && !removedIds.empty()) {
+                _treeListener->treeItemsRemoved(*treeItemId, 0, removedIds);
+            }
         }
-    }
-    if (structOrClass) {
-        treeItem = ProjectTreeItem::StructOrClass{
-            .sourceId = id,
-            .parentTreeItem = parentTreeItem,
-            .sourceDir = structOrClassSourcePathToMemberDir(source.sourcePath)};
     } else {
-        treeItem = ProjectTreeItem::LeafSource{.parentTreeItem = parentTreeItem, .sourceId = id};
+        if (structOrClass) {
+            treeItem = ProjectTreeItem::StructOrClass{
+                .sourceId = id,
+                .parentTreeItem = parentTreeItem,
+                .sourceDir = structOrClassSourcePathToMemberDir(*source.sourcePath)};
+        } else {
+            treeItem =
+                ProjectTreeItem::LeafSource{.parentTreeItem = parentTreeItem, .sourceId = id};
+        }
+    }
+    if (_treeListener) {
+        _treeListener->treeItemChanged(*treeItemId);
     }
 }
 
+const ProjectTreeItem::V& Project::treeItem(int64_t id) const {
+    auto* treeItem = _treeItems.find(id);
+    CHECK(treeItem) << fmt::format("Tree item #{} not found", id);
+    return *treeItem;
+}
+
+std::span<const int64_t> Project::treeItemChildren(int64_t id) const {
+    if (id == k_implicitRootTreeItemId) {
+        return _targetTreeItemsDisplayOrder;
+    }
+    return switch_variant(
+        treeItem(id),
+        [](const ProjectTreeItem::Subdir& x) -> std::span<const int64_t> {
+            return x.children;
+        },
+        [](const ProjectTreeItem::StructOrClass& x) -> std::span<const int64_t> {
+            return x.children;
+        },
+        [](const ProjectTreeItem::LeafSource&) -> std::span<const int64_t> {
+            return {};
+        });
+}
+
+int64_t Project::treeItemParent(int64_t id) const {
+    return switch_variant(treeItem(id), [](const auto& x) {
+        return x.parentTreeItem;
+    });
+}
+
+std::expected<std::monostate, std::string> Project::entities_enableSpilling(
+    int64_t cacheCapBytes) {
+    return _entities.enableSpilling(cacheCapBytes);
+}
+
 void Project::entities_updateSourceWithEntity(int64_t id, Entity entity) {
     _entities.updateSourceWithEntity(id, std::move(entity));
     updateSourceInTree(id);
@@ -386,6 +434,13 @@ void Project::entities_updateSourceError(int64_t id,
     updateSourceInTree(id);
 }
 
+void Project::dirConfigs_set(DirConfigFile config) {
+    _dirConfigs.mut().set(std::move(config));
+}
+void Project::dirConfigs_erase(const std::filesystem::path& dir) {
+    _dirConfigs.mut().erase(dir);
+}
+
 std::optional<int64_t> Project::findTreeItemBySourcePath(int64_t targetId,
                                                          const fs::path& sourcePath) const {
     auto& target = _targets.at(targetId);
@@ -400,8 +455,8 @@ std::optional<int64_t> Project::findTreeItemBySourcePath(int64_t targetId,
     std::function<std::optional<int64_t>(int64_t)> findInTreeItem;
     findInTreeItem = [&](int64_t treeItemId) -> std::optional<int64_t> {
         // Find tree item of target.
-        auto treeItemIt = _treeItems.find(treeItemId);
-        if (treeItemIt == _treeItems.end()) {
+        auto* treeItem = _treeItems.find(treeItemId);
+        if (!treeItem) {
             DCHECK(false) << fmt::format(
                 "Tree item #{} not found for target #{}", target.treeItem, targetId);
             return std::nullopt;
@@ -427,20 +482,20 @@ std::optional<int64_t> Project::findTreeItemBySourcePath(int64_t targetId,
         };
 
         return switch_variant(
-            treeItemIt->second,
+            *treeItem,
             [&](const ProjectTreeItem::Subdir& x) -> std::optional<int64_t> {
                 return findHereOrInChildren(x.sourceDir, x.children);
             },
             [&](const ProjectTreeItem::StructOrClass& x) -> std::optional<int64_t> {
                 auto& source = _entities.source(x.sourceId);
-                if (source.sourcePath == sourcePath) {
+                if (*source.sourcePath == sourcePath) {
                     return treeItemId;
                 }
                 return findHereOrInChildren(x.sourceDir, x.children);
             },
             [&](const ProjectTreeItem::LeafSource& x) -> std::optional<int64_t> {
                 auto& source = _entities.source(x.sourceId);
-                if (source.sourcePath == sourcePath) {
+                if (*source.sourcePath == sourcePath) {
                     return treeItemId;
                 }
                 return std::nullopt;
@@ -466,6 +521,28 @@ int64_t parentTreeItem(const ProjectTreeItem::V& x) {
 }
 }  // namespace
 */
+
+Project::Stats Project::stats() const {
+    Stats s{.entities = _entities.stats(),
+            .targets = int64_t(_targets.size()),
+            .treeItems = int64_t(_treeItems.size()),
+            .dirConfigFiles = _dirConfigs->configCount()};
+    s.treeItemsBytes = int64_t(_treeItems.chunkBytes());
+    for (auto [id, ti] : _treeItems) {
+        switch_variant(
+            ti,
+            [&s](const ProjectTreeItem::Subdir& x) {
+                s.treeItemsBytes += HeapBytes(x.sourceDir) + HeapBytes(x.children);
+            },
+            [&s](const ProjectTreeItem::StructOrClass& x) {
+                s.treeItemsBytes += HeapBytes(x.sourceDir) + HeapBytes(x.children);
+            },
+            [](const ProjectTreeItem::LeafSource&) {});
+    }
+    s.dirConfigFilesBytes = _dirConfigs->heapBytes();
+    return s;
+}
+
 /*
 void Project::eraseTreeItem(int64_t parentId, int64_t childId) {
     auto& parent = _treeItems.at(parentId);
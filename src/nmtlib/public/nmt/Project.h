@@ -1,19 +1,26 @@
 #pragma once
 
 #include "nmt/DirConfigFile.h"
+#include "nmt/DirConfigTrie.h"
 #include "nmt/Entities.h"
 #include "nmt/Entity.h"
 #include "nmt/base_types.h"
+#include "util/Cow.h"
+#include "util/PersistentIdMap.h"
 
 #include <cstdint>
 #include <expected>
 #include <filesystem>
+#include <functional>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <variant>
 #include <vector>
 
+class Diagnostics;
+
 namespace ProjectTreeItem {
 struct Subdir {
     std::optional<int64_t> targetId;
@@ -32,10 +39,33 @@ struct LeafSource {
     int64_t sourceId;
 };
 using V = std::variant<Subdir, StructOrClass, LeafSource>;
+
+// Notified after the project tree has changed, to update views incrementally. `parent` is a tree
+// item id or `Project::k_implicitRootTreeItemId`, the parent of the targets' tree items.
+class Listener {
+   public:
+    virtual ~Listener() = default;
+    virtual void treeItemsInserted(int64_t parent, int first, int count) = 0;
+    // The rows [first, first + removedIds.size()) were removed, `removedIds` are the ids of the
+    // removed tree items, their descendants are removed as well.
+    virtual void treeItemsRemoved(int64_t parent,
+                                  int first,
+                                  std::span<const int64_t> removedIds) = 0;
+    virtual void treeItemChanged(int64_t treeItem) = 0;
+};
 }  // namespace ProjectTreeItem
 
 struct Project {
-    using DirConfigFiles = flat_hash_map<std::filesystem::path, DirConfigFile, path_hash>;
+    static constexpr int64_t k_implicitRootTreeItemId = -1;
+
+    Project() = default;
+    /// The tree listener is not copied. Copying is cheap (see `Entities`), a copy can be used as
+    /// an immutable snapshot on other threads while the original is being updated.
+    Project(const Project& y);
+    Project(Project&&) = default;
+    Project& operator=(const Project&) = delete;
+    Project& operator=(Project&&) = default;
+
     struct Target {
         std::string name;
         std::filesystem::path sourceDir, outputDir;
@@ -45,20 +75,39 @@ struct Project {
     const Entities& entities() const {
         return _entities;
     }
-    const flat_hash_map<int64_t, Target>& targets() const {
+    const node_hash_map<int64_t, Target>& targets() const {
         return _targets;
     }
-    DirConfigFiles& dirConfigFiles() {
-        return _dirConfigFiles;
+    const DirConfigTrie& dirConfigs() const {
+        return *_dirConfigs;
+    }
+    /// Target ids, sorted by name.
+    const std::vector<int64_t>& targetsDisplayOrder() const {
+        return _targetsDisplayOrder;
+    }
+    /// It's an error if `id` doesn't exist.
+    const ProjectTreeItem::V& treeItem(int64_t id) const;
+    /// Tree items of the targets (in display order) for `k_implicitRootTreeItemId`, otherwise the
+    /// children of the tree item.
+    std::span<const int64_t> treeItemChildren(int64_t id) const;
+    /// Return `k_implicitRootTreeItemId` for the targets' tree items.
+    int64_t treeItemParent(int64_t id) const;
+    /// At most one listener, nullptr to remove it.
+    void setTreeListener(ProjectTreeItem::Listener* listener) {
+        _treeListener = listener;
     }
 
-    struct AddTargetResult {
-        int64_t targetId;
-        std::vector<std::string> nonFatalErrors, verboseMessages;
-    };
-    /// Glob-recurse `sourceDir`, add sources and full tree for target.
-    [[nodiscard]] std::expected<AddTargetResult, std::string> addTarget(
-        std::string targetName, std::filesystem::path sourceDir, std::filesystem::path outputDir);
+    // Called for each source as soon as it's added, e.g. to start processing it (see
+    // `SourcePipeline`) while the rest of the tree is being traversed.
+    using SourceAddedFn = std::function<void(Entities::Id)>;
+    /// Glob-recurse `sourceDir`, add sources and full tree for target. Return: target id. The
+    /// errors during the traversal are reported to `diagnostics` but everything is tried to be read.
+    [[nodiscard]] std::expected<int64_t, std::string> addTarget(
+        std::string targetName,
+        std::filesystem::path sourceDir,
+        std::filesystem::path outputDir,
+        Diagnostics& diagnostics,
+        const SourceAddedFn& onSourceAdded = {});
     /// Return: target id
     std::optional<int64_t> findTargetByName(std::string_view name) const;
 
@@ -66,7 +115,24 @@ struct Project {
     std::filesystem::path cppPath(bool relativeToOutputDir, int64_t entityId) const;
     std::filesystem::path memberDeclarationsPath(bool relativeToOutputDir, int64_t entityId) const;
     std::filesystem::path emptyHeaderPath(bool relativeToOutputDir, int64_t targetId) const;
+    std::filesystem::path moduleInterfacePath(bool relativeToOutputDir, int64_t targetId) const;
+
+    struct Stats {
+        Entities::Stats entities;
+        int64_t targets = 0, treeItems = 0, dirConfigFiles = 0;
+        // Estimated heap bytes.
+        int64_t treeItemsBytes = 0, dirConfigFilesBytes = 0;
+    };
+    Stats stats() const;
 
+    /// Add or replace the dir config file of `config.parentDir`.
+    void dirConfigs_set(DirConfigFile config);
+    /// Remove the dir config file of `dir`, if any.
+    void dirConfigs_erase(const std::filesystem::path& dir);
+
+    /// See `Entities::enableSpilling()`.
+    [[nodiscard]] std::expected<std::monostate, std::string> entities_enableSpilling(
+        int64_t cacheCapBytes);
     /// It's an error if `id` doesn't exist.
     void entities_updateSourceWithEntity(int64_t id, Entity entity);
     /// It's an error if `id` doesn't exist.
@@ -80,16 +146,17 @@ struct Project {
                                     std::filesystem::file_time_type lastWriteTime);
 
    private:
-    static constexpr int64_t k_implicitRootTreeItemId = -1;
     int64_t _nextId = 1;
     node_hash_map<int64_t, Target>
         _targets;  // Not flat_hash_map: small size, not worth to optimize.
     std::vector<int64_t> _targetsDisplayOrder;
-    node_hash_map<int64_t, ProjectTreeItem::V>
-        _treeItems;  // Not flat_hash_map: tree item might be held while new ones are created.
+    std::vector<int64_t> _targetTreeItemsDisplayOrder;  // Tree items of `_targetsDisplayOrder`.
+    // References to tree items are stable while new ones are created (see `PersistentIdMap`).
+    PersistentIdMap<ProjectTreeItem::V> _treeItems;
 
     Entities _entities;
-    DirConfigFiles _dirConfigFiles;
+    Cow<DirConfigTrie> _dirConfigs;
+    ProjectTreeItem::Listener* _treeListener = nullptr;
 
     // void removeEntityFromTree(int64_t id);
     // void addEntityToTree(int64_t id);
@@ -98,18 +165,16 @@ struct Project {
     // void eraseTreeItem(int64_t parentId, int64_t childId);
     void updateSourceInTree(int64_t id);
 
-    struct AddSourcesAndTreeItemsRecursivelyResult {
-        std::vector<std::string> errors, verboseMessages;
-    };
-    /// Return errors during directory traversal but try reading everything.
-    [[nodiscard]] AddSourcesAndTreeItemsRecursivelyResult addSourcesAndTreeItemsRecursively(
-        int64_t targetId, int64_t subdirTreeItemId);
+    /// Report errors during directory traversal but try reading everything.
+    void addSourcesAndTreeItemsRecursively(int64_t targetId,
+                                           int64_t subdirTreeItemId,
+                                           Diagnostics& diagnostics,
+                                           const SourceAddedFn& onSourceAdded);
 
-    struct AddSourcesFromMemberDirResult {
-        std::vector<int64_t> children;
-        std::vector<std::string> errors, verboseMessages;
-    };
-    AddSourcesFromMemberDirResult addSourcesFromMemberDir(int64_t targetId,
-                                                          const std::filesystem::path& memberDir,
-                                                          int64_t structClassTreeItemId);
+    /// Return: the children tree items.
+    std::vector<int64_t> addSourcesFromMemberDir(int64_t targetId,
+                                                 const std::filesystem::path& memberDir,
+                                                 int64_t structClassTreeItemId,
+                                                 Diagnostics& diagnostics,
+                                                 const SourceAddedFn& onSourceAdded);
 };
@@ -0,0 +1,77 @@
+#include "nmt/SourcePipeline.h"
+
+#include "BatchedFileIO.h"
+
+#include "nmt/Project.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// The files of a batch are read together (see `ReadFiles`), small enough to keep the workers busy
+// while the sources are still being pushed.
+constexpr size_t k_batchSize = 16;
+}  // namespace
+
+SourcePipeline::SourcePipeline(TaskScheduler& scheduler)
+    : _group(scheduler) {
+}
+
+void SourcePipeline::push(const Project& project, Entities::Id id) {
+    CHECK(!_finished) << "SourcePipeline::push after finish.";
+    auto targetId = project.entities().targetId(id);
+    size_t index;
+    {
+        std::lock_guard lock(_resultsMutex);
+        index = _results.size();
+        _results.push_back(ProcessedSource{.id = id,
+                                           .result = ProcessSourceResult::CantReadFile{},
+                                           .lastWriteTime = fs::file_time_type::min()});
+    }
+    _batch.push_back(Job{.index = index,
+                         .id = id,
+                         .targetId = targetId,
+                         .targetRootSourceDir = project.targets().at(targetId).sourceDir,
+                         .sourcePath = project.entities().sourcePath(id)});
+    if (_batch.size() >= k_batchSize) {
+        startBatch();
+    }
+}
+
+void SourcePipeline::startBatch() {
+    _group.run([this, batch = std::move(_batch)] {
+        std::vector<fs::path> sourcePaths;
+        std::vector<const fs::path*> statPaths;
+        sourcePaths.reserve(batch.size());
+        statPaths.reserve(batch.size());
+        for (auto& job : batch) {
+            sourcePaths.push_back(job.sourcePath);
+            statPaths.push_back(&job.sourcePath);
+        }
+        // Stat before reading: an edit in between is seen as dirty by the next run.
+        auto lastWriteTimes = LastWriteTimes(statPaths);
+        auto sourceContents = ReadFiles(sourcePaths);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            auto& job = batch[i];
+            auto lastWriteTime = lastWriteTimes[i].value_or(fs::file_time_type::min());
+            auto result = ProcessSourceContent(job.targetId,
+                                               job.targetRootSourceDir,
+                                               job.sourcePath,
+                                               std::move(sourceContents[i]));
+            std::lock_guard lock(_resultsMutex);
+            auto& ps = _results[job.index];
+            ps.result = std::move(result);
+            ps.lastWriteTime = lastWriteTime;
+        }
+    });
+    _batch.clear();
+}
+
+std::vector<ProcessedSource> SourcePipeline::finish() {
+    CHECK(!_finished) << "SourcePipeline::finish called twice.";
+    _finished = true;
+    if (!_batch.empty()) {
+        startBatch();
+    }
+    _group.wait();
+    return std::move(_results);
+}
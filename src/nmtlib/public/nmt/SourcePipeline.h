@@ -0,0 +1,48 @@
+#pragma once
+
+#include "nmt/Entities.h"
+#include "nmt/ProcessSource.h"
+#include "util/TaskScheduler.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+struct Project;
+
+// Read and process sources as tasks of a `TaskScheduler` while they are being pushed, e.g. from the
+// callback of `Project::addTarget`, so processing the sources overlaps traversing the source
+// directories. The results are applied to the project by the caller with
+// `UpdateProjectWithProcessSourceResult`.
+class SourcePipeline {
+   public:
+    explicit SourcePipeline(TaskScheduler& scheduler = TaskScheduler::shared());
+    SourcePipeline(const SourcePipeline&) = delete;
+    SourcePipeline& operator=(const SourcePipeline&) = delete;
+    /// Drop the sources which haven't been started.
+    ~SourcePipeline() = default;
+
+    /// Queue the source `id` of `project`, what's needed from the project is copied.
+    void push(const Project& project, Entities::Id id);
+    /// Wait for the queued sources to be processed, return the results in the order of `push`.
+    /// Nothing can be pushed afterwards.
+    std::vector<ProcessedSource> finish();
+
+   private:
+    struct Job {
+        size_t index;
+        Entities::Id id;
+        int64_t targetId;
+        std::filesystem::path targetRootSourceDir;
+        std::filesystem::path sourcePath;
+    };
+
+    std::vector<Job> _batch;  // Not started yet.
+    std::mutex _resultsMutex;
+    std::vector<ProcessedSource> _results;  // Indexed by `Job::index`.
+    bool _finished = false;
+    TaskGroup _group;  // Destroyed first, it waits for the tasks using the members above.
+
+    void startBatch();
+};
@@ -0,0 +1,108 @@
+#include "nmt/SymbolTable.h"
+
+#include "nmtutil.h"
+
+#include "nmt/Project.h"
+#include "nmt/constants.h"
+
+namespace fs = std::filesystem;
+
+SymbolTable::SymbolTable(const Project& project)
+    : dirConfigs(project.dirConfigs()) {
+    auto& entities = project.entities();
+    std::vector<Entities::Id> memberIds;
+    for (auto id : entities.itemsWithEntities()) {
+        auto& e = entities.entitySummary(id);
+        if (isMemberEntityKind(e.GetEntityKind())) {
+            memberIds.push_back(id);
+            continue;
+        }
+        auto& ns = namespaceOf(e);
+        byQualifiedName[ns.empty() ? e.name : fmt::format("{}::{}", ns, e.name)].push_back(
+            Candidate{.targetId = e.targetId, .visibility = e.visibility, .id = id});
+    }
+    // The members are in the namespace of their struct/class, which may have its own annotation.
+    for (auto id : memberIds) {
+        auto& e = entities.entitySummary(id);
+        if (!e.sourcePath.has_parent_path()) {
+            continue;
+        }
+        auto memberDir = e.sourcePath.parent_path();
+        if (memberDirNamespaces.contains(memberDir)) {
+            continue;
+        }
+        // Without a containing struct/class `FindMemberRelations` reports an error.
+        if (auto structOrClassName = extractContainingStructOrClassNameFromMemberDir(memberDir)) {
+            auto basePath = memberDir;
+            basePath.replace_filename(*structOrClassName);
+            for (auto hx : k_validSourceExtensions) {
+                auto testPath = basePath;
+                testPath.replace_extension(hx);
+                if (auto maybeId = entities.findEntityBySourcePath(e.targetId, testPath)) {
+                    memberDirNamespaces.emplace(memberDir,
+                                                namespaceOf(entities.entitySummary(*maybeId)));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+const std::string& SymbolTable::namespaceOf(const Entity& e) const {
+    const bool isMember = isMemberEntityKind(e.GetEntityKind());
+    if (e.namespace_ && !isMember) {
+        return *e.namespace_;
+    }
+    auto dir = e.sourcePath.parent_path();
+    if (isMember) {
+        if (auto it = memberDirNamespaces.find(dir); it != memberDirNamespaces.end()) {
+            return it->second;
+        }
+    }
+    return dirConfigs.settings(dir).namespace_;
+}
+
+std::expected<Entities::Id, std::vector<Entities::Id>> SymbolTable::resolve(
+    const Entity& from, std::string_view name) const {
+    if (name.starts_with("::")) {
+        auto it = byQualifiedName.find(std::string(name.substr(2)));
+        if (it == byQualifiedName.end()) {
+            return std::unexpected(std::vector<Entities::Id>());
+        }
+        return resolveIn(from.targetId, it->second);
+    }
+    std::string_view scope = namespaceOf(from);
+    for (;;) {
+        auto it = byQualifiedName.find(scope.empty() ? std::string(name)
+                                                     : fmt::format("{}::{}", scope, name));
+        if (it != byQualifiedName.end()) {
+            // The private entities of the other targets don't hide the outer namespaces.
+            auto r = resolveIn(from.targetId, it->second);
+            if (r || !r.error().empty()) {
+                return r;
+            }
+        }
+        if (scope.empty()) {
+            return std::unexpected(std::vector<Entities::Id>());
+        }
+        auto i = scope.rfind("::");
+        scope = i == std::string_view::npos ? std::string_view() : scope.substr(0, i);
+    }
+}
+
+std::expected<Entities::Id, std::vector<Entities::Id>> SymbolTable::resolveIn(
+    int64_t targetId, const std::vector<Candidate>& candidates) const {
+    std::vector<Entities::Id> own, public_;
+    for (auto& c : candidates) {
+        if (c.targetId == targetId) {
+            own.push_back(c.id);
+        } else if (c.visibility == Visibility::public_) {
+            public_.push_back(c.id);
+        }
+    }
+    auto& result = own.empty() ? public_ : own;
+    if (result.size() != 1) {
+        return std::unexpected(std::move(result));
+    }
+    return result.front();
+}
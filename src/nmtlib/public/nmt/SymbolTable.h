@@ -0,0 +1,53 @@
+#pragma once
+
+#include "nmt/DirConfigTrie.h"
+#include "nmt/Entities.h"
+#include "nmt/base_types.h"
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Project;
+
+// The non-member entities by qualified name (`a::b::Foo`, `Foo` in the global namespace), over all
+// targets of the project. The namespace of an entity is its `#namespace` annotation or else the one
+// its dir inherits from the dir config files (see `DirConfigTrie`).
+//
+// A need is looked up like an unqualified (or partially qualified) name in C++: first in the
+// namespace of the needing entity, then in the enclosing namespaces, up to the global one. The
+// first namespace which declares the name wins. A need starting with `::` is looked up only as
+// written. Within a namespace the need resolves to the entity of the needing entity's own target,
+// or else to the public entity of another target.
+class SymbolTable {
+   public:
+    /// `project` must outlive the symbol table.
+    explicit SymbolTable(const Project& project);
+
+    /// The namespace of `e` (an entity of the project), empty for the global namespace. A member
+    /// function is in the namespace of its struct/class.
+    const std::string& namespaceOf(const Entity& e) const;
+
+    /// Resolve `name` needed by `from`. On error return the candidates: empty if the name is
+    /// missing, more than one if it's ambiguous (in the own target or among the public entities of
+    /// the other targets, in the innermost namespace which declares the name).
+    std::expected<Entities::Id, std::vector<Entities::Id>> resolve(const Entity& from,
+                                                                   std::string_view name) const;
+
+   private:
+    struct Candidate {
+        int64_t targetId;
+        Visibility visibility;
+        Entities::Id id;
+    };
+    const DirConfigTrie& dirConfigs;
+    flat_hash_map<std::string, std::vector<Candidate>> byQualifiedName;
+    // The namespaces of the struct/class of the member dirs.
+    flat_hash_map<std::filesystem::path, std::string, path_hash> memberDirNamespaces;
+
+    std::expected<Entities::Id, std::vector<Entities::Id>> resolveIn(
+        int64_t targetId, const std::vector<Candidate>& candidates) const;
+};
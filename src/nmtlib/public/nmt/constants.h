@@ -10,7 +10,14 @@ constexpr std::string_view k_autogeneratedWarningLine =
 constexpr std::string_view k_IntentionallyEmptyLineWarning = "// Intentionally empty.";
 
 constexpr std::string_view k_emptyHeaderFilename = "#empty.h";
+// The primary module interface unit of a target in `OutputMode::modules`.
+constexpr std::string_view k_moduleInterfaceFilename = "#module.cppm";
 constexpr std::string_view k_fileListFilename = "files.txt";
+// In the output dir, they map the generated entity headers to Clang modules and GCC header units.
+constexpr std::string_view k_clangModuleMapFilename = "module.modulemap";
+constexpr std::string_view k_gccModuleMapperFilename = "header-units.map";
+// Fingerprints of the inputs of the generated files, to skip producing the unchanged ones.
+constexpr std::string_view k_fingerprintsFilename = "fingerprints.txt";
 
 inline const std::set<std::filesystem::path> k_validSourceExtensions = {".h", ".hpp", ".hxx"};
 
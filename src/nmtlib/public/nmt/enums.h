@@ -21,6 +21,44 @@ struct enum_traits<Visibility> {
     static constexpr std::array<std::string_view, elements.size()> names{"public", "private"};
 };
 
+// What `GenerateBoilerplate` produces for the entities.
+enum class OutputMode {
+    headers,  // A header and a cpp file per entity.
+    modules,  // A module interface unit per target and a cpp file per function definition.
+};
+template<>
+struct enum_traits<OutputMode> {
+    using enum OutputMode;
+    static constexpr std::array<OutputMode, 2> elements{headers, modules};
+    static constexpr std::array<std::string_view, elements.size()> names{"headers", "modules"};
+};
+
+// Whether the declaration needs used only where an incomplete type will do are forward declared
+// instead of including the header of the needed entity.
+enum class AutoForwardDeclarations {
+    off,
+    suggest,  // Report them, with the cpp files which would no longer depend on the headers.
+    apply,    // Forward declare them, as if they were `Foo*` needs.
+};
+template<>
+struct enum_traits<AutoForwardDeclarations> {
+    using enum AutoForwardDeclarations;
+    static constexpr std::array<AutoForwardDeclarations, 3> elements{off, suggest, apply};
+    static constexpr std::array<std::string_view, elements.size()> names{"off", "suggest", "apply"};
+};
+
+enum class NeedsInference {
+    off,
+    suggest,  // Report the needs the identifiers reference which differ from the annotated ones.
+    apply,    // Use the inferred needs instead of the annotated ones.
+};
+template<>
+struct enum_traits<NeedsInference> {
+    using enum NeedsInference;
+    static constexpr std::array<NeedsInference, 3> elements{off, suggest, apply};
+    static constexpr std::array<std::string_view, elements.size()> names{"off", "suggest", "apply"};
+};
+
 enum class SpecialCommentKeyword { fdneeds, needs, defneeds, visibility, namespace_ };
 template<>
 struct enum_traits<SpecialCommentKeyword> {
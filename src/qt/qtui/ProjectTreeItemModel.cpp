@@ -3,74 +3,166 @@
 #include "nmt/Project.h"
 #include "nmt/base_types.h"
 
-/*
-struct Subdir {
-    std::vector<SubdirId> subdirs;
-    std::vector<EntityId> entities;
-};
-
-map<SubdirId, Subdir> subdirs;
-map<fs::path, SubdirId>
-
-{
-    Subdirid, parentsubdirid
-    entityid
-    memfnentityid
-}
-
-Subdir {
-    Subdir*
-    (Header|Class|Struct|Fn)*
-}
+// Model over `Project`'s tree items. The internal id of an index is the tree item id, which is
+// stable, so persistent indices survive the incremental updates.
+//
+// The children are populated lazily, `fetchMore` exposes them in batches, so opening a project
+// with a huge number of sources doesn't create rows for the collapsed subtrees. The project
+// notifies the model (`ProjectTreeItem::Listener`) about the changes of the tree, which are
+// translated to targeted row insertions/removals and `dataChanged` signals.
+struct ProjectTreeItemModel : public QAbstractItemModel, ProjectTreeItem::Listener {
+    static constexpr int k_fetchBatchSize = 512;
+    static constexpr int64_t k_rootId = Project::k_implicitRootTreeItemId;
 
-Class, Struct {
-    MemFn*
-}
-*/
-
-struct ProjectTreeItemModel : public QAbstractItemModel {
-    explicit ProjectTreeItemModel(const std::optional<Project>& project, QObject* parent)
+    explicit ProjectTreeItemModel(std::optional<Project>& project, QObject* parent)
         : QAbstractItemModel(parent)
-        , project(project) {}
+        , project(project) {
+        if (project) {
+            project->setTreeListener(this);
+        }
+    }
+    ~ProjectTreeItemModel() override {
+        if (project) {
+            project->setTreeListener(nullptr);
+        }
+    }
 
-    const std::optional<Project>& project;
+    std::optional<Project>& project;
 
-    /*
-    struct Subdir {
-        std::map<std::string, int64_t> subdirs;
+    void projectReset() {
+        beginResetModel();
+        fetchedCounts.clear();
+        exposedItems.clear();
+        if (project) {
+            project->setTreeListener(this);
+        }
+        endResetModel();
+    }
+
+    // Number of exposed rows of the fetched parents.
+    flat_hash_map<int64_t, int> fetchedCounts;
+    struct ExposedItem {
+        int64_t parent;
+        int row;
     };
-    flat_hash_map<int64_t, Subdir> idToSubdir;
+    // Exposed tree items: children of fetched parents, with row < fetched count.
+    flat_hash_map<int64_t, ExposedItem> exposedItems;
 
-    void f() {
-        constexpr int64_t k_rootSubdirId = 0;
-        for (auto& [k, v] : project->entities.items) {
-            auto it = v.sourcePath.begin();
-            CHECK(it != v.sourcePath.end());
-            auto subdirId = getOrMakeSubdir(path_to_string(*it), k_rootSubdirId);
-            auto s = ;
-            roots.insert(std::make_pair(s,
-            for(auto&pc:v.sourcePath){
-                if(
+    int64_t treeItemId(const QModelIndex& index) const {
+        return index.isValid() ? int64_t(index.internalId()) : k_rootId;
+    }
+    int fetchedCount(int64_t id) const {
+        auto it = fetchedCounts.find(id);
+        return it == fetchedCounts.end() ? 0 : it->second;
+    }
+    int totalChildCount(int64_t id) const {
+        return project ? int(project->treeItemChildren(id).size()) : 0;
+    }
+    // Invalid index for the root, nullopt if the tree item isn't exposed.
+    std::optional<QModelIndex> indexOfTreeItem(int64_t id) const {
+        if (id == k_rootId) {
+            return QModelIndex();
+        }
+        auto it = exposedItems.find(id);
+        if (it == exposedItems.end()) {
+            return std::nullopt;
+        }
+        return createIndex(it->second.row, 0, quintptr(id));
+    }
+    void updateRows(int64_t parent, int first) {
+        auto children = project->treeItemChildren(parent);
+        auto count = fetchedCount(parent);
+        for (int row = first; row < count; ++row) {
+            exposedItems[children[size_t(row)]] = ExposedItem{.parent = parent, .row = row};
+        }
+    }
+    // Forget the tree items and their exposed descendants. The removed tree items don't exist in
+    // the project any more, their descendants are found by `ExposedItem::parent`.
+    void forget(std::span<const int64_t> ids) {
+        std::vector<int64_t> exposedChildren;
+        for (auto id : ids) {
+            exposedItems.erase(id);
+            if (fetchedCounts.erase(id) == 0) {
+                continue;
+            }
+            for (auto& [childId, e] : exposedItems) {
+                if (e.parent == id) {
+                    exposedChildren.push_back(childId);
+                }
             }
         }
+        if (!exposedChildren.empty()) {
+            forget(exposedChildren);
+        }
+    }
+
+    // ProjectTreeItem::Listener
+
+    void treeItemsInserted(int64_t parent, int first, int count) override {
+        auto parentIndex = indexOfTreeItem(parent);
+        auto fetched = fetchedCount(parent);
+        if (!parentIndex || first > fetched || !fetchedCounts.contains(parent)) {
+            return;  // Will be fetched when needed.
+        }
+        beginInsertRows(*parentIndex, first, first + count - 1);
+        fetchedCounts[parent] = fetched + count;
+        updateRows(parent, first);
+        endInsertRows();
+    }
+    void treeItemsRemoved(int64_t parent,
+                          int first,
+                          std::span<const int64_t> removedIds) override {
+        auto parentIndex = indexOfTreeItem(parent);
+        auto fetched = fetchedCount(parent);
+        if (!parentIndex || first >= fetched) {
+            forget(removedIds);
+            return;
+        }
+        auto exposedCount = std::min(int(removedIds.size()), fetched - first);
+        beginRemoveRows(*parentIndex, first, first + exposedCount - 1);
+        forget(removedIds);
+        fetchedCounts[parent] = fetched - exposedCount;
+        updateRows(parent, first);
+        endRemoveRows();
+    }
+    void treeItemChanged(int64_t id) override {
+        if (auto index = indexOfTreeItem(id); index && index->isValid()) {
+            emit dataChanged(*index, *index, {Qt::DisplayRole, Qt::ToolTipRole});
+        }
     }
-*/
+
+    // QAbstractItemModel
+
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override {
-        if (!index.isValid() || index.column() != 0) {
+        if (!project || !index.isValid() || index.column() != 0) {
             return QVariant();
         }
-
-        if (role != Qt::DisplayRole) {
+        if (role != Qt::DisplayRole && role != Qt::ToolTipRole) {
             return QVariant();
         }
-        if (index == this->index(0, 0) || index == this->index(1, 0)) {
-            return QString("item (%0, %1), role: %2")
-                .arg(index.row())
-                .arg(index.column())
-                .arg(role);
+        auto sourcePathOfSource = [this](int64_t sourceId) -> const std::filesystem::path& {
+            return project->entities().sourcePath(sourceId);
+        };
+        auto& treeItem = project->treeItem(treeItemId(index));
+        const std::filesystem::path& path = switch_variant(
+            treeItem,
+            [](const ProjectTreeItem::Subdir& x) -> const std::filesystem::path& {
+                return x.sourceDir;
+            },
+            [&](const ProjectTreeItem::StructOrClass& x) -> const std::filesystem::path& {
+                return sourcePathOfSource(x.sourceId);
+            },
+            [&](const ProjectTreeItem::LeafSource& x) -> const std::filesystem::path& {
+                return sourcePathOfSource(x.sourceId);
+            });
+        if (role == Qt::ToolTipRole) {
+            return QString::fromStdString(path_to_string(path));
         }
-        assert(false);
-        return {};
+        if (auto* subdir = std::get_if<ProjectTreeItem::Subdir>(&treeItem);
+            subdir && subdir->targetId) {
+            return QString::fromStdString(project->targets().at(*subdir->targetId).name);
+        }
+        return QString::fromStdString(path_to_string(path.filename()));
     }
     Qt::ItemFlags flags(const QModelIndex& index) const override {
         if (!index.isValid()) {
@@ -81,8 +173,8 @@ struct ProjectTreeItemModel : public QAbstractItemModel {
     QVariant headerData(int section,
                         Qt::Orientation orientation,
                         int role = Qt::DisplayRole) const override {
-        if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
-            return QString("header %0 %1 %2").arg(section).arg(orientation).arg(role);
+        if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+            return tr("Sources");
         }
         return QVariant();
     }
@@ -92,41 +184,57 @@ struct ProjectTreeItemModel : public QAbstractItemModel {
         if (!hasIndex(row, column, parent)) {
             return QModelIndex();
         }
-        if (parent == QModelIndex() && (row == 0 || row == 1) && column == 0) {
-            return createIndex(row, 0, quintptr(0));
-        }
-        assert(false);
-        return QModelIndex();
+        auto children = project->treeItemChildren(treeItemId(parent));
+        return createIndex(row, column, quintptr(children[size_t(row)]));
     }
     QModelIndex parent(const QModelIndex& child) const override {
-        if (!child.isValid()) {
+        if (!project || !child.isValid()) {
             return QModelIndex();
         }
-        if (child == index(0, 0) || child == index(1, 0)) {
-            return QModelIndex();
-        }
-        assert(false);
-        return QModelIndex();
+        auto it = exposedItems.find(treeItemId(child));
+        CHECK(it != exposedItems.end()) << "Index of a tree item which is not exposed.";
+        auto parentIndex = indexOfTreeItem(it->second.parent);
+        CHECK(parentIndex) << "The parent of an exposed tree item must be exposed.";
+        return *parentIndex;
     }
     int rowCount(const QModelIndex& parent = QModelIndex()) const override {
-        if (parent == QModelIndex()) {
-            return 2;
+        if (parent.column() > 0) {
+            return 0;
         }
-        return 0;
+        return fetchedCount(treeItemId(parent));
+    }
+    int columnCount(const QModelIndex& = QModelIndex()) const override {
+        return 1;
+    }
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override {
+        return totalChildCount(treeItemId(parent)) > 0;
     }
-    int columnCount(const QModelIndex& parent = QModelIndex()) const override {
-        if (parent == QModelIndex()) {
-            return 1;
+    bool canFetchMore(const QModelIndex& parent) const override {
+        auto id = treeItemId(parent);
+        return fetchedCount(id) < totalChildCount(id);
+    }
+    void fetchMore(const QModelIndex& parent) override {
+        auto id = treeItemId(parent);
+        auto fetched = fetchedCount(id);
+        auto newFetched = std::min(totalChildCount(id), fetched + k_fetchBatchSize);
+        if (newFetched <= fetched) {
+            return;
         }
-        return 0;
+        beginInsertRows(parent, fetched, newFetched - 1);
+        fetchedCounts[id] = newFetched;
+        updateRows(id, fetched);
+        endInsertRows();
     }
 };
 
-std::unique_ptr<QAbstractItemModel> makeProjectTreeItemModel(
-    const std::optional<Project>& project) {
+std::unique_ptr<QAbstractItemModel> makeProjectTreeItemModel(std::optional<Project>& project) {
     return std::make_unique<ProjectTreeItemModel>(project, nullptr);
 }
-QAbstractItemModel* makeProjectTreeItemModel(const std::optional<Project>& project,
-                                             QObject* parent) {
+QAbstractItemModel* makeProjectTreeItemModel(std::optional<Project>& project, QObject* parent) {
     return new ProjectTreeItemModel(project, parent);
 }
+void resetProjectTreeItemModel(QAbstractItemModel& model) {
+    auto* m = dynamic_cast<ProjectTreeItemModel*>(&model);
+    CHECK(m) << "Not a ProjectTreeItemModel.";
+    m->projectReset();
+}
@@ -4,6 +4,8 @@ class QAbstractItemModel;
 struct Project;
 class QObject;
 
-std::unique_ptr<QAbstractItemModel> makeProjectTreeItemModel(const std::optional<Project>& project);
-QAbstractItemModel* makeProjectTreeItemModel(const std::optional<Project>& project,
-                                             QObject* parent);
+// The model registers itself as the tree listener of the project.
+std::unique_ptr<QAbstractItemModel> makeProjectTreeItemModel(std::optional<Project>& project);
+QAbstractItemModel* makeProjectTreeItemModel(std::optional<Project>& project, QObject* parent);
+// Call after the project has been replaced.
+void resetProjectTreeItemModel(QAbstractItemModel& model);
@@ -3,38 +3,167 @@
 #include "ProjectTreeItemModel.h"
 #include "appcommon/UserState.h"
 
+#include <unordered_map>
+
 struct MainWindow : public QMainWindow {
+    static constexpr size_t k_maxSearchResults = 200;
+
+    const UserState& userState;
+    QLineEdit* searchBox;
+    QListWidget* searchResults;
     QTreeView* projectTree;
-    MainWindow() {
+    // The entities whose compile check failed, with the compiler's output as data.
+    QListWidget* checkFailures;
+    QPlainTextEdit* checkDiagnostics;
+    std::unordered_map<int64_t, QListWidgetItem*> checkFailureItems;
+    explicit MainWindow(const UserState& userState)
+        : userState(userState) {
         setWindowTitle(tr("NMT"));
 
         auto* hSplitter = new QSplitter(Qt::Horizontal);
         setCentralWidget(hSplitter);
 
+        searchBox = new QLineEdit;
+        searchBox->setPlaceholderText(tr("Search entities"));
+        searchBox->setClearButtonEnabled(true);
+        connect(searchBox, &QLineEdit::textChanged, this, &MainWindow::updateSearchResults);
+
+        // Replaces the project tree while there's a query.
+        searchResults = new QListWidget;
+        searchResults->setUniformItemSizes(true);
+        searchResults->hide();
+        connect(searchResults, &QListWidget::itemActivated, this, [this](QListWidgetItem* item) {
+            statusBar()->showMessage(item->toolTip());
+        });
+
         projectTree = new QTreeView;
+        // Avoids measuring every row, the tree can have a huge number of items.
+        projectTree->setUniformRowHeights(true);
 
-        hSplitter->addWidget(projectTree);
-        hSplitter->addWidget(new QWidget);
+        auto* sidePanel = new QWidget;
+        auto* sidePanelLayout = new QVBoxLayout(sidePanel);
+        sidePanelLayout->setContentsMargins(0, 0, 0, 0);
+        sidePanelLayout->addWidget(searchBox);
+        sidePanelLayout->addWidget(searchResults);
+        sidePanelLayout->addWidget(projectTree);
+
+        checkFailures = new QListWidget;
+        checkDiagnostics = new QPlainTextEdit;
+        checkDiagnostics->setReadOnly(true);
+        checkDiagnostics->setLineWrapMode(QPlainTextEdit::NoWrap);
+        connect(checkFailures,
+                &QListWidget::currentItemChanged,
+                this,
+                [this](QListWidgetItem* current, QListWidgetItem*) {
+                    checkDiagnostics->setPlainText(current ? current->data(Qt::UserRole).toString()
+                                                           : QString());
+                });
+        auto* vSplitter = new QSplitter(Qt::Vertical);
+        vSplitter->addWidget(checkFailures);
+        vSplitter->addWidget(checkDiagnostics);
+
+        hSplitter->addWidget(sidePanel);
+        hSplitter->addWidget(vSplitter);
 
         auto as = screen()->availableSize();
         resize(as.width() / 2, as.height() / 2);
         setMinimumSize(160, 160);
     }
+
+    void updateSearchResults() {
+        auto query = searchBox->text().toStdString();
+        searchResults->clear();
+        searchResults->setVisible(!query.empty());
+        projectTree->setVisible(query.empty());
+        if (query.empty() || !userState.project) {
+            return;
+        }
+        auto& entities = userState.project->entities();
+        for (auto& r : userState.entitySearchIndex.search(query, k_maxSearchResults)) {
+            auto& entity = entities.entity(r.sourceId);
+            auto* item = new QListWidgetItem(
+                QString::fromStdString(entity.name) + "  "
+                    + QString::fromStdString(path_to_string(entity.sourceRelPath)),
+                searchResults);
+            item->setToolTip(
+                QString::fromStdString(path_to_string(entities.sourcePath(r.sourceId))));
+        }
+    }
+
+    void showCompileCheckResult(int64_t entityId, bool ok, std::string_view diagnostics) {
+        auto it = checkFailureItems.find(entityId);
+        if (ok) {
+            if (it != checkFailureItems.end()) {
+                delete it->second;
+                checkFailureItems.erase(it);
+            }
+            return;
+        }
+        QListWidgetItem* item;
+        if (it != checkFailureItems.end()) {
+            item = it->second;
+        } else {
+            QString name = QString::number(entityId);
+            if (userState.project) {
+                name = QString::fromStdString(userState.project->entities().entity(entityId).name);
+            }
+            item = new QListWidgetItem(name, checkFailures);
+            checkFailureItems.emplace(entityId, item);
+        }
+        auto text = QString::fromUtf8(diagnostics.data(), qsizetype(diagnostics.size()));
+        item->setData(Qt::UserRole, text);
+        if (item == checkFailures->currentItem()) {
+            checkDiagnostics->setPlainText(text);
+        }
+    }
 };
 
 struct QtUI : UI {
     QApplication _application;
+    // Valid during `exec()`.
+    MainWindow* _mainWindow = nullptr;
+    QAbstractItemModel* _projectTreeModel = nullptr;
 
     QtUI(int& argc, char* argv[])
         : _application(argc, argv) {}
-    int exec(const UserState* userState) override {
+    int exec(UserState* userState) override {
         auto sidePanelModel = makeProjectTreeItemModel(userState->project);
 
-        MainWindow mainWindow;
+        MainWindow mainWindow(*userState);
         mainWindow.projectTree->setModel(sidePanelModel.get());
 
+        _mainWindow = &mainWindow;
+        _projectTreeModel = sidePanelModel.get();
         mainWindow.show();
-        return _application.exec();
+        auto result = _application.exec();
+        _mainWindow = nullptr;
+        _projectTreeModel = nullptr;
+        return result;
+    }
+    void postToUiThread(std::function<void()> fn) override {
+        // Queued: executed by the event loop of the application's (the UI) thread.
+        QMetaObject::invokeMethod(&_application, std::move(fn), Qt::QueuedConnection);
+    }
+    void projectReset() override {
+        if (_projectTreeModel) {
+            resetProjectTreeItemModel(*_projectTreeModel);
+        }
+        if (_mainWindow) {
+            _mainWindow->updateSearchResults();
+        }
+    }
+    void showProgress(std::string_view message) override {
+        if (_mainWindow) {
+            _mainWindow->statusBar()->showMessage(
+                QString::fromUtf8(message.data(), qsizetype(message.size())));
+        }
+    }
+    void showCompileCheckResult(int64_t entityId,
+                                bool ok,
+                                std::string_view diagnostics) override {
+        if (_mainWindow) {
+            _mainWindow->showCompileCheckResult(entityId, ok, diagnostics);
+        }
     }
 };
 
@@ -0,0 +1,46 @@
+#include "util/MakeDepfile.h"
+
+std::vector<std::string> ParseMakeDepfilePrerequisites(std::string_view content) {
+    std::vector<std::string> result;
+    std::string word;
+    bool inPrerequisites = false;  // After the `:` of the current rule.
+    auto endWord = [&] {
+        if (word.empty()) {
+            return;
+        }
+        if (inPrerequisites) {
+            result.push_back(std::move(word));
+        }
+        word.clear();
+    };
+    for (size_t i = 0; i < content.size(); ++i) {
+        char c = content[i];
+        char next = i + 1 < content.size() ? content[i + 1] : '\0';
+        if (c == '\\' && (next == '\n' || (next == '\r' && i + 2 < content.size()))) {
+            // Line continuation.
+            endWord();
+            i += next == '\r' ? 2 : 1;
+        } else if (c == '\\' && (next == ' ' || next == '#' || next == '\\')) {
+            word += next;
+            ++i;
+        } else if (c == '$' && next == '$') {
+            word += '$';
+            ++i;
+        } else if (c == '\n' || c == '\r') {
+            endWord();
+            inPrerequisites = false;
+        } else if (c == ' ' || c == '\t') {
+            endWord();
+        } else if (c == ':' && !inPrerequisites
+                   && (next == ' ' || next == '\t' || next == '\n' || next == '\r'
+                       || next == '\0')) {
+            // A target's `:`, not a drive letter's.
+            word.clear();
+            inPrerequisites = true;
+        } else {
+            word += c;
+        }
+    }
+    endWord();
+    return result;
+}
@@ -0,0 +1,11 @@
+#include "util/MakeDepfile.h"
+
+#include <gtest/gtest.h>
+
+TEST(MakeDepfile, parse) {
+    EXPECT_EQ(ParseMakeDepfilePrerequisites("a.o: a.cpp /usr/include/b.h \\\n  c\\ d.h \\\r\n"
+                                            " e$$.h\n\nx.h:\ny.o z.o: C:/y.h\n"),
+              (std::vector<std::string>{"a.cpp", "/usr/include/b.h", "c d.h", "e$.h", "C:/y.h"}));
+    EXPECT_TRUE(ParseMakeDepfilePrerequisites("").empty());
+    EXPECT_TRUE(ParseMakeDepfilePrerequisites("a.o:\n").empty());
+}
@@ -0,0 +1,47 @@
+#include "util/PersistentColumn.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+template<class C>
+std::vector<int> Values(const C& c) {
+    std::vector<int> r;
+    for (size_t i = 0; i < c.chunkCount(); ++i) {
+        r.insert(r.end(), c.chunk(i).begin(), c.chunk(i).end());
+    }
+    return r;
+}
+}  // namespace
+
+TEST(PersistentColumn, basic) {
+    PersistentColumn<int, 4> c;
+    EXPECT_EQ(c.size(), 0u);
+    EXPECT_EQ(c.chunkCount(), 0u);
+    for (int i = 0; i < 6; ++i) {
+        c.push_back(i);
+    }
+    EXPECT_EQ(c.size(), 6u);
+    EXPECT_EQ(c.chunkCount(), 2u);
+    EXPECT_EQ(c.chunk(1).size(), 2u);
+    EXPECT_EQ(c[5], 5);
+    c.mut(5) = 50;
+    EXPECT_EQ(Values(c), (std::vector<int>{0, 1, 2, 3, 4, 50}));
+}
+
+TEST(PersistentColumn, copies_share_unwritten_chunks) {
+    PersistentColumn<int, 4> a;
+    for (int i = 0; i < 5; ++i) {
+        a.push_back(i);
+    }
+    auto b = a;
+    EXPECT_EQ(a.chunk(0).data(), b.chunk(0).data());
+    b.mut(4) = 40;
+    EXPECT_EQ(a.chunk(0).data(), b.chunk(0).data());
+    EXPECT_NE(a.chunk(1).data(), b.chunk(1).data());
+    b.mut(0) = 10;
+    b.push_back(5);
+    EXPECT_EQ(Values(a), (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(Values(b), (std::vector<int>{10, 1, 2, 3, 40, 5}));
+}
@@ -0,0 +1,81 @@
+#include "util/AtomicSnapshot.h"
+#include "util/PersistentIdMap.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+template<class M>
+std::vector<std::pair<int64_t, std::string>> Items(const M& m) {
+    std::vector<std::pair<int64_t, std::string>> r;
+    for (auto [id, value] : m) {
+        r.emplace_back(id, value);
+    }
+    return r;
+}
+using P = std::vector<std::pair<int64_t, std::string>>;
+}  // namespace
+
+TEST(PersistentIdMap, basic) {
+    PersistentIdMap<std::string, 4> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.insert(1, "a").second);
+    EXPECT_TRUE(m.insert(9, "b").second);
+    EXPECT_FALSE(m.insert(1, "c").second);
+    EXPECT_EQ(m.size(), 2u);
+    EXPECT_EQ(m.at(1), "a");
+    EXPECT_EQ(m.find(2), nullptr);
+    EXPECT_EQ(m.find(-1), nullptr);
+    EXPECT_EQ(m.find(100), nullptr);
+    EXPECT_EQ(Items(m), (P{{1, "a"}, {9, "b"}}));
+
+    m.atMut(9) = "B";
+    EXPECT_TRUE(m.erase(1));
+    EXPECT_FALSE(m.erase(1));
+    EXPECT_EQ(Items(m), (P{{9, "B"}}));
+}
+
+TEST(PersistentIdMap, copies_share_chunks_until_written) {
+    PersistentIdMap<std::string, 4> m;
+    for (int64_t id = 0; id < 8; ++id) {
+        m.insert(id, std::to_string(id));
+    }
+    auto snapshot = m;
+    // Same chunk, not cloned yet.
+    EXPECT_EQ(&snapshot.at(0), &m.at(0));
+
+    m.atMut(1) = "x";
+    m.erase(6);
+    m.insert(12, "12");
+    EXPECT_EQ(snapshot.at(1), "1");
+    EXPECT_EQ(snapshot.at(6), "6");
+    EXPECT_FALSE(snapshot.contains(12));
+    EXPECT_EQ(snapshot.size(), 8u);
+    EXPECT_EQ(m.at(1), "x");
+    EXPECT_EQ(m.size(), 8u);
+    // Chunk #0 was cloned, chunk #1 too, which now is exclusively owned.
+    EXPECT_NE(&snapshot.at(0), &m.at(0));
+    auto* p = &m.at(5);
+    m.atMut(5) = "y";
+    EXPECT_EQ(p, &m.at(5));
+}
+
+TEST(AtomicSnapshot, publish_and_load) {
+    AtomicSnapshot<PersistentIdMap<std::string>> current;
+    EXPECT_EQ(current.load(), nullptr);
+
+    PersistentIdMap<std::string> m;
+    m.insert(1, "a");
+    current.publish(std::make_shared<const PersistentIdMap<std::string>>(m));
+    std::jthread reader([&current] {
+        auto snapshot = current.load();
+        ASSERT_TRUE(snapshot);
+        EXPECT_EQ(snapshot->at(1), "a");
+    });
+    reader.join();
+    m.atMut(1) = "b";
+    EXPECT_EQ(current.load()->at(1), "a");
+}
@@ -0,0 +1,130 @@
+#include "util/RunProcess.h"
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <signal.h>
+#    include <spawn.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#    include <cerrno>
+#    include <cstring>
+#    include <optional>
+#    include <vector>
+
+extern char** environ;
+#endif
+
+#ifdef _WIN32
+
+std::expected<ProcessResult, std::string> RunProcess(std::span<const std::string>,
+                                                     const std::function<bool()>&) {
+    return std::unexpected("RunProcess is not implemented on Windows");
+}
+
+#else
+
+namespace {
+// Interval of polling `shouldCancel` while the process doesn't write anything.
+constexpr int k_pollIntervalMs = 50;
+
+std::string ErrnoMessage(std::string_view what, int error) {
+    return std::string(what) + ": " + strerror(error);
+}
+}  // namespace
+
+std::expected<ProcessResult, std::string> RunProcess(std::span<const std::string> args,
+                                                     const std::function<bool()>& shouldCancel) {
+    if (args.empty()) {
+        return std::unexpected("RunProcess: no command");
+    }
+    int fds[2];
+    // In its own process group, so cancelling also kills the processes it spawned (the compiler
+    // proper of a compiler driver).
+    int flags = POSIX_SPAWN_SETPGROUP;
+#    ifdef __APPLE__
+    // No `pipe2`. The processes spawned concurrently can inherit the pipe, which would keep it
+    // open until they exit, unless they are spawned like this one: with only the descriptors of
+    // the file actions.
+    if (pipe(fds) != 0) {
+        return std::unexpected(ErrnoMessage("pipe", errno));
+    }
+    flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#    else
+    // Close-on-exec atomically, so the pipe is not inherited by other processes spawned
+    // concurrently, which would keep it open until they exit.
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return std::unexpected(ErrnoMessage("pipe2", errno));
+    }
+#    endif
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, static_cast<short>(flags));
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+#    ifdef __APPLE__
+    posix_spawn_file_actions_addinherit_np(&actions, STDIN_FILENO);
+#    endif
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(const_cast<char*>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t pid;
+    int spawnError = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+    if (spawnError != 0) {
+        close(fds[0]);
+        return std::unexpected(ErrnoMessage(args[0], spawnError));
+    }
+
+    ProcessResult result;
+    std::optional<std::string> pollError;
+    char buffer[4096];
+    for (;;) {
+        if (shouldCancel && shouldCancel()) {
+            kill(-pid, SIGKILL);
+            result.cancelled = true;
+            break;
+        }
+        pollfd pfd{.fd = fds[0], .events = POLLIN, .revents = 0};
+        int pr = poll(&pfd, 1, k_pollIntervalMs);
+        if (pr < 0 && errno != EINTR) {
+            // The output can't be read any more, don't wait for the process to finish.
+            pollError = ErrnoMessage("poll", errno);
+            kill(-pid, SIGKILL);
+            break;
+        }
+        if (pr <= 0) {
+            continue;
+        }
+        auto n = read(fds[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;  // EOF: the process (and its children) closed the pipe.
+        }
+        result.output.append(buffer, size_t(n));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (pollError) {
+        return std::unexpected(std::move(*pollError));
+    }
+    if (WIFEXITED(status)) {
+        result.exitCode = WEXITSTATUS(status);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "util/RunProcess.h"
+
+#include <gtest/gtest.h>
+
+#include <signal.h>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+TEST(RunProcess, output_and_exit_code) {
+    std::vector<std::string> args = {"sh", "-c", "echo out; echo err >&2; exit 3"};
+    auto r = RunProcess(args);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->exitCode, 3);
+    EXPECT_FALSE(r->cancelled);
+    EXPECT_EQ(r->output, "out\nerr\n");
+}
+
+TEST(RunProcess, cancel) {
+    std::vector<std::string> args = {"sleep", "10"};
+    int polls = 0;
+    auto r = RunProcess(args, [&polls] {
+        return ++polls > 2;
+    });
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(r->cancelled);
+    EXPECT_EQ(r->exitCode, -1);
+}
+
+TEST(RunProcess, cancel_kills_the_children) {
+    std::vector<std::string> args = {"sh", "-c", "sleep 10 & echo $!; wait"};
+    auto start = std::chrono::steady_clock::now();
+    auto r = RunProcess(args, [start] {
+        return std::chrono::steady_clock::now() - start > std::chrono::milliseconds(300);
+    });
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(r->cancelled);
+    auto child = std::stoi(r->output);
+    // Killed: gone, or (on Linux, where it can be told) a zombie until it's reaped by init.
+    auto isDead = [child] {
+        if (kill(child, 0) != 0) {
+            return true;
+        }
+#ifdef __linux__
+        std::ifstream stat("/proc/" + std::to_string(child) + "/stat");
+        std::string pid, comm, state;
+        return stat >> pid >> comm >> state && state == "Z";
+#else
+        return false;
+#endif
+    };
+    for (int i = 0; i < 100 && !isDead(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(isDead());
+}
+
+TEST(RunProcess, not_found) {
+    std::vector<std::string> args = {"/nonexistent/program"};
+    EXPECT_FALSE(RunProcess(args));
+}
@@ -0,0 +1,68 @@
+#include "util/StableHash.h"
+
+#include <charconv>
+#include <cstdio>
+
+void StableHasher::addBytes(const void* data, size_t size) {
+    auto* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= k_prime;
+    }
+}
+
+StableHasher& StableHasher::add(std::string_view s) {
+    add(uint64_t(s.size()));
+    addBytes(s.data(), s.size());
+    return *this;
+}
+
+StableHasher& StableHasher::add(const std::filesystem::path& p) {
+    auto s = p.generic_u8string();
+    add(std::string_view(reinterpret_cast<const char*>(s.data()), s.size()));
+    return *this;
+}
+
+StableHasher& StableHasher::add(uint64_t x) {
+    // Byte order independent.
+    unsigned char bytes[sizeof(x)];
+    for (size_t i = 0; i < sizeof(x); ++i) {
+        bytes[i] = static_cast<unsigned char>(x >> (8 * i));
+    }
+    addBytes(bytes, sizeof(bytes));
+    return *this;
+}
+
+StableHasher& StableHasher::add(std::span<const std::string> v) {
+    add(uint64_t(v.size()));
+    for (auto& s : v) {
+        add(std::string_view(s));
+    }
+    return *this;
+}
+
+StableHasher& StableHasher::add(const std::optional<std::string>& s) {
+    add(uint64_t(s.has_value()));
+    if (s) {
+        add(std::string_view(*s));
+    }
+    return *this;
+}
+
+std::string StableHashToString(uint64_t x) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(x));
+    return std::string(buf, 16);
+}
+
+std::optional<uint64_t> ParseStableHashString(std::string_view s) {
+    if (s.size() != 16) {
+        return std::nullopt;
+    }
+    uint64_t x = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), x, 16);
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        return std::nullopt;
+    }
+    return x;
+}
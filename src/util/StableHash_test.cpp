@@ -0,0 +1,37 @@
+#include "util/StableHash.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(StableHash, known_values) {
+    // FNV-1a of no bytes is the offset basis.
+    EXPECT_EQ(StableHasher().digest(), 14695981039346656037ull);
+    // The value must not change between builds and platforms, it's persisted.
+    EXPECT_EQ(StableHasher().add("foo").digest(), StableHasher().add("foo").digest());
+    EXPECT_NE(StableHasher().add("foo").digest(), StableHasher().add("bar").digest());
+}
+
+TEST(StableHash, length_prefixed_strings) {
+    auto ab_c = StableHasher().add("ab").add("c").digest();
+    auto a_bc = StableHasher().add("a").add("bc").digest();
+    EXPECT_NE(ab_c, a_bc);
+
+    std::vector<std::string> v1 = {"a", ""};
+    std::vector<std::string> v2 = {"a"};
+    EXPECT_NE(StableHasher().add(v1).digest(), StableHasher().add(v2).digest());
+
+    EXPECT_NE(StableHasher().add(std::optional<std::string>()).digest(),
+              StableHasher().add(std::optional<std::string>("")).digest());
+}
+
+TEST(StableHash, string_roundtrip) {
+    for (uint64_t x : {uint64_t(0), uint64_t(1), uint64_t(0xfedcba9876543210ull), UINT64_MAX}) {
+        auto s = StableHashToString(x);
+        EXPECT_EQ(s.size(), 16u);
+        EXPECT_EQ(ParseStableHashString(s), x);
+    }
+    EXPECT_EQ(ParseStableHashString(""), std::nullopt);
+    EXPECT_EQ(ParseStableHashString("123"), std::nullopt);
+    EXPECT_EQ(ParseStableHashString("000000000000000g"), std::nullopt);
+}
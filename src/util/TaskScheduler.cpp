@@ -0,0 +1,251 @@
+#include "util/TaskScheduler.h"
+
+#include <absl/log/check.h>
+
+#include <algorithm>
+
+namespace {
+thread_local const TaskScheduler* t_scheduler = nullptr;
+thread_local size_t t_workerIndex = 0;
+// Where the threads which aren't workers start looking for a victim.
+thread_local size_t t_nextVictim = 0;
+
+std::atomic<unsigned> g_sharedThreadCount = 0;
+std::atomic<bool> g_sharedCreated = false;
+}  // namespace
+
+TaskScheduler::TaskScheduler(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // All workers must exist before any of them starts stealing.
+    for (unsigned i = 1; i < threadCount; ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->thread = std::jthread([this, i] {
+            workerLoop(i);
+        });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard lock(_sleepMutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& w : _workers) {
+        w->thread.join();
+    }
+}
+
+std::vector<TaskScheduler::WorkerStats> TaskScheduler::workerStats() const {
+    auto toStats = [](const Counters& c) {
+        return WorkerStats{.tasksRun = c.tasksRun.load(std::memory_order_relaxed),
+                           .tasksStolen = c.tasksStolen.load(std::memory_order_relaxed),
+                           .busyTime = std::chrono::nanoseconds(
+                               c.busyNanoseconds.load(std::memory_order_relaxed))};
+    };
+    std::vector<WorkerStats> result;
+    for (auto& w : _workers) {
+        result.push_back(toStats(w->counters));
+    }
+    result.push_back(toStats(_waitingThreadCounters));
+    return result;
+}
+
+TaskScheduler& TaskScheduler::shared() {
+    static TaskScheduler scheduler((g_sharedCreated = true, g_sharedThreadCount.load()));
+    return scheduler;
+}
+
+void TaskScheduler::setSharedThreadCount(unsigned threadCount) {
+    CHECK(!g_sharedCreated) << "TaskScheduler::setSharedThreadCount after TaskScheduler::shared.";
+    g_sharedThreadCount = threadCount;
+}
+
+std::optional<size_t> TaskScheduler::currentWorkerIndex() const {
+    if (t_scheduler != this) {
+        return std::nullopt;
+    }
+    return t_workerIndex;
+}
+
+void TaskScheduler::submit(Task task) {
+    // Counted before being queued so the sleepers which see 0 can't miss it.
+    _queuedTasks.fetch_add(1);
+    if (auto workerIndex = currentWorkerIndex()) {
+        auto& w = *_workers[*workerIndex];
+        std::lock_guard lock(w.mutex);
+        w.tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard lock(_injectedMutex);
+        _injected.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(_sleepMutex);
+    }
+    _wake.notify_one();
+}
+
+std::optional<TaskScheduler::Task> TaskScheduler::findTask(std::optional<size_t> workerIndex,
+                                                           bool& stolen) {
+    auto take = [this](std::deque<Task>& tasks, bool fromBack) {
+        Task task;
+        if (fromBack) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        _queuedTasks.fetch_sub(1);
+        return task;
+    };
+    stolen = false;
+    if (workerIndex) {
+        auto& w = *_workers[*workerIndex];
+        std::lock_guard lock(w.mutex);
+        if (!w.tasks.empty()) {
+            return take(w.tasks, true);
+        }
+    }
+    {
+        std::lock_guard lock(_injectedMutex);
+        if (!_injected.empty()) {
+            return take(_injected, false);
+        }
+    }
+    const size_t n = _workers.size();
+    const size_t start = workerIndex ? *workerIndex + 1 : t_nextVictim++;
+    for (size_t k = 0; k < n; ++k) {
+        const size_t victim = (start + k) % n;
+        if (victim == workerIndex) {
+            continue;
+        }
+        auto& w = *_workers[victim];
+        std::lock_guard lock(w.mutex);
+        if (!w.tasks.empty()) {
+            stolen = true;
+            return take(w.tasks, false);
+        }
+    }
+    return std::nullopt;
+}
+
+void TaskScheduler::execute(Task task, Counters& counters, bool stolen) {
+    auto* group = task.group;
+    const auto startTime = std::chrono::steady_clock::now();
+    if (!group->isCanceled()) {
+        try {
+            task.fn();
+        } catch (...) {
+            std::lock_guard lock(group->_exceptionMutex);
+            if (!group->_exception) {
+                group->_exception = std::current_exception();
+            }
+            group->cancel();
+        }
+    }
+    task.fn = nullptr;  // Release the captures before the group can be destroyed.
+    counters.busyNanoseconds.fetch_add(
+        uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - startTime)
+                     .count()),
+        std::memory_order_relaxed);
+    counters.tasksRun.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) {
+        counters.tasksStolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (group->_pendingTasks.fetch_sub(1) == 1) {
+        notifyGroupDone();
+    }
+}
+
+void TaskScheduler::notifyGroupDone() {
+    {
+        std::lock_guard lock(_sleepMutex);
+    }
+    _wake.notify_all();
+}
+
+void TaskScheduler::workerLoop(size_t workerIndex) {
+    t_scheduler = this;
+    t_workerIndex = workerIndex;
+    auto& counters = _workers[workerIndex]->counters;
+    for (;;) {
+        bool stolen;
+        if (auto task = findTask(workerIndex, stolen)) {
+            execute(std::move(*task), counters, stolen);
+            continue;
+        }
+        std::unique_lock lock(_sleepMutex);
+        _wake.wait(lock, [this] {
+            return _stopping || _queuedTasks.load() > 0;
+        });
+        if (_stopping && _queuedTasks.load() == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    cancel();
+    waitImpl();
+}
+
+void TaskGroup::run(std::function<void()> fn) {
+    _pendingTasks.fetch_add(1);
+    _scheduler.submit(TaskScheduler::Task{.fn = std::move(fn), .group = this});
+}
+
+void TaskGroup::wait() {
+    waitImpl();
+    std::exception_ptr exception;
+    {
+        std::lock_guard lock(_exceptionMutex);
+        std::swap(exception, _exception);
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::waitImpl() {
+    auto& s = _scheduler;
+    const auto workerIndex = s.currentWorkerIndex();
+    auto& counters = workerIndex ? s._workers[*workerIndex]->counters : s._waitingThreadCounters;
+    while (_pendingTasks.load() > 0) {
+        // Help with any task, not only with the ones of this group.
+        bool stolen;
+        if (auto task = s.findTask(workerIndex, stolen)) {
+            s.execute(std::move(*task), counters, stolen);
+            continue;
+        }
+        std::unique_lock lock(s._sleepMutex);
+        s._wake.wait(lock, [this, &s] {
+            return _pendingTasks.load() == 0 || s._queuedTasks.load() > 0;
+        });
+    }
+}
+
+void ParallelForRanges(size_t n,
+                       size_t grainSize,
+                       const std::function<void(size_t, size_t)>& fn,
+                       TaskScheduler& scheduler) {
+    grainSize = std::max<size_t>(grainSize, 1);
+    if (n <= grainSize || scheduler.threadCount() == 1) {
+        if (n > 0) {
+            fn(0, n);
+        }
+        return;
+    }
+    TaskGroup group(scheduler);
+    for (size_t begin = 0; begin < n; begin += grainSize) {
+        group.run([&fn, begin, end = std::min(n, begin + grainSize)] {
+            fn(begin, end);
+        });
+    }
+    group.wait();
+}
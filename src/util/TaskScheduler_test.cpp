@@ -0,0 +1,97 @@
+#include "util/TaskScheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <stdexcept>
+
+TEST(TaskScheduler, parallel_map_keeps_order) {
+    TaskScheduler scheduler(4);
+    auto squares = ParallelMap(
+        1000,
+        7,
+        [](size_t i) {
+            return i * i;
+        },
+        scheduler);
+    ASSERT_EQ(squares.size(), 1000u);
+    for (size_t i = 0; i < squares.size(); ++i) {
+        EXPECT_EQ(squares[i], i * i);
+    }
+    EXPECT_TRUE(ParallelMap(
+                    0,
+                    1,
+                    [](size_t i) {
+                        return i;
+                    },
+                    scheduler)
+                    .empty());
+}
+
+TEST(TaskScheduler, nested_groups) {
+    // More nested waits than threads: the waiting threads must run the tasks.
+    TaskScheduler scheduler(2);
+    std::atomic<int> sum = 0;
+    TaskGroup outer(scheduler);
+    for (int i = 0; i < 8; ++i) {
+        outer.run([&scheduler, &sum] {
+            TaskGroup inner(scheduler);
+            for (int j = 0; j < 8; ++j) {
+                inner.run([&sum] {
+                    ++sum;
+                });
+            }
+            inner.wait();
+        });
+    }
+    outer.wait();
+    EXPECT_EQ(sum, 64);
+    auto stats = scheduler.workerStats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(std::accumulate(stats.begin(),
+                              stats.end(),
+                              uint64_t(0),
+                              [](uint64_t a, const TaskScheduler::WorkerStats& b) {
+                                  return a + b.tasksRun;
+                              }),
+              72u);
+}
+
+TEST(TaskScheduler, single_thread) {
+    TaskScheduler scheduler(1);
+    EXPECT_EQ(scheduler.threadCount(), 1u);
+    int sum = 0;  // No synchronization needed, everything runs on this thread.
+    TaskGroup group(scheduler);
+    for (int i = 1; i <= 10; ++i) {
+        group.run([&sum, i] {
+            sum += i;
+        });
+    }
+    group.wait();
+    EXPECT_EQ(sum, 55);
+}
+
+TEST(TaskScheduler, cancel_and_exceptions) {
+    TaskScheduler scheduler(1);
+    std::atomic<int> ran = 0;
+    {
+        TaskGroup group(scheduler);
+        group.run([&ran] {
+            ++ran;
+        });
+        group.cancel();
+        group.wait();
+        EXPECT_TRUE(group.isCanceled());
+    }
+    EXPECT_EQ(ran, 0);
+
+    TaskGroup group(scheduler);
+    group.run([] {
+        throw std::runtime_error("task failed");
+    });
+    group.run([&ran] {
+        ++ran;  // Skipped, the group is canceled by the exception.
+    });
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(ran, 0);
+}
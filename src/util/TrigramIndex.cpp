@@ -0,0 +1,222 @@
+#include "util/TrigramIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+
+namespace {
+
+std::string ToLower(std::string_view s) {
+    std::string r(s);
+    for (auto& c : r) {
+        c = char(tolower(static_cast<unsigned char>(c)));
+    }
+    return r;
+}
+
+// `text` is the original (not lowercase) text, in which camel case humps also start words.
+bool IsWordStart(std::string_view text, size_t pos) {
+    if (pos == 0) {
+        return true;
+    }
+    auto prev = static_cast<unsigned char>(text[pos - 1]);
+    if (prev == '/' || prev == '_' || prev == '.' || prev == '-' || prev == ':') {
+        return true;
+    }
+    return !isupper(prev) && isupper(static_cast<unsigned char>(text[pos]));
+}
+
+constexpr uint32_t k_wordPrefix1Tag = 1 << 24, k_wordPrefix2Tag = 2 << 24;
+
+uint32_t Char(std::string_view s, size_t i) {
+    return uint32_t(static_cast<unsigned char>(s[i]));
+}
+
+// Gram of a word starting with `s`, which has 1 or 2 characters.
+uint32_t WordPrefixGram(std::string_view s) {
+    return s.size() == 1 ? k_wordPrefix1Tag | Char(s, 0) << 16
+                         : k_wordPrefix2Tag | Char(s, 0) << 16 | Char(s, 1) << 8;
+}
+
+uint32_t Trigram(std::string_view s, size_t i) {
+    return Char(s, i) << 16 | Char(s, i + 1) << 8 | Char(s, i + 2);
+}
+
+// The distinct trigrams of the query, or, if it's shorter than a trigram, its word prefix gram.
+// The word prefix grams of longer queries are not looked up, they would penalize the texts which
+// contain the query in the middle of a word.
+std::vector<uint32_t> QueryGrams(std::string_view lowercaseQuery) {
+    if (lowercaseQuery.size() < 3) {
+        return {WordPrefixGram(lowercaseQuery)};
+    }
+    std::vector<uint32_t> r;
+    for (size_t i = 0; i + 3 <= lowercaseQuery.size(); ++i) {
+        r.push_back(Trigram(lowercaseQuery, i));
+    }
+    std::ranges::sort(r);
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+    return r;
+}
+
+}  // namespace
+
+std::vector<TrigramIndex::Gram> TrigramIndex::DistinctGrams(const Slot& slot) {
+    std::string_view lowercaseText = slot.lowercaseText;
+    std::vector<Gram> r;
+    for (size_t i = 0; i < lowercaseText.size(); ++i) {
+        if (i + 3 <= lowercaseText.size()) {
+            r.push_back(Trigram(lowercaseText, i));
+        }
+        if (IsWordStart(slot.text, i)) {
+            r.push_back(WordPrefixGram(lowercaseText.substr(i, 1)));
+            if (i + 2 <= lowercaseText.size()) {
+                r.push_back(WordPrefixGram(lowercaseText.substr(i, 2)));
+            }
+        }
+    }
+    std::ranges::sort(r);
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+    return r;
+}
+
+int TrigramIndex::Score(const Slot& slot,
+                        std::string_view lowercaseQuery,
+                        int hits,
+                        int queryGrams) {
+    std::string_view lowercaseText = slot.lowercaseText;
+    int score = 1000 * hits / std::max(queryGrams, 1);
+    auto pos = lowercaseText.find(lowercaseQuery);
+    if (pos == std::string_view::npos) {
+        return score;
+    }
+    score += 1000;
+    if (lowercaseText.size() == lowercaseQuery.size()) {
+        return score + 1000;
+    }
+    if (pos == 0) {
+        return score + 500;
+    }
+    for (; pos != std::string_view::npos; pos = lowercaseText.find(lowercaseQuery, pos + 1)) {
+        if (IsWordStart(slot.text, pos)) {
+            return score + 250;
+        }
+    }
+    return score;
+}
+
+void TrigramIndex::insert(int64_t key, std::string_view text) {
+    erase(key);
+    uint32_t slot;
+    if (freeSlots.empty()) {
+        slot = uint32_t(slots.size());
+        slots.emplace_back();
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    auto& s = slots[slot];
+    s = Slot{.key = key, .text = std::string(text), .lowercaseText = ToLower(text)};
+    s.grams = DistinctGrams(s);
+    s.postingIndices.reserve(s.grams.size());
+    slotOfKey[key] = slot;
+    for (auto g : s.grams) {
+        auto& ps = postings[g];
+        s.postingIndices.push_back(uint32_t(ps.size()));
+        ps.push_back(slot);
+    }
+}
+
+void TrigramIndex::erase(int64_t key) {
+    auto it = slotOfKey.find(key);
+    if (it == slotOfKey.end()) {
+        return;
+    }
+    auto slot = it->second;
+    auto& s = slots[slot];
+    for (size_t i = 0; i < s.grams.size(); ++i) {
+        auto pit = postings.find(s.grams[i]);
+        auto& ps = pit->second;
+        // Move the last posting into the place of the erased one, and update its index.
+        auto index = s.postingIndices[i];
+        auto moved = ps.back();
+        ps[index] = moved;
+        ps.pop_back();
+        if (moved != slot) {
+            auto& m = slots[moved];
+            auto j = std::ranges::lower_bound(m.grams, s.grams[i]) - m.grams.begin();
+            m.postingIndices[size_t(j)] = index;
+        }
+        if (ps.empty()) {
+            postings.erase(pit);
+        }
+    }
+    slots[slot] = Slot{};
+    freeSlots.push_back(slot);
+    slotOfKey.erase(it);
+}
+
+void TrigramIndex::clear() {
+    slots.clear();
+    freeSlots.clear();
+    slotOfKey.clear();
+    postings.clear();
+}
+
+std::vector<TrigramIndex::Match> TrigramIndex::search(std::string_view query,
+                                                      size_t maxResults) const {
+    auto lowercaseQuery = ToLower(query);
+    if (lowercaseQuery.empty() || maxResults == 0) {
+        return {};
+    }
+    auto queryGrams = QueryGrams(lowercaseQuery);
+    const int n = int(queryGrams.size());
+
+    std::vector<uint32_t> hits(slots.size());
+    std::vector<uint32_t> hitSlots;
+    for (auto g : queryGrams) {
+        if (auto it = postings.find(g); it != postings.end()) {
+            for (auto slot : it->second) {
+                if (hits[slot]++ == 0) {
+                    hitSlots.push_back(slot);
+                }
+            }
+        }
+    }
+
+    struct Candidate {
+        Match match;
+        size_t textLength;
+    };
+    std::vector<Candidate> candidates;
+    const int minHits = std::max(1, (2 * n + 2) / 3);
+    for (auto slot : hitSlots) {
+        int h = int(hits[slot]);
+        if (h < minHits) {
+            continue;
+        }
+        candidates.push_back(Candidate{
+            .match = {.key = slots[slot].key, .score = Score(slots[slot], lowercaseQuery, h, n)},
+            .textLength = slots[slot].text.size()});
+    }
+
+    auto better = [](const Candidate& x, const Candidate& y) {
+        if (x.match.score != y.match.score) {
+            return x.match.score > y.match.score;
+        }
+        if (x.textLength != y.textLength) {
+            return x.textLength < y.textLength;
+        }
+        return x.match.key < y.match.key;
+    };
+    auto resultSize = std::min(maxResults, candidates.size());
+    std::partial_sort(candidates.begin(),
+                      candidates.begin() + ptrdiff_t(resultSize),
+                      candidates.end(),
+                      better);
+    std::vector<Match> result;
+    result.reserve(resultSize);
+    for (size_t i = 0; i < resultSize; ++i) {
+        result.push_back(candidates[i].match);
+    }
+    return result;
+}
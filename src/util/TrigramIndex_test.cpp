@@ -0,0 +1,81 @@
+#include "util/TrigramIndex.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+std::vector<int64_t> Keys(const std::vector<TrigramIndex::Match>& matches) {
+    std::vector<int64_t> r;
+    for (auto& m : matches) {
+        r.push_back(m.key);
+    }
+    return r;
+}
+}  // namespace
+
+TEST(TrigramIndex, ranking) {
+    TrigramIndex index;
+    index.insert(1, "ProjectTreeItem");
+    index.insert(2, "Project");
+    index.insert(3, "GeneratedFileWriter");
+    index.insert(4, "src/nmt/project/Subproject");
+
+    // Exact match first, then prefix match, then match at a word start.
+    EXPECT_EQ(Keys(index.search("project", 10)), (std::vector<int64_t>{2, 1, 4}));
+    EXPECT_EQ(Keys(index.search("PROJECT", 1)), (std::vector<int64_t>{2}));
+    // Typo: still contains most of the trigrams.
+    EXPECT_EQ(Keys(index.search("GeneratedFileWritter", 10)), (std::vector<int64_t>{3}));
+    EXPECT_TRUE(index.search("xyzzy", 10).empty());
+    // Shorter than a trigram: prefix of a word, including camel case humps.
+    EXPECT_EQ(Keys(index.search("fi", 10)), (std::vector<int64_t>{3}));
+    EXPECT_EQ(Keys(index.search("t", 10)), (std::vector<int64_t>{1}));
+    EXPECT_EQ(Keys(index.search("su", 10)), (std::vector<int64_t>{4}));
+    EXPECT_TRUE(index.search("", 10).empty());
+}
+
+TEST(TrigramIndex, update_and_erase) {
+    TrigramIndex index;
+    index.insert(1, "alpha");
+    index.insert(2, "alphabet");
+    EXPECT_EQ(Keys(index.search("alpha", 10)), (std::vector<int64_t>{1, 2}));
+
+    index.insert(1, "beta");
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_EQ(Keys(index.search("alpha", 10)), (std::vector<int64_t>{2}));
+    EXPECT_EQ(Keys(index.search("beta", 10)), (std::vector<int64_t>{1}));
+
+    index.erase(2);
+    index.erase(3);
+    EXPECT_FALSE(index.contains(2));
+    EXPECT_TRUE(index.search("alpha", 10).empty());
+    EXPECT_EQ(Keys(index.search("bet", 10)), (std::vector<int64_t>{1}));
+}
+
+TEST(TrigramIndex, erase_keeps_shared_postings) {
+    // The paths share most of their grams, erasing moves the postings of the others.
+    TrigramIndex index;
+    for (int64_t key = 0; key < 100; ++key) {
+        index.insert(key, "src/nmt/dir/File" + std::to_string(key));
+    }
+    for (int64_t key = 0; key < 100; key += 2) {
+        index.erase(key);
+    }
+    for (int64_t key = 1; key < 100; key += 4) {
+        index.insert(key, "src/other/Renamed" + std::to_string(key));
+    }
+    std::vector<int64_t> expected;
+    for (int64_t key = 3; key < 100; key += 4) {
+        expected.push_back(key);
+    }
+    auto keys = Keys(index.search("src/nmt/dir/file", 100));
+    std::ranges::sort(keys);
+    EXPECT_EQ(keys, expected);
+    EXPECT_EQ(Keys(index.search("Renamed97", 1)), (std::vector<int64_t>{97}));
+    for (int64_t key = 0; key < 100; ++key) {
+        index.erase(key);
+    }
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_TRUE(index.search("src", 10).empty());
+}
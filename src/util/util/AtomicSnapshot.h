@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Holds the latest published immutable snapshot of a `T`. A writer publishes new snapshots,
+// readers on any thread get the current one and can use it for as long as they want, without
+// blocking the writer.
+template<class T>
+class AtomicSnapshot {
+   public:
+    AtomicSnapshot() = default;
+    explicit AtomicSnapshot(std::shared_ptr<const T> x)
+        : p(std::move(x)) {}
+    AtomicSnapshot(const AtomicSnapshot&) = delete;
+    AtomicSnapshot& operator=(const AtomicSnapshot&) = delete;
+
+    /// nullptr if nothing has been published.
+    std::shared_ptr<const T> load() const {
+#if __cpp_lib_atomic_shared_ptr
+        return p.load(std::memory_order_acquire);
+#else
+        std::lock_guard lock(mutex);
+        return p;
+#endif
+    }
+    void publish(std::shared_ptr<const T> x) {
+#if __cpp_lib_atomic_shared_ptr
+        p.store(std::move(x), std::memory_order_release);
+#else
+        // The previous snapshot is released outside of the lock.
+        std::lock_guard lock(mutex);
+        p.swap(x);
+#endif
+    }
+
+   private:
+#if __cpp_lib_atomic_shared_ptr
+    std::atomic<std::shared_ptr<const T>> p;
+#else
+    // Fallback for standard libraries without `std::atomic<std::shared_ptr>` (libc++): held only
+    // for copying a pointer.
+    mutable std::mutex mutex;
+    std::shared_ptr<const T> p;
+#endif
+};
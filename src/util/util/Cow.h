@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// Copy-on-write value: copies share the value, the first write through a copy which is not the only
+// owner clones it. Copies can be moved to other threads, a `Cow` object itself is not thread-safe.
+template<class T>
+class Cow {
+   public:
+    Cow()
+        : p(std::make_shared<T>()) {}
+    explicit Cow(T x)
+        : p(std::make_shared<T>(std::move(x))) {}
+
+    const T& operator*() const {
+        return *p;
+    }
+    const T* operator->() const {
+        return p.get();
+    }
+
+    /// Clone the value if it's shared.
+    T& mut() {
+        if (p.use_count() > 1) {
+            p = std::make_shared<T>(std::as_const(*p));
+        } else {
+            // Synchronize with the release of the other owners (on other threads) which have gone.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *p;
+    }
+
+    bool isShared() const {
+        return p.use_count() > 1;
+    }
+
+   private:
+    std::shared_ptr<T> p;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Return the prerequisites of the rules of a Makefile-syntax dependency file as written by the
+/// `-MD`/`-MMD` options of GCC and Clang, in order of appearance, with duplicates. Handles line
+/// continuations and the escaping of spaces (`\ `), `#` (`\#`) and `$` (`$$`).
+std::vector<std::string> ParseMakeDepfilePrerequisites(std::string_view content);
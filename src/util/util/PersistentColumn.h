@@ -0,0 +1,63 @@
+#pragma once
+
+#include "util/Cow.h"
+
+#include <absl/log/check.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Dense array of small, trivially copyable values, typically one field of many items indexed by a
+// dense id (struct-of-arrays). The values are stored in fixed-size chunks which are shared between
+// copies and cloned on the first write (`Cow`), like in `PersistentIdMap`. Scans should iterate the
+// contiguous chunks (`chunk()`).
+template<class T, size_t ChunkSize = 1024>
+class PersistentColumn {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+   public:
+    static constexpr size_t k_chunkSize = ChunkSize;
+
+    size_t size() const {
+        return count;
+    }
+    const T& operator[](size_t i) const {
+        DCHECK(i < count) << "PersistentColumn: index " << i << " out of range";
+        return (*chunks[i / k_chunkSize])[i % k_chunkSize];
+    }
+    /// Clones the chunk of `i` if it's shared.
+    T& mut(size_t i) {
+        DCHECK(i < count) << "PersistentColumn: index " << i << " out of range";
+        return chunks[i / k_chunkSize].mut()[i % k_chunkSize];
+    }
+    void push_back(T value) {
+        if (count % k_chunkSize == 0) {
+            chunks.emplace_back();
+        }
+        chunks.back().mut()[count % k_chunkSize] = value;
+        ++count;
+    }
+
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+    /// The values of chunk `c`, the indices `c * k_chunkSize ...`. Only the last chunk is partial.
+    std::span<const T> chunk(size_t c) const {
+        DCHECK(c < chunks.size());
+        return std::span<const T>(*chunks[c]).first(std::min(k_chunkSize, count - c * k_chunkSize));
+    }
+
+    /// Estimated heap bytes (shared chunks included).
+    size_t chunkBytes() const {
+        return chunks.capacity() * sizeof(Cow<Chunk>) + chunks.size() * sizeof(Chunk);
+    }
+
+   private:
+    using Chunk = std::array<T, k_chunkSize>;
+    std::vector<Cow<Chunk>> chunks;
+    size_t count = 0;
+};
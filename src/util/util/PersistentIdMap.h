@@ -0,0 +1,153 @@
+#pragma once
+
+#include "util/Cow.h"
+
+#include <absl/log/check.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Map from non-negative, densely allocated ids (e.g. from a counter) to values. The values are
+// stored in fixed-size chunks which are shared between copies of the map and cloned on the first
+// write (`Cow`). Copying the map costs O(size / k_chunkSize), a write after a copy costs one chunk.
+//
+// Pointers and references to values are stable until the map is copied or the value is erased.
+// After a copy the first write to a chunk moves its values (the other copy keeps the old ones).
+template<class T, size_t ChunkSize = 64>
+class PersistentIdMap {
+   public:
+    static constexpr size_t k_chunkSize = ChunkSize;
+
+   private:
+    using Chunk = std::array<std::optional<T>, k_chunkSize>;
+
+   public:
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    bool contains(int64_t id) const {
+        return find(id) != nullptr;
+    }
+    const T* find(int64_t id) const {
+        if (id < 0 || size_t(id) / k_chunkSize >= chunks.size()) {
+            return nullptr;
+        }
+        auto& slot = (*chunks[size_t(id) / k_chunkSize])[size_t(id) % k_chunkSize];
+        return slot ? &*slot : nullptr;
+    }
+    /// It's an error if `id` doesn't exist.
+    const T& at(int64_t id) const {
+        auto* p = find(id);
+        CHECK(p) << "PersistentIdMap: id " << id << " not found";
+        return *p;
+    }
+    /// Clones the chunk of `id` if it's shared.
+    T* findMut(int64_t id) {
+        if (!contains(id)) {
+            return nullptr;
+        }
+        return &*mutSlot(id);
+    }
+    /// It's an error if `id` doesn't exist. Clones the chunk of `id` if it's shared.
+    T& atMut(int64_t id) {
+        auto* p = findMut(id);
+        CHECK(p) << "PersistentIdMap: id " << id << " not found";
+        return *p;
+    }
+    /// Return the value of `id` and whether it has been inserted (false: `id` already existed, the
+    /// value is not changed).
+    std::pair<T*, bool> insert(int64_t id, T value) {
+        CHECK(id >= 0) << "PersistentIdMap: negative id " << id;
+        while (chunks.size() <= size_t(id) / k_chunkSize) {
+            chunks.emplace_back();
+        }
+        auto& slot = mutSlot(id);
+        if (slot) {
+            return {&*slot, false};
+        }
+        slot.emplace(std::move(value));
+        ++count;
+        return {&*slot, true};
+    }
+    /// Return whether `id` existed.
+    bool erase(int64_t id) {
+        if (!contains(id)) {
+            return false;
+        }
+        mutSlot(id).reset();
+        --count;
+        return true;
+    }
+
+    /// Estimated heap bytes of the chunks (shared chunks included), not including the values' own
+    /// heap allocations.
+    size_t chunkBytes() const {
+        return chunks.capacity() * sizeof(Cow<Chunk>) + chunks.size() * sizeof(Chunk);
+    }
+
+    // Iterates over the existing values in ascending id order, yields `std::pair<int64_t, const
+    // T&>`, use `for (auto [id, value] : map)`.
+    class const_iterator {
+       public:
+        using value_type = std::pair<int64_t, const T&>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        const_iterator() = default;
+        value_type operator*() const {
+            return value_type(int64_t(i), *(*(*chunks)[i / k_chunkSize])[i % k_chunkSize]);
+        }
+        const_iterator& operator++() {
+            ++i;
+            skipEmpty();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto r = *this;
+            ++*this;
+            return r;
+        }
+        bool operator==(const const_iterator& y) const {
+            return i == y.i;
+        }
+
+       private:
+        friend class PersistentIdMap;
+        const std::vector<Cow<Chunk>>* chunks = nullptr;
+        size_t i = 0;
+
+        const_iterator(const std::vector<Cow<Chunk>>* chunksArg, size_t iArg)
+            : chunks(chunksArg)
+            , i(iArg) {
+            skipEmpty();
+        }
+        void skipEmpty() {
+            const size_t end = chunks->size() * k_chunkSize;
+            while (i < end && !(*(*chunks)[i / k_chunkSize])[i % k_chunkSize]) {
+                ++i;
+            }
+        }
+    };
+    const_iterator begin() const {
+        return const_iterator(&chunks, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(&chunks, chunks.size() * k_chunkSize);
+    }
+
+   private:
+    std::vector<Cow<Chunk>> chunks;
+    size_t count = 0;
+
+    std::optional<T>& mutSlot(int64_t id) {
+        return chunks[size_t(id) / k_chunkSize].mut()[size_t(id) % k_chunkSize];
+    }
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <expected>
+#include <functional>
+#include <span>
+#include <string>
+
+struct ProcessResult {
+    int exitCode = -1;  // -1 if the process was terminated by a signal.
+    bool cancelled = false;
+    std::string output;  // stdout and stderr, interleaved.
+};
+
+/// Run `args[0]` (searched in `PATH` if it has no directory part) with the arguments. If
+/// `shouldCancel` is given it's polled while the process is running and the process is killed when
+/// it returns true. Return an error if the process couldn't be started. POSIX only.
+std::expected<ProcessResult, std::string> RunProcess(
+    std::span<const std::string> args, const std::function<bool()>& shouldCancel = {});
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// 64-bit FNV-1a hash, which, unlike `std::hash` or `absl::Hash`, gives the same value across runs,
+// builds and platforms, so it can be persisted (e.g. to detect unchanged inputs between runs).
+// Not suitable against adversarial inputs.
+class StableHasher {
+   public:
+    // Strings are prefixed with their length so ("ab", "c") and ("a", "bc") hash differently.
+    StableHasher& add(std::string_view s);
+    StableHasher& add(const char* s) {
+        return add(std::string_view(s));
+    }
+    StableHasher& add(const std::string& s) {
+        return add(std::string_view(s));
+    }
+    StableHasher& add(const std::filesystem::path& p);
+    StableHasher& add(uint64_t x);
+    StableHasher& add(std::span<const std::string> v);
+    StableHasher& add(const std::optional<std::string>& s);
+
+    uint64_t digest() const {
+        return h;
+    }
+
+   private:
+    static constexpr uint64_t k_offsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t k_prime = 1099511628211ull;
+
+    uint64_t h = k_offsetBasis;
+
+    void addBytes(const void* data, size_t size);
+};
+
+// Fixed width, lowercase hexadecimal, `ParseStableHashString(StableHashToString(x)) == x`.
+std::string StableHashToString(uint64_t x);
+std::optional<uint64_t> ParseStableHashString(std::string_view s);
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class TaskGroup;
+
+// Work-stealing scheduler shared by the parallel phases, so together they don't use more threads
+// than `threadCount()`. Each worker runs the tasks of its own queue in LIFO order and steals the
+// oldest tasks of the other workers when it runs out. The tasks submitted from other threads go to
+// a shared queue. A thread waiting for a `TaskGroup` runs tasks too, so it counts as one of the
+// `threadCount()` threads and nested task groups can't deadlock.
+class TaskScheduler {
+   public:
+    struct WorkerStats {
+        uint64_t tasksRun = 0;
+        uint64_t tasksStolen = 0;  // Taken from the queue of another worker.
+        std::chrono::nanoseconds busyTime{};
+    };
+
+    /// 0 means one thread per hardware thread. Starts `threadCount - 1` workers.
+    explicit TaskScheduler(unsigned threadCount = 0);
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    /// Run the remaining tasks and join the workers.
+    ~TaskScheduler();
+
+    unsigned threadCount() const {
+        return unsigned(_workers.size()) + 1;
+    }
+    /// One item per worker, the last one sums up the threads waiting for the task groups.
+    std::vector<WorkerStats> workerStats() const;
+
+    /// The process-wide scheduler, created on first use.
+    static TaskScheduler& shared();
+    /// Must be called before the first `shared()` call, e.g. for `--jobs`. 0: see constructor.
+    static void setSharedThreadCount(unsigned threadCount);
+
+   private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> fn;
+        TaskGroup* group = nullptr;
+    };
+    struct Counters {
+        std::atomic<uint64_t> tasksRun = 0, tasksStolen = 0, busyNanoseconds = 0;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        Counters counters;
+        std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    Counters _waitingThreadCounters;
+    std::mutex _injectedMutex;
+    std::deque<Task> _injected;
+    // Workers sleep and task group waiters block on `_wake` when there's nothing to steal.
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<size_t> _queuedTasks = 0;
+    bool _stopping = false;  // Guarded by `_sleepMutex`.
+
+    void submit(Task task);
+    /// Own queue first (if called on a worker), then the shared queue, then steal.
+    std::optional<Task> findTask(std::optional<size_t> workerIndex, bool& stolen);
+    void execute(Task task, Counters& counters, bool stolen);
+    void workerLoop(size_t workerIndex);
+    /// Index of the calling thread in `_workers`, nullopt if it's not a worker of this scheduler.
+    std::optional<size_t> currentWorkerIndex() const;
+    void notifyGroupDone();
+};
+
+// Tasks submitted together and waited for together. Canceling a group skips its tasks which
+// haven't started yet, the running ones can poll `isCanceled()`. If a task throws, the group is
+// canceled and `wait()` rethrows the first exception.
+class TaskGroup {
+   public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::shared())
+        : _scheduler(scheduler) {
+    }
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    /// Cancel and wait for the running tasks, ignore their exceptions.
+    ~TaskGroup();
+
+    void run(std::function<void()> fn);
+    /// Run tasks on this thread until all tasks of the group are done.
+    void wait();
+    void cancel() {
+        _canceled.store(true, std::memory_order_relaxed);
+    }
+    bool isCanceled() const {
+        return _canceled.load(std::memory_order_relaxed);
+    }
+
+    TaskScheduler& scheduler() const {
+        return _scheduler;
+    }
+
+   private:
+    friend class TaskScheduler;
+
+    TaskScheduler& _scheduler;
+    std::atomic<size_t> _pendingTasks = 0;
+    std::atomic<bool> _canceled = false;
+    std::mutex _exceptionMutex;
+    std::exception_ptr _exception;
+
+    void waitImpl();
+};
+
+/// Call `fn(begin, end)` for consecutive ranges of [0, n) of about `grainSize` items, in parallel.
+void ParallelForRanges(size_t n,
+                       size_t grainSize,
+                       const std::function<void(size_t, size_t)>& fn,
+                       TaskScheduler& scheduler = TaskScheduler::shared());
+
+/// Call `fn(i)` for each i in [0, n) in parallel.
+template<class F>
+void ParallelFor(size_t n,
+                 size_t grainSize,
+                 F&& fn,
+                 TaskScheduler& scheduler = TaskScheduler::shared()) {
+    ParallelForRanges(
+        n,
+        grainSize,
+        [&fn](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                fn(i);
+            }
+        },
+        scheduler);
+}
+
+/// Result[i] is `fn(i)`, the results are in index order regardless of which thread computed them.
+template<class F>
+auto ParallelMap(size_t n,
+                 size_t grainSize,
+                 F&& fn,
+                 TaskScheduler& scheduler = TaskScheduler::shared())
+    -> std::vector<std::invoke_result_t<F&, size_t>> {
+    using R = std::invoke_result_t<F&, size_t>;
+    std::vector<std::optional<R>> slots(n);
+    ParallelFor(
+        n,
+        grainSize,
+        [&](size_t i) {
+            slots[i].emplace(fn(i));
+        },
+        scheduler);
+    std::vector<R> result;
+    result.reserve(n);
+    for (auto& s : slots) {
+        result.push_back(std::move(*s));
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Incremental trigram index for case-insensitive (ASCII), typo-tolerant substring search over
+// short texts (names, paths) identified by integer keys. A text is a candidate if it contains at
+// least 2/3 of the distinct trigrams of the query. Queries shorter than a trigram match the texts
+// which have a word starting with the query. Words are delimited by '/', '_', '.', '-', ':' and
+// camel case humps.
+class TrigramIndex {
+   public:
+    struct Match {
+        int64_t key;
+        int score;  // Higher is better.
+    };
+
+    /// Add the text of `key` or replace its previous text.
+    void insert(int64_t key, std::string_view text);
+    /// No-op if `key` is not in the index.
+    void erase(int64_t key);
+    void clear();
+
+    bool contains(int64_t key) const {
+        return slotOfKey.contains(key);
+    }
+    size_t size() const {
+        return slotOfKey.size();
+    }
+
+    /// Return the best `maxResults` matches, ordered by descending score. Ties are ordered by the
+    /// length of the text, then by key.
+    std::vector<Match> search(std::string_view query, size_t maxResults) const;
+
+   private:
+    // 3 characters, or a tag in the highest byte and the first 1 or 2 characters of a word.
+    using Gram = uint32_t;
+
+    struct Slot {
+        int64_t key;
+        std::string text, lowercaseText;
+        std::vector<Gram> grams;               // `DistinctGrams()`, sorted.
+        std::vector<uint32_t> postingIndices;  // The index of the slot in `postings[grams[i]]`.
+    };
+    // The postings refer to slots, which are dense so the search can count hits in a vector.
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<int64_t, uint32_t> slotOfKey;
+    std::unordered_map<Gram, std::vector<uint32_t>> postings;  // Unordered, no duplicates.
+
+    static std::vector<Gram> DistinctGrams(const Slot& slot);
+    static int Score(const Slot& slot,
+                     std::string_view lowercaseQuery,
+                     int hits,
+                     int queryGrams);
+};
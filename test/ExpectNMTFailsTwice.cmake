@@ -0,0 +1,14 @@
+# Run `nmt` twice on SOURCE_DIR, both runs must fail: the files of an entity which couldn't be
+# produced are not kept as unchanged by the next run.
+file(REMOVE_RECURSE ${OUTPUT_DIR})
+foreach(run IN ITEMS 1 2)
+	execute_process(COMMAND ${NMT_PROGRAM}
+		--source-dir ${SOURCE_DIR}
+		--target unresolved_needs
+		--output-dir ${OUTPUT_DIR}
+		RESULT_VARIABLE result
+	)
+	if(result EQUAL 0)
+		message(FATAL_ERROR "Run ${run} of nmt succeeded, expected it to fail.")
+	endif()
+endforeach()
@@ -0,0 +1,6 @@
+// #fn
+int Function() {
+    return Missing();
+}
+
+// #defneeds: Missing